@@ -0,0 +1,332 @@
+#include "Blake3.h"
+
+#include "Blake3Impl.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace core {
+
+using namespace blake3;
+
+namespace {
+
+// Chunks handed to the kernel per call; a multiple of every lane count.
+constexpr std::size_t kBatchChunks = 32;
+
+inline std::uint32_t loadLittleEndian32(const std::uint8_t *bytes) {
+    return static_cast<std::uint32_t>(bytes[0]) | (static_cast<std::uint32_t>(bytes[1]) << 8)
+        | (static_cast<std::uint32_t>(bytes[2]) << 16) | (static_cast<std::uint32_t>(bytes[3]) << 24);
+}
+
+inline void storeLittleEndian32(std::uint8_t *bytes, std::uint32_t value) {
+    bytes[0] = static_cast<std::uint8_t>(value);
+    bytes[1] = static_cast<std::uint8_t>(value >> 8);
+    bytes[2] = static_cast<std::uint8_t>(value >> 16);
+    bytes[3] = static_cast<std::uint8_t>(value >> 24);
+}
+
+inline std::uint32_t rotateRight(std::uint32_t value, int bits) {
+    return (value >> bits) | (value << (32 - bits));
+}
+
+inline void mix(std::uint32_t *state, int a, int b, int c, int d, std::uint32_t x, std::uint32_t y) {
+    state[a] = state[a] + state[b] + x;
+    state[d] = rotateRight(state[d] ^ state[a], 16);
+    state[c] = state[c] + state[d];
+    state[b] = rotateRight(state[b] ^ state[c], 12);
+    state[a] = state[a] + state[b] + y;
+    state[d] = rotateRight(state[d] ^ state[a], 8);
+    state[c] = state[c] + state[d];
+    state[b] = rotateRight(state[b] ^ state[c], 7);
+}
+
+void compress(const std::uint32_t cv[8],
+              const std::uint8_t block[kBlockLen],
+              std::uint8_t blockLen,
+              std::uint64_t counter,
+              std::uint8_t flags,
+              std::uint32_t state[16]) {
+    std::uint32_t message[16];
+    for (int i = 0; i < 16; ++i) {
+        message[i] = loadLittleEndian32(block + 4 * i);
+    }
+    for (int i = 0; i < 8; ++i) {
+        state[i] = cv[i];
+    }
+    state[8] = kIv[0];
+    state[9] = kIv[1];
+    state[10] = kIv[2];
+    state[11] = kIv[3];
+    state[12] = static_cast<std::uint32_t>(counter);
+    state[13] = static_cast<std::uint32_t>(counter >> 32);
+    state[14] = blockLen;
+    state[15] = flags;
+    for (const auto &schedule : kMessageSchedule) {
+        mix(state, 0, 4, 8, 12, message[schedule[0]], message[schedule[1]]);
+        mix(state, 1, 5, 9, 13, message[schedule[2]], message[schedule[3]]);
+        mix(state, 2, 6, 10, 14, message[schedule[4]], message[schedule[5]]);
+        mix(state, 3, 7, 11, 15, message[schedule[6]], message[schedule[7]]);
+        mix(state, 0, 5, 10, 15, message[schedule[8]], message[schedule[9]]);
+        mix(state, 1, 6, 11, 12, message[schedule[10]], message[schedule[11]]);
+        mix(state, 2, 7, 8, 13, message[schedule[12]], message[schedule[13]]);
+        mix(state, 3, 4, 9, 14, message[schedule[14]], message[schedule[15]]);
+    }
+}
+
+void compressInPlace(std::uint32_t cv[8],
+                     const std::uint8_t block[kBlockLen],
+                     std::uint8_t blockLen,
+                     std::uint64_t counter,
+                     std::uint8_t flags) {
+    std::uint32_t state[16];
+    compress(cv, block, blockLen, counter, flags, state);
+    for (int i = 0; i < 8; ++i) {
+        cv[i] = state[i] ^ state[i + 8];
+    }
+}
+
+Kernel selectKernel() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        const Kernel kernel = avx512Kernel();
+        if (kernel.hashMany) {
+            return kernel;
+        }
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        const Kernel kernel = avx2Kernel();
+        if (kernel.hashMany) {
+            return kernel;
+        }
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        const Kernel kernel = sse41Kernel();
+        if (kernel.hashMany) {
+            return kernel;
+        }
+    }
+#endif
+    return Kernel{"portable", 1, hashManyPortable};
+}
+
+const Kernel &kernel() {
+    static const Kernel selected = selectKernel();
+    return selected;
+}
+
+}
+
+namespace blake3 {
+
+void hashManyPortable(const std::uint8_t *const *inputs,
+                      std::size_t count,
+                      std::size_t blocks,
+                      const std::uint32_t key[8],
+                      std::uint64_t counter,
+                      bool incrementCounter,
+                      std::uint8_t flags,
+                      std::uint8_t flagsStart,
+                      std::uint8_t flagsEnd,
+                      std::uint8_t *out) {
+    for (std::size_t input = 0; input < count; ++input) {
+        std::uint32_t cv[8];
+        std::memcpy(cv, key, sizeof(cv));
+        std::uint8_t blockFlags = flags | flagsStart;
+        for (std::size_t block = 0; block < blocks; ++block) {
+            if (block + 1 == blocks) {
+                blockFlags |= flagsEnd;
+            }
+            compressInPlace(cv, inputs[input] + block * kBlockLen, kBlockLen, counter, blockFlags);
+            blockFlags = flags;
+        }
+        for (int i = 0; i < 8; ++i) {
+            storeLittleEndian32(out + input * kOutLen + 4 * i, cv[i]);
+        }
+        if (incrementCounter) {
+            ++counter;
+        }
+    }
+}
+
+} // namespace blake3
+
+Blake3::Digest Blake3::Output::chainingValue() const {
+    std::uint32_t words[8];
+    std::memcpy(words, cv, sizeof(words));
+    compressInPlace(words, block, blockLen, counter, flags);
+    Digest digest;
+    for (int i = 0; i < 8; ++i) {
+        storeLittleEndian32(digest.data() + 4 * i, words[i]);
+    }
+    return digest;
+}
+
+// Only the first 32 bytes of the extendable output, so output block 0.
+Blake3::Digest Blake3::Output::rootBytes() const {
+    std::uint32_t state[16];
+    compress(cv, block, blockLen, 0, flags | Root, state);
+    Digest digest;
+    for (int i = 0; i < 8; ++i) {
+        storeLittleEndian32(digest.data() + 4 * i, state[i] ^ state[i + 8]);
+    }
+    return digest;
+}
+
+Blake3::Blake3() {
+    resetChunk();
+}
+
+Blake3 Blake3::forSubtree(std::uint64_t firstChunk) {
+    Blake3 hasher;
+    hasher.m_firstChunk = firstChunk;
+    hasher.m_chunkCounter = firstChunk;
+    return hasher;
+}
+
+void Blake3::resetChunk() {
+    std::memcpy(m_cv, kIv, sizeof(m_cv));
+    m_blockLen = 0;
+    m_blocksCompressed = 0;
+}
+
+void Blake3::updateChunk(const unsigned char *data, std::size_t size) {
+    while (size > 0) {
+        // The last block of a chunk is compressed with ChunkEnd, so a full
+        // block waits here until more input shows it was not the last.
+        if (m_blockLen == kBlockLen) {
+            compressInPlace(m_cv, m_block, kBlockLen, m_chunkCounter, m_blocksCompressed == 0 ? ChunkStart : 0);
+            ++m_blocksCompressed;
+            m_blockLen = 0;
+        }
+        const std::size_t take = std::min(kBlockLen - m_blockLen, size);
+        std::memcpy(m_block + m_blockLen, data, take);
+        m_blockLen += take;
+        data += take;
+        size -= take;
+    }
+}
+
+Blake3::Output Blake3::chunkOutput() const {
+    Output output;
+    std::memcpy(output.cv, m_cv, sizeof(output.cv));
+    std::memset(output.block, 0, sizeof(output.block));
+    std::memcpy(output.block, m_block, m_blockLen);
+    output.blockLen = static_cast<std::uint8_t>(m_blockLen);
+    output.counter = m_chunkCounter;
+    output.flags = static_cast<std::uint8_t>((m_blocksCompressed == 0 ? ChunkStart : 0) | ChunkEnd);
+    return output;
+}
+
+Blake3::Output Blake3::parentOutput(const std::uint8_t *children) const {
+    Output output;
+    std::memcpy(output.cv, kIv, sizeof(output.cv));
+    std::memcpy(output.block, children, kBlockLen);
+    output.blockLen = kBlockLen;
+    output.counter = 0;
+    output.flags = Parent;
+    return output;
+}
+
+// Merges lazily: a pair of subtrees is only joined once a later chunk shows
+// that neither of them is the root. Afterwards the stack holds one value per
+// set bit of the number of chunks before the current one.
+void Blake3::mergeStack() {
+    const std::uint64_t chunksBefore = m_chunkCounter - m_firstChunk;
+    const auto mergedLength = static_cast<std::size_t>(__builtin_popcountll(chunksBefore));
+    while (m_stackLength > mergedLength) {
+        std::uint8_t *children = m_stack + (m_stackLength - 2) * kDigestSize;
+        const Digest parent = parentOutput(children).chainingValue();
+        std::memcpy(children, parent.data(), kDigestSize);
+        --m_stackLength;
+    }
+}
+
+void Blake3::pushChainingValue(const std::uint8_t *cv) {
+    mergeStack();
+    std::memcpy(m_stack + m_stackLength * kDigestSize, cv, kDigestSize);
+    ++m_stackLength;
+}
+
+void Blake3::update(const unsigned char *data, std::size_t size) {
+    if (chunkLength() > 0) {
+        const std::size_t take = std::min(kChunkSize - chunkLength(), size);
+        updateChunk(data, take);
+        data += take;
+        size -= take;
+        if (size == 0) {
+            return;
+        }
+        const Digest cv = chunkOutput().chainingValue();
+        pushChainingValue(cv.data());
+        ++m_chunkCounter;
+        resetChunk();
+    }
+
+    // Whole chunks go through the kernel in batches. At least one byte is
+    // left for the chunk state, since the last chunk may be the root.
+    const Kernel &selected = kernel();
+    const std::uint8_t *inputs[kBatchChunks];
+    std::uint8_t cvs[kBatchChunks * kDigestSize];
+    while (size > kChunkSize) {
+        const std::size_t chunks = std::min(kBatchChunks, (size - 1) / kChunkSize);
+        for (std::size_t i = 0; i < chunks; ++i) {
+            inputs[i] = data + i * kChunkSize;
+        }
+        selected.hashMany(inputs, chunks, kChunkSize / kBlockLen, kIv, m_chunkCounter, true, 0, ChunkStart, ChunkEnd,
+                          cvs);
+        for (std::size_t i = 0; i < chunks; ++i) {
+            pushChainingValue(cvs + i * kDigestSize);
+            ++m_chunkCounter;
+        }
+        data += chunks * kChunkSize;
+        size -= chunks * kChunkSize;
+    }
+    if (size > 0) {
+        updateChunk(data, size);
+        mergeStack();
+    }
+}
+
+Blake3::Output Blake3::finalOutput() const {
+    // The current chunk is the rightmost leaf; fold it into the stack from
+    // the top.
+    Output output = chunkOutput();
+    std::size_t remaining = m_stackLength;
+    while (remaining > 0) {
+        --remaining;
+        std::uint8_t children[kBlockLen];
+        std::memcpy(children, m_stack + remaining * kDigestSize, kDigestSize);
+        const Digest right = output.chainingValue();
+        std::memcpy(children + kDigestSize, right.data(), kDigestSize);
+        output = parentOutput(children);
+    }
+    return output;
+}
+
+Blake3::Digest Blake3::digest() const {
+    return finalOutput().rootBytes();
+}
+
+Blake3::Digest Blake3::chainingValue() const {
+    return finalOutput().chainingValue();
+}
+
+void Blake3::appendSubtree(const Digest &chainingValue, std::uint64_t chunks) {
+    pushChainingValue(chainingValue.data());
+    m_chunkCounter += chunks;
+    resetChunk();
+}
+
+Blake3::Digest Blake3::hash(const unsigned char *data, std::size_t size) {
+    Blake3 hasher;
+    hasher.update(data, size);
+    return hasher.digest();
+}
+
+const char *Blake3::implementation() {
+    return kernel().name;
+}
+
+} // namespace core
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace core {
+
+// Streaming BLAKE3 (unkeyed, 32-byte output). Runs of whole chunks are
+// compressed several at a time by the widest kernel the CPU supports
+// (AVX-512, AVX2, SSE4.1), picked once at run time; other CPUs use the
+// portable code.
+//
+// A large input can also be split into subtrees hashed on separate threads:
+// a subtree is 2^k whole chunks (kChunkSize bytes each) starting at a chunk
+// index that is a multiple of 2^k. Hash it with forSubtree(), take its
+// chainingValue() and appendSubtree() the values, in order, to the hasher of
+// the whole input. That hasher must then be at the same chunk boundary, and
+// at least one byte has to follow the last appended subtree.
+class Blake3 {
+public:
+    static constexpr std::size_t kDigestSize = 32;
+    static constexpr std::size_t kChunkSize = 1024;
+    using Digest = std::array<unsigned char, kDigestSize>;
+
+    Blake3();
+
+    void update(const unsigned char *data, std::size_t size);
+    // Digest of everything fed so far; the hash can still be updated after.
+    Digest digest() const;
+
+    static Blake3 forSubtree(std::uint64_t firstChunk);
+    Digest chainingValue() const;
+    void appendSubtree(const Digest &chainingValue, std::uint64_t chunks);
+
+    static Digest hash(const unsigned char *data, std::size_t size);
+    // "avx512", "avx2", "sse4.1" or "portable".
+    static const char *implementation();
+
+private:
+    struct Output {
+        std::uint32_t cv[8];
+        std::uint8_t block[64];
+        std::uint8_t blockLen;
+        std::uint64_t counter;
+        std::uint8_t flags;
+
+        Digest chainingValue() const;
+        Digest rootBytes() const;
+    };
+
+    std::size_t chunkLength() const { return m_blocksCompressed * 64 + m_blockLen; }
+    void resetChunk();
+    void updateChunk(const unsigned char *data, std::size_t size);
+    Output chunkOutput() const;
+    Output parentOutput(const std::uint8_t *children) const;
+    Output finalOutput() const;
+    void mergeStack();
+    void pushChainingValue(const std::uint8_t *cv);
+
+    // 54 levels cover 2^64 bytes of input.
+    static constexpr std::size_t kMaxDepth = 54;
+
+    std::uint32_t m_cv[8];
+    std::uint64_t m_firstChunk = 0;
+    std::uint64_t m_chunkCounter = 0;
+    std::uint8_t m_block[64];
+    std::size_t m_blockLen = 0;
+    std::size_t m_blocksCompressed = 0;
+    std::uint8_t m_stack[kMaxDepth * kDigestSize];
+    std::size_t m_stackLength = 0;
+};
+
+}
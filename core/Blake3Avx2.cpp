@@ -0,0 +1,41 @@
+// Built with -mavx2 on x86-64; see CMakeLists.txt.
+#include "Blake3Impl.h"
+
+#if defined(__AVX2__)
+#include "Blake3Simd.h"
+#endif
+
+namespace core {
+namespace blake3 {
+
+#if defined(__AVX2__)
+namespace {
+
+typedef std::uint32_t Lanes8 __attribute__((vector_size(32)));
+
+void hashMany8(const std::uint8_t *const *inputs,
+               std::size_t count,
+               std::size_t blocks,
+               const std::uint32_t key[8],
+               std::uint64_t counter,
+               bool incrementCounter,
+               std::uint8_t flags,
+               std::uint8_t flagsStart,
+               std::uint8_t flagsEnd,
+               std::uint8_t *out) {
+    hashManyLanes<Lanes8, 8>(inputs, count, blocks, key, counter, incrementCounter, flags, flagsStart, flagsEnd, out);
+}
+
+}
+
+Kernel avx2Kernel() {
+    return Kernel{"avx2", 8, hashMany8};
+}
+#else
+Kernel avx2Kernel() {
+    return {};
+}
+#endif
+
+} // namespace blake3
+} // namespace core
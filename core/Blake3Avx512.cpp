@@ -0,0 +1,41 @@
+// Built with -mavx512f on x86-64; see CMakeLists.txt.
+#include "Blake3Impl.h"
+
+#if defined(__AVX512F__)
+#include "Blake3Simd.h"
+#endif
+
+namespace core {
+namespace blake3 {
+
+#if defined(__AVX512F__)
+namespace {
+
+typedef std::uint32_t Lanes16 __attribute__((vector_size(64)));
+
+void hashMany16(const std::uint8_t *const *inputs,
+                std::size_t count,
+                std::size_t blocks,
+                const std::uint32_t key[8],
+                std::uint64_t counter,
+                bool incrementCounter,
+                std::uint8_t flags,
+                std::uint8_t flagsStart,
+                std::uint8_t flagsEnd,
+                std::uint8_t *out) {
+    hashManyLanes<Lanes16, 16>(inputs, count, blocks, key, counter, incrementCounter, flags, flagsStart, flagsEnd, out);
+}
+
+}
+
+Kernel avx512Kernel() {
+    return Kernel{"avx512", 16, hashMany16};
+}
+#else
+Kernel avx512Kernel() {
+    return {};
+}
+#endif
+
+} // namespace blake3
+} // namespace core
@@ -0,0 +1,143 @@
+#include "Blake3Hasher.h"
+
+#include "ResourceGovernor.h"
+#include "SystemInfo.h"
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <sys/stat.h>
+
+namespace core {
+
+namespace {
+
+// Subtrees must be a power of two chunks long; the largest one within bytes.
+std::uint64_t subtreeChunks(std::uint64_t bytes) {
+    std::uint64_t chunks = 1;
+    while (chunks * 2 * Blake3::kChunkSize <= bytes) {
+        chunks *= 2;
+    }
+    return chunks;
+}
+
+int streamRange(const std::string &path,
+                std::uint64_t offset,
+                std::uint64_t length,
+                const Blake3HasherOptions &options,
+                Blake3 &hasher,
+                std::uint64_t *read = nullptr) {
+    FileReaderOptions readerOptions;
+    readerOptions.cachePolicy = options.cachePolicy;
+    readerOptions.throttled = options.throttle != nullptr;
+    std::uint64_t total = 0;
+    const int error = readFileRange(path,
+                                    offset,
+                                    length,
+                                    [&options, &hasher, &total](const unsigned char *data, std::size_t size) {
+                                        if (options.throttle) {
+                                            options.throttle->acquire(size);
+                                        }
+                                        hasher.update(data, size);
+                                        total += size;
+                                    },
+                                    readerOptions);
+    if (read) {
+        *read = total;
+    }
+    return error;
+}
+
+}
+
+Blake3Hasher::Blake3Hasher(Blake3HasherOptions options) : m_options(std::move(options)) {}
+
+std::string Blake3Hasher::compute(const std::filesystem::path &path) {
+    Blake3::Digest digest;
+    if (hashFile(path.string(), m_options, digest) != 0) {
+        return {};
+    }
+    static const char kHex[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(2 * digest.size());
+    for (const unsigned char byte : digest) {
+        hex += kHex[byte >> 4];
+        hex += kHex[byte & 0xf];
+    }
+    return hex;
+}
+
+int Blake3Hasher::hashFile(const std::string &path, const Blake3HasherOptions &options, Blake3::Digest &digest) {
+    struct stat info {};
+    if (::stat(path.c_str(), &info) != 0) {
+        return errno;
+    }
+    const auto size = static_cast<std::uint64_t>(info.st_size);
+    const std::uint64_t chunks = subtreeChunks(options.subtreeBytes);
+    const std::uint64_t pieceBytes = chunks * Blake3::kChunkSize;
+
+    Blake3 hasher;
+    std::uint64_t pieces = 0;
+    if (S_ISREG(info.st_mode) && options.parallelThreshold > 0 && size >= options.parallelThreshold
+        && size > pieceBytes) {
+        // The byte after the last piece keeps the root out of the subtrees.
+        pieces = (size - 1) / pieceBytes;
+        std::vector<Blake3::Digest> values(pieces);
+        std::atomic<int> firstError{0};
+        auto hashPiece = [&path, &options, &values, &firstError, chunks, pieceBytes](std::uint64_t i) {
+            if (firstError != 0) {
+                return;
+            }
+            Blake3 subtree = Blake3::forSubtree(i * chunks);
+            std::uint64_t read = 0;
+            int error = streamRange(path, i * pieceBytes, pieceBytes, options, subtree, &read);
+            if (error == 0 && read != pieceBytes) {
+                error = EIO; // truncated while being read
+            }
+            if (error != 0) {
+                int expected = 0;
+                firstError.compare_exchange_strong(expected, error);
+                return;
+            }
+            values[i] = subtree.chainingValue();
+        };
+        const auto threads = static_cast<unsigned>(
+            std::min<std::uint64_t>(options.threads > 0 ? options.threads : availableCpuCount(), pieces));
+        if (threads > 1) {
+            WorkStealingPool pool(threads);
+            for (std::uint64_t i = 0; i < pieces; ++i) {
+                pool.submit([&hashPiece, i]() { hashPiece(i); });
+            }
+            pool.wait();
+        } else {
+            // Still appended as subtrees, so the digest is the same.
+            for (std::uint64_t i = 0; i < pieces && firstError == 0; ++i) {
+                hashPiece(i);
+            }
+        }
+        if (firstError != 0) {
+            return firstError;
+        }
+        for (const Blake3::Digest &value : values) {
+            hasher.appendSubtree(value, chunks);
+        }
+    }
+
+    std::uint64_t read = 0;
+    const int error = streamRange(path, pieces * pieceBytes, UINT64_MAX, options, hasher, &read);
+    if (error != 0) {
+        return error;
+    }
+    if (pieces > 0 && read == 0) {
+        return EIO; // the tail vanished, so the last subtree would be the root
+    }
+    digest = hasher.digest();
+    return 0;
+}
+
+} // namespace core
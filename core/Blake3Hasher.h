@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Blake3.h"
+#include "FileReader.h"
+#include "IHasher.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+namespace core {
+
+class ReadThrottle;
+
+struct Blake3HasherOptions {
+    std::uint64_t parallelThreshold = 16 * 1024 * 1024; // files at least this big are split, 0 = never
+    std::uint64_t subtreeBytes = 4 * 1024 * 1024;       // bytes per task, rounded down to 2^k chunks
+    unsigned threads = 0;                               // 0 = availableCpuCount(), 1 = no pool
+    CachePolicy cachePolicy = CachePolicy::Keep;
+    ReadThrottle *throttle = nullptr; // charged for every byte read when set
+};
+
+// BLAKE3 of a file as lowercase hex, or an empty string when it cannot be
+// read. Unlike a Merkle tree over fixed chunks, splitting the file changes
+// nothing in the result: BLAKE3 already is a tree, so subtrees hashed on
+// different threads combine into the same digest as one sequential pass.
+class Blake3Hasher : public IHasher {
+public:
+    explicit Blake3Hasher(Blake3HasherOptions options = {});
+
+    std::string compute(const std::filesystem::path &path) override;
+
+    // Returns 0 or an errno value. Files from parallelThreshold bytes on are
+    // read in subtreeBytes pieces on a pool of their own; the last piece (at
+    // least one byte) is read to the end of the file on the calling thread.
+    static int hashFile(const std::string &path, const Blake3HasherOptions &options, Blake3::Digest &digest);
+
+private:
+    Blake3HasherOptions m_options;
+};
+
+}
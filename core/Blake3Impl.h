@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Internals shared by Blake3.cpp and the per-instruction-set kernels. Keep
+// this header free of inline functions: the kernels are compiled with -m
+// flags, and an inline definition emitted there could be the one the linker
+// keeps for the whole program.
+
+namespace core {
+namespace blake3 {
+
+constexpr std::size_t kBlockLen = 64;
+constexpr std::size_t kChunkLen = 1024;
+constexpr std::size_t kOutLen = 32;
+
+enum Flag : std::uint8_t {
+    ChunkStart = 1 << 0,
+    ChunkEnd = 1 << 1,
+    Parent = 1 << 2,
+    Root = 1 << 3,
+};
+
+constexpr std::uint32_t kIv[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+// The message word order of each of the seven rounds.
+constexpr std::uint8_t kMessageSchedule[7][16] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8},
+    {3, 4, 10, 12, 13, 2, 7, 14, 6, 5, 9, 0, 11, 15, 8, 1},
+    {10, 7, 12, 9, 14, 3, 13, 15, 4, 0, 11, 2, 5, 8, 1, 6},
+    {12, 13, 9, 11, 15, 10, 14, 8, 7, 2, 5, 3, 0, 1, 6, 4},
+    {9, 14, 11, 5, 8, 12, 15, 1, 13, 3, 0, 10, 2, 6, 4, 7},
+    {11, 15, 5, 0, 1, 9, 8, 6, 14, 10, 2, 12, 3, 4, 7, 13},
+};
+
+// Compresses count inputs of blocks * kBlockLen bytes each into count
+// chaining values of kOutLen bytes at out. Input i uses counter + i when
+// incrementCounter is set (chunks) and counter otherwise (parents).
+// flagsStart and flagsEnd are added to the first and the last block.
+using HashManyFn = void (*)(const std::uint8_t *const *inputs,
+                            std::size_t count,
+                            std::size_t blocks,
+                            const std::uint32_t key[8],
+                            std::uint64_t counter,
+                            bool incrementCounter,
+                            std::uint8_t flags,
+                            std::uint8_t flagsStart,
+                            std::uint8_t flagsEnd,
+                            std::uint8_t *out);
+
+struct Kernel {
+    const char *name = nullptr;
+    std::size_t lanes = 0; // inputs compressed side by side
+    HashManyFn hashMany = nullptr;
+};
+
+void hashManyPortable(const std::uint8_t *const *inputs,
+                      std::size_t count,
+                      std::size_t blocks,
+                      const std::uint32_t key[8],
+                      std::uint64_t counter,
+                      bool incrementCounter,
+                      std::uint8_t flags,
+                      std::uint8_t flagsStart,
+                      std::uint8_t flagsEnd,
+                      std::uint8_t *out);
+
+// Empty kernels when the translation unit was built without the instruction
+// set (another architecture or compiler).
+Kernel sse41Kernel();
+Kernel avx2Kernel();
+Kernel avx512Kernel();
+
+}
+}
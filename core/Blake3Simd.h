@@ -0,0 +1,129 @@
+#pragma once
+
+#include "Blake3Impl.h"
+
+// The lane-parallel BLAKE3 compression, written once with GCC/Clang vector
+// extensions and instantiated by each per-instruction-set translation unit
+// for its vector width. Everything has internal linkage so the copies built
+// with different -m flags stay apart.
+
+namespace core {
+namespace blake3 {
+namespace {
+
+inline std::uint32_t loadLittleEndian32(const std::uint8_t *bytes) {
+    return static_cast<std::uint32_t>(bytes[0]) | (static_cast<std::uint32_t>(bytes[1]) << 8)
+        | (static_cast<std::uint32_t>(bytes[2]) << 16) | (static_cast<std::uint32_t>(bytes[3]) << 24);
+}
+
+inline void storeLittleEndian32(std::uint8_t *bytes, std::uint32_t value) {
+    bytes[0] = static_cast<std::uint8_t>(value);
+    bytes[1] = static_cast<std::uint8_t>(value >> 8);
+    bytes[2] = static_cast<std::uint8_t>(value >> 16);
+    bytes[3] = static_cast<std::uint8_t>(value >> 24);
+}
+
+template <typename V>
+inline V rotateRight(V value, int bits) {
+    return (value >> bits) | (value << (32 - bits));
+}
+
+template <typename V>
+inline void mix(V *state, int a, int b, int c, int d, V x, V y) {
+    state[a] = state[a] + state[b] + x;
+    state[d] = rotateRight(state[d] ^ state[a], 16);
+    state[c] = state[c] + state[d];
+    state[b] = rotateRight(state[b] ^ state[c], 12);
+    state[a] = state[a] + state[b] + y;
+    state[d] = rotateRight(state[d] ^ state[a], 8);
+    state[c] = state[c] + state[d];
+    state[b] = rotateRight(state[b] ^ state[c], 7);
+}
+
+// Lanes inputs at once, lane i of every vector belonging to input i.
+template <typename V, std::size_t Lanes>
+void hashLanes(const std::uint8_t *const *inputs,
+               std::size_t blocks,
+               const std::uint32_t key[8],
+               std::uint64_t counter,
+               bool incrementCounter,
+               std::uint8_t flags,
+               std::uint8_t flagsStart,
+               std::uint8_t flagsEnd,
+               std::uint8_t *out) {
+    V cv[8];
+    for (int i = 0; i < 8; ++i) {
+        cv[i] = V{} + key[i];
+    }
+    V counterLow{};
+    V counterHigh{};
+    for (std::size_t lane = 0; lane < Lanes; ++lane) {
+        const std::uint64_t laneCounter = counter + (incrementCounter ? lane : 0);
+        counterLow[lane] = static_cast<std::uint32_t>(laneCounter);
+        counterHigh[lane] = static_cast<std::uint32_t>(laneCounter >> 32);
+    }
+
+    std::uint8_t blockFlags = flags | flagsStart;
+    for (std::size_t block = 0; block < blocks; ++block) {
+        if (block + 1 == blocks) {
+            blockFlags |= flagsEnd;
+        }
+        V message[16];
+        for (int word = 0; word < 16; ++word) {
+            for (std::size_t lane = 0; lane < Lanes; ++lane) {
+                message[word][lane] = loadLittleEndian32(inputs[lane] + block * kBlockLen + 4 * word);
+            }
+        }
+        V state[16] = {
+            cv[0], cv[1], cv[2], cv[3], cv[4], cv[5], cv[6], cv[7],
+            V{} + kIv[0], V{} + kIv[1], V{} + kIv[2], V{} + kIv[3],
+            counterLow, counterHigh, V{} + static_cast<std::uint32_t>(kBlockLen), V{} + static_cast<std::uint32_t>(blockFlags),
+        };
+        for (const auto &schedule : kMessageSchedule) {
+            mix(state, 0, 4, 8, 12, message[schedule[0]], message[schedule[1]]);
+            mix(state, 1, 5, 9, 13, message[schedule[2]], message[schedule[3]]);
+            mix(state, 2, 6, 10, 14, message[schedule[4]], message[schedule[5]]);
+            mix(state, 3, 7, 11, 15, message[schedule[6]], message[schedule[7]]);
+            mix(state, 0, 5, 10, 15, message[schedule[8]], message[schedule[9]]);
+            mix(state, 1, 6, 11, 12, message[schedule[10]], message[schedule[11]]);
+            mix(state, 2, 7, 8, 13, message[schedule[12]], message[schedule[13]]);
+            mix(state, 3, 4, 9, 14, message[schedule[14]], message[schedule[15]]);
+        }
+        for (int i = 0; i < 8; ++i) {
+            cv[i] = state[i] ^ state[i + 8];
+        }
+        blockFlags = flags;
+    }
+
+    for (std::size_t lane = 0; lane < Lanes; ++lane) {
+        for (int i = 0; i < 8; ++i) {
+            storeLittleEndian32(out + lane * kOutLen + 4 * i, cv[i][lane]);
+        }
+    }
+}
+
+template <typename V, std::size_t Lanes>
+void hashManyLanes(const std::uint8_t *const *inputs,
+                   std::size_t count,
+                   std::size_t blocks,
+                   const std::uint32_t key[8],
+                   std::uint64_t counter,
+                   bool incrementCounter,
+                   std::uint8_t flags,
+                   std::uint8_t flagsStart,
+                   std::uint8_t flagsEnd,
+                   std::uint8_t *out) {
+    for (; count >= Lanes; count -= Lanes) {
+        hashLanes<V, Lanes>(inputs, blocks, key, counter, incrementCounter, flags, flagsStart, flagsEnd, out);
+        if (incrementCounter) {
+            counter += Lanes;
+        }
+        inputs += Lanes;
+        out += Lanes * kOutLen;
+    }
+    hashManyPortable(inputs, count, blocks, key, counter, incrementCounter, flags, flagsStart, flagsEnd, out);
+}
+
+}
+}
+}
@@ -0,0 +1,41 @@
+// Built with -msse4.1 on x86-64; see CMakeLists.txt.
+#include "Blake3Impl.h"
+
+#if defined(__SSE4_1__)
+#include "Blake3Simd.h"
+#endif
+
+namespace core {
+namespace blake3 {
+
+#if defined(__SSE4_1__)
+namespace {
+
+typedef std::uint32_t Lanes4 __attribute__((vector_size(16)));
+
+void hashMany4(const std::uint8_t *const *inputs,
+               std::size_t count,
+               std::size_t blocks,
+               const std::uint32_t key[8],
+               std::uint64_t counter,
+               bool incrementCounter,
+               std::uint8_t flags,
+               std::uint8_t flagsStart,
+               std::uint8_t flagsEnd,
+               std::uint8_t *out) {
+    hashManyLanes<Lanes4, 4>(inputs, count, blocks, key, counter, incrementCounter, flags, flagsStart, flagsEnd, out);
+}
+
+}
+
+Kernel sse41Kernel() {
+    return Kernel{"sse4.1", 4, hashMany4};
+}
+#else
+Kernel sse41Kernel() {
+    return {};
+}
+#endif
+
+} // namespace blake3
+} // namespace core
@@ -23,6 +23,9 @@ struct Config {
     bool recursive = true;
     bool followSymlinks = false;
     int maxDepth = 20; // <0 disables the limit
+    int scanThreads = 0; // walker/hasher pool size; 0 sizes it from CPU affinity and cgroup quota
+    bool fastIncremental = false; // reuse the baseline hash while (dev, ino, size, mtime, ctime) match
+    int fullRehashCycle = 0;      // with fastIncremental, rehash every file once per N scans; 0 = never
 };
 
 }
@@ -0,0 +1,99 @@
+#include "DeviceScheduler.h"
+
+#include "SystemInfo.h"
+
+namespace core {
+
+DeviceScheduler::DeviceScheduler(DeviceConcurrency concurrency) : m_concurrency(concurrency) {}
+
+DeviceScheduler::~DeviceScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        for (auto &entry : m_queues) {
+            entry.second->wakeup.notify_all();
+        }
+    }
+    for (auto &entry : m_queues) {
+        for (auto &worker : entry.second->workers) {
+            worker.join();
+        }
+    }
+}
+
+void DeviceScheduler::submit(std::uint64_t device, Task task) {
+    m_pending.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto &slot = m_queues[device];
+    if (!slot) {
+        // Probed once per device; sysfs reads are too slow to repeat per task.
+        unsigned workers = isRotationalDevice(device) ? m_concurrency.rotational : m_concurrency.solidState;
+        if (workers == 0) {
+            workers = availableCpuCount();
+        }
+        slot = std::make_unique<DeviceQueue>();
+        slot->workers.reserve(workers);
+        for (unsigned i = 0; i < workers; ++i) {
+            slot->workers.emplace_back(&DeviceScheduler::run, this, std::ref(*slot));
+        }
+    }
+    slot->tasks.push_back(std::move(task));
+    slot->wakeup.notify_one();
+}
+
+void DeviceScheduler::wait() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this]() { return m_pending.load() == 0; });
+    if (m_error) {
+        auto error = m_error;
+        m_error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void DeviceScheduler::waitForRoom(std::size_t maxPending) {
+    if (m_pending.load() < maxPending) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(m_mutex);
+    ++m_roomWaiters;
+    m_room.wait(lock, [this, maxPending]() { return m_pending.load() < maxPending; });
+    --m_roomWaiters;
+}
+
+void DeviceScheduler::finishTask() {
+    const bool idle = m_pending.fetch_sub(1) == 1;
+    if (idle || m_roomWaiters.load() > 0) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (idle) {
+            m_idle.notify_all();
+        }
+        m_room.notify_all();
+    }
+}
+
+void DeviceScheduler::run(DeviceQueue &queue) {
+    while (true) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            queue.wakeup.wait(lock, [this, &queue]() { return m_stopping || !queue.tasks.empty(); });
+            if (queue.tasks.empty()) {
+                return;
+            }
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        try {
+            task();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_error) {
+                m_error = std::current_exception();
+            }
+        }
+        finishTask();
+    }
+}
+
+} // namespace core
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace core {
+
+// Workers per device queue; 0 means availableCpuCount().
+struct DeviceConcurrency {
+    unsigned rotational = 2; // more streams on a spinning disk only add seeks
+    unsigned solidState = 0;
+};
+
+// Runs I/O-bound tasks on one FIFO queue per device (a st_dev value), each
+// served by its own workers, so a slow disk only holds up its own files. A
+// device gets DeviceConcurrency::rotational or ::solidState workers depending
+// on isRotationalDevice(); they are started with its first task.
+class DeviceScheduler {
+public:
+    using Task = std::function<void()>;
+
+    explicit DeviceScheduler(DeviceConcurrency concurrency = {});
+    // Runs what is still queued, then joins the workers.
+    ~DeviceScheduler();
+
+    DeviceScheduler(const DeviceScheduler &) = delete;
+    DeviceScheduler &operator=(const DeviceScheduler &) = delete;
+
+    void submit(std::uint64_t device, Task task);
+    // Blocks until every submitted task has finished. Rethrows the first
+    // exception thrown by a task.
+    void wait();
+    // True when no task is queued or running; a snapshot for polling callers.
+    bool isIdle() const { return m_pending.load() == 0; }
+    // Blocks while maxPending or more tasks are queued or running, so a
+    // producer that outpaces the devices holds a bounded backlog. Must not be
+    // called from a task.
+    void waitForRoom(std::size_t maxPending);
+
+private:
+    struct DeviceQueue {
+        std::deque<Task> tasks;
+        std::condition_variable wakeup;
+        std::vector<std::thread> workers;
+    };
+
+    void run(DeviceQueue &queue);
+    void finishTask();
+
+    DeviceConcurrency m_concurrency;
+    std::mutex m_mutex;
+    std::condition_variable m_idle;
+    std::condition_variable m_room;
+    std::atomic<unsigned> m_roomWaiters{0};
+    std::unordered_map<std::uint64_t, std::unique_ptr<DeviceQueue>> m_queues;
+    std::atomic<std::size_t> m_pending{0};
+    std::exception_ptr m_error;
+    bool m_stopping = false;
+};
+
+}
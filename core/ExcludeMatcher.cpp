@@ -0,0 +1,288 @@
+#include "ExcludeMatcher.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <string_view>
+
+namespace core {
+
+namespace {
+
+using Bits = std::vector<std::uint64_t>;
+
+inline void setBit(Bits &bits, std::size_t index) {
+    bits[index / 64] |= std::uint64_t{1} << (index % 64);
+}
+
+// Calls visit(component) for every component of path until it returns
+// false. An absolute path starts with an empty component, so "/a" and "a"
+// take different branches of the trie. Returns false when visit did.
+template <typename Visit>
+bool forEachComponent(std::string_view path, Visit visit) {
+    std::size_t start = 0;
+    if (!path.empty() && path.front() == '/') {
+        if (!visit(std::string_view())) {
+            return false;
+        }
+        start = 1;
+    }
+    while (start < path.size()) {
+        std::size_t end = path.find('/', start);
+        if (end == std::string_view::npos) {
+            end = path.size();
+        }
+        if (end > start && !visit(path.substr(start, end - start))) {
+            return false;
+        }
+        start = end + 1;
+    }
+    return true;
+}
+
+std::string normalizedRule(const std::string &pattern) {
+    std::string normalized = std::filesystem::path(pattern).lexically_normal().generic_string();
+    while (normalized.size() > 1 && normalized.back() == '/') {
+        normalized.pop_back();
+    }
+    return normalized;
+}
+
+}
+
+ExcludeMatcher::ExcludeMatcher(const std::vector<ExcludeRule> &rules, bool caseInsensitiveGlobs)
+    : m_caseInsensitive(caseInsensitiveGlobs) {
+    for (const auto &rule : rules) {
+        if (rule.pattern.empty()) {
+            continue;
+        }
+        if (rule.type == ExcludeType::Path) {
+            addPath(rule.pattern);
+        } else {
+            addGlob(rule.pattern);
+        }
+    }
+}
+
+unsigned char ExcludeMatcher::fold(unsigned char ch) const {
+    return m_caseInsensitive && ch >= 'A' && ch <= 'Z' ? static_cast<unsigned char>(ch - 'A' + 'a') : ch;
+}
+
+void ExcludeMatcher::addPath(const std::string &pattern) {
+    const std::string normalized = normalizedRule(pattern);
+    if (normalized.empty() || normalized == ".") {
+        return;
+    }
+    std::size_t node = 0;
+    forEachComponent(normalized, [&](std::string_view component) {
+        auto &children = m_nodes[node].children;
+        auto it = std::lower_bound(children.begin(), children.end(), component,
+                                   [](const auto &child, std::string_view key) { return child.first < key; });
+        if (it == children.end() || it->first != component) {
+            it = children.emplace(it, std::string(component), m_nodes.size());
+            const std::size_t child = it->second;
+            m_nodes.emplace_back();
+            node = child;
+        } else {
+            node = it->second;
+        }
+        return true;
+    });
+    m_nodes[node].terminal = true;
+}
+
+// "*" runs are collapsed; a '[' without its ']' is taken literally.
+void ExcludeMatcher::addGlob(const std::string &pattern) {
+    if (pattern.find_first_of("*?[") == std::string::npos) {
+        std::string name;
+        name.reserve(pattern.size());
+        for (const char ch : pattern) {
+            name += static_cast<char>(fold(static_cast<unsigned char>(ch)));
+        }
+        m_names.insert(std::move(name));
+        return;
+    }
+
+    m_starts.push_back(m_states.size());
+    for (std::size_t i = 0; i < pattern.size(); ++i) {
+        const auto ch = static_cast<unsigned char>(pattern[i]);
+        GlobState state;
+        if (ch == '*') {
+            if (!m_states.empty() && m_states.size() > m_starts.back() && m_states.back().kind == GlobState::Star) {
+                continue;
+            }
+            state.kind = GlobState::Star;
+        } else if (ch == '?') {
+            state.kind = GlobState::AnyChar;
+        } else if (ch == '[' && pattern.find(']', i + 2) != std::string::npos) {
+            std::size_t j = i + 1;
+            const bool negated = pattern[j] == '!' || pattern[j] == '^';
+            if (negated) {
+                ++j;
+            }
+            std::array<std::uint64_t, 4> set{};
+            auto add = [&set](unsigned char byte) { set[byte / 64] |= std::uint64_t{1} << (byte % 64); };
+            // A ']' right after the opening bracket is a member.
+            const std::size_t first = j;
+            for (; j < pattern.size() && (pattern[j] != ']' || j == first); ++j) {
+                auto low = static_cast<unsigned char>(pattern[j]);
+                auto high = low;
+                if (j + 2 < pattern.size() && pattern[j + 1] == '-' && pattern[j + 2] != ']') {
+                    high = static_cast<unsigned char>(pattern[j + 2]);
+                    j += 2;
+                }
+                for (unsigned byte = low; byte <= high; ++byte) {
+                    add(static_cast<unsigned char>(byte));
+                    add(fold(static_cast<unsigned char>(byte)));
+                }
+            }
+            if (j == pattern.size()) {
+                state.kind = GlobState::Literal;
+                state.ch = fold(ch);
+                m_states.push_back(state);
+                continue;
+            }
+            if (negated) {
+                for (auto &word : set) {
+                    word = ~word;
+                }
+            }
+            state.kind = GlobState::CharSet;
+            state.set = static_cast<std::uint32_t>(m_sets.size());
+            m_sets.push_back(set);
+            i = j;
+        } else {
+            state.kind = GlobState::Literal;
+            state.ch = fold(ch);
+        }
+        m_states.push_back(state);
+    }
+    m_states.push_back(GlobState{});
+}
+
+bool ExcludeMatcher::excludes(const std::string &path) const {
+    if (m_nodes[0].children.empty() && m_names.empty() && m_states.empty()) {
+        return false;
+    }
+    if (underPathRule(path)) {
+        return true;
+    }
+    const auto slash = path.find_last_of('/');
+    return matchesGlob(slash == std::string::npos ? path : path.substr(slash + 1));
+}
+
+bool ExcludeMatcher::underPathRule(const std::string &path) const {
+    if (m_nodes[0].children.empty()) {
+        return false;
+    }
+    std::size_t node = 0;
+    bool found = false;
+    forEachComponent(path, [&](std::string_view component) {
+        const auto &children = m_nodes[node].children;
+        const auto it = std::lower_bound(children.begin(), children.end(), component,
+                                         [](const auto &child, std::string_view key) { return child.first < key; });
+        if (it == children.end() || it->first != component) {
+            return false;
+        }
+        node = it->second;
+        found = m_nodes[node].terminal;
+        return !found;
+    });
+    return found;
+}
+
+// Runs every glob at once: bit s of the state set is on while glob state s
+// can still lead to a match. A Star state keeps itself alive and, being
+// optional, also enables the state after it.
+bool ExcludeMatcher::matchesGlob(const std::string &name) const {
+    if (!m_names.empty()) {
+        if (!m_caseInsensitive) {
+            if (m_names.count(name) > 0) {
+                return true;
+            }
+        } else {
+            std::string folded(name.size(), '\0');
+            std::transform(name.begin(), name.end(), folded.begin(),
+                           [this](char ch) { return static_cast<char>(fold(static_cast<unsigned char>(ch))); });
+            if (m_names.count(folded) > 0) {
+                return true;
+            }
+        }
+    }
+    if (m_states.empty()) {
+        return false;
+    }
+
+    const std::size_t words = (m_states.size() + 63) / 64;
+    auto close = [this, words](Bits &bits) {
+        for (std::size_t word = 0; word < words; ++word) {
+            for (std::uint64_t pending = bits[word]; pending != 0; pending &= pending - 1) {
+                const std::size_t state = word * 64 + static_cast<std::size_t>(__builtin_ctzll(pending));
+                if (m_states[state].kind == GlobState::Star) {
+                    setBit(bits, state + 1);
+                    if ((state + 1) / 64 == word) {
+                        pending |= std::uint64_t{1} << ((state + 1) % 64);
+                    }
+                }
+            }
+        }
+    };
+
+    thread_local Bits current;
+    thread_local Bits next;
+    current.assign(words, 0);
+    for (const std::size_t start : m_starts) {
+        setBit(current, start);
+    }
+    close(current);
+
+    for (const char raw : name) {
+        const unsigned char ch = fold(static_cast<unsigned char>(raw));
+        next.assign(words, 0);
+        bool alive = false;
+        for (std::size_t word = 0; word < words; ++word) {
+            for (std::uint64_t pending = current[word]; pending != 0; pending &= pending - 1) {
+                const std::size_t state = word * 64 + static_cast<std::size_t>(__builtin_ctzll(pending));
+                const GlobState &glob = m_states[state];
+                bool advance = false;
+                switch (glob.kind) {
+                case GlobState::Star:
+                    setBit(next, state);
+                    alive = true;
+                    break;
+                case GlobState::Literal:
+                    advance = glob.ch == ch;
+                    break;
+                case GlobState::AnyChar:
+                    advance = true;
+                    break;
+                case GlobState::CharSet:
+                    advance = (m_sets[glob.set][ch / 64] >> (ch % 64)) & 1;
+                    break;
+                case GlobState::Accept:
+                    break;
+                }
+                if (advance) {
+                    setBit(next, state + 1);
+                    alive = true;
+                }
+            }
+        }
+        if (!alive) {
+            return false;
+        }
+        close(next);
+        current.swap(next);
+    }
+
+    for (std::size_t word = 0; word < words; ++word) {
+        for (std::uint64_t pending = current[word]; pending != 0; pending &= pending - 1) {
+            const std::size_t state = word * 64 + static_cast<std::size_t>(__builtin_ctzll(pending));
+            if (m_states[state].kind == GlobState::Accept) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+} // namespace core
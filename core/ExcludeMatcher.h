@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Config.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace core {
+
+// A set of exclusion rules compiled once for many lookups. Path rules go
+// into a trie of path components: a path is excluded when it is a rule or
+// lies below one. Glob rules (*, ?, [...] with ! or ^ for negation) are
+// matched against the last component only; names without wildcards land in
+// a hash set, the others are merged into one NFA that is run over the name
+// a single time for all of them.
+//
+// Paths are expected normalized, as the walkers produce them ('/'
+// separators, no "." or ".." components). A walker that asks before
+// descending can skip an excluded directory as a whole. excludes() is
+// const and safe to call from several threads.
+class ExcludeMatcher {
+public:
+    ExcludeMatcher() = default;
+    // With caseInsensitiveGlobs, globs compare ASCII letters without case.
+    explicit ExcludeMatcher(const std::vector<ExcludeRule> &rules, bool caseInsensitiveGlobs = false);
+
+    bool excludes(const std::string &path) const;
+    bool empty() const { return m_nodes.size() <= 1 && m_names.empty() && m_states.empty(); }
+
+private:
+    struct TrieNode {
+        std::vector<std::pair<std::string, std::size_t>> children; // sorted by component
+        bool terminal = false;
+    };
+
+    struct GlobState {
+        enum Kind : std::uint8_t { Literal, AnyChar, Star, CharSet, Accept };
+        Kind kind = Accept;
+        unsigned char ch = 0;
+        std::uint32_t set = 0; // index into m_sets for CharSet
+    };
+
+    void addPath(const std::string &pattern);
+    void addGlob(const std::string &pattern);
+    bool underPathRule(const std::string &path) const;
+    bool matchesGlob(const std::string &name) const;
+    unsigned char fold(unsigned char ch) const;
+
+    std::vector<TrieNode> m_nodes = std::vector<TrieNode>(1); // [0] is the root
+    std::unordered_set<std::string> m_names;
+    std::vector<GlobState> m_states;
+    std::vector<std::size_t> m_starts;                // first state of every glob
+    std::vector<std::array<std::uint64_t, 4>> m_sets; // 256-bit byte sets
+    bool m_caseInsensitive = false;
+};
+
+}
@@ -1,5 +1,7 @@
 #include "FileIntegrityEngine.h"
 
+#include "OwnerNameCache.h"
+
 #include <algorithm>
 #include <unordered_map>
 
@@ -19,9 +21,12 @@ ScanResult FileIntegrityEngine::runScan() {
         return result;
     }
 
-    FileScanner scanner(m_config, *m_hasher);
-    auto newState = scanner.scan();
+    // The baseline is loaded first so an incremental scan can reuse its hashes.
     auto oldState = m_storage->loadCurrentState();
+    const std::uint64_t scanCycle =
+        m_config.fastIncremental && m_config.fullRehashCycle > 0 ? m_storage->nextScanCycle() : 0;
+    FileScanner scanner(m_config, *m_hasher);
+    auto newState = scanner.scan(oldState, scanCycle);
     auto summary = compareAndPersist(newState, oldState);
     m_cachedState = std::move(newState);
     result.files = m_cachedState;
@@ -49,6 +54,20 @@ ScanSummary FileIntegrityEngine::compareAndPersist(const std::vector<FileMetadat
 
     std::vector<FileMetadata> merged = newState;
 
+    // Every row is stored with its owner names. A file whose ids did not
+    // change keeps the names of its old row; the others are looked up, once
+    // per id for the scan.
+    OwnerNameCache ownerNames;
+    auto resolveOwner = [&ownerNames](FileMetadata &meta, const FileMetadata *oldMeta) {
+        if (oldMeta && oldMeta->uid == meta.uid && oldMeta->gid == meta.gid && !oldMeta->owner.empty()) {
+            meta.owner = oldMeta->owner;
+            meta.group = oldMeta->group;
+            return;
+        }
+        meta.owner = ownerNames.userName(meta.uid);
+        meta.group = ownerNames.groupName(meta.gid);
+    };
+
     for (auto &meta : merged) {
         summary.totalFiles++;
         const auto it = oldByPath.find(meta.path);
@@ -60,6 +79,7 @@ ScanSummary FileIntegrityEngine::compareAndPersist(const std::vector<FileMetadat
             oldHash = it->second.hash;
             hasOld = true;
         }
+        resolveOwner(meta, hasOld ? &it->second : nullptr);
 
         if (meta.hash.empty()) {
             meta.status = FileStatus::Error;
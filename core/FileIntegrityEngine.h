@@ -5,6 +5,7 @@
 #include "IStorage.h"
 #include "ScanSummary.h"
 
+#include <cstdint>
 #include <memory>
 #include <vector>
 
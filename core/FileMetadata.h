@@ -14,9 +14,16 @@ struct FileMetadata {
     std::uint64_t size = 0;
     std::chrono::system_clock::time_point mtime{};
     std::uint64_t permissions = 0;
+    std::uint32_t uid = 0;
+    std::uint32_t gid = 0;
+    // Names of uid and gid. The scanner leaves them empty; they are looked up
+    // when the row is compared and stored, see FileIntegrityEngine.
     std::string owner;
     std::string group;
     std::uint64_t inode = 0;
+    std::uint64_t device = 0;
+    std::int64_t mtimeNs = 0;
+    std::int64_t ctimeNs = 0;
     FileStatus status = FileStatus::Ok;
 };
 
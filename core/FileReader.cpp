@@ -0,0 +1,211 @@
+#include "FileReader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csetjmp>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <mutex>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace core {
+
+namespace {
+
+constexpr std::size_t kDirectAlignment = 4096;
+
+// Set while the thread reads from a mapping; the SIGBUS handler jumps back
+// there instead of killing the process.
+thread_local sigjmp_buf *t_mappedReadJump = nullptr;
+struct sigaction g_previousSigbus {};
+std::once_flag g_sigbusOnce;
+
+void handleSigbus(int signal, siginfo_t *info, void *context) {
+    if (t_mappedReadJump) {
+        siglongjmp(*t_mappedReadJump, 1);
+    }
+    // Not ours: hand over to whatever was installed before.
+    if (g_previousSigbus.sa_flags & SA_SIGINFO) {
+        g_previousSigbus.sa_sigaction(signal, info, context);
+        return;
+    }
+    if (g_previousSigbus.sa_handler != SIG_DFL && g_previousSigbus.sa_handler != SIG_IGN) {
+        g_previousSigbus.sa_handler(signal);
+        return;
+    }
+    ::sigaction(SIGBUS, &g_previousSigbus, nullptr);
+    ::raise(SIGBUS);
+}
+
+void installSigbusHandler() {
+    std::call_once(g_sigbusOnce, [] {
+        struct sigaction action {};
+        action.sa_sigaction = handleSigbus;
+        action.sa_flags = SA_SIGINFO | SA_NODEFER;
+        sigemptyset(&action.sa_mask);
+        ::sigaction(SIGBUS, &action, &g_previousSigbus);
+    });
+}
+
+// Kept out of readFile() so that no object with a destructor lives in the
+// frame siglongjmp() returns to.
+int feedMapping(const unsigned char *data, std::size_t size, std::size_t slice, const FileChunkSink &sink) {
+    sigjmp_buf jump;
+    if (sigsetjmp(jump, 0) != 0) {
+        t_mappedReadJump = nullptr;
+        return EIO;
+    }
+    t_mappedReadJump = &jump;
+    for (std::size_t done = 0; done < size; done += slice) {
+        sink(data + done, std::min(slice, size - done));
+    }
+    t_mappedReadJump = nullptr;
+    return 0;
+}
+
+// slice == 0 hands the whole mapping over in one call.
+int readMapped(int fd, std::uint64_t offset, std::size_t size, std::size_t slice, const FileChunkSink &sink) {
+    void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, static_cast<off_t>(offset));
+    if (mapping == MAP_FAILED) {
+        return -1;
+    }
+    ::madvise(mapping, size, MADV_SEQUENTIAL);
+    installSigbusHandler();
+    const int error =
+        feedMapping(static_cast<const unsigned char *>(mapping), size, slice > 0 ? slice : size, sink);
+    ::munmap(mapping, size);
+    return error;
+}
+
+struct FreeDeleter {
+    void operator()(unsigned char *buffer) const { std::free(buffer); }
+};
+
+// Aligned so the same buffer serves O_DIRECT reads.
+int readBuffered(int fd, std::uint64_t offset, std::uint64_t length, std::size_t bufferSize, const FileChunkSink &sink) {
+    thread_local std::unique_ptr<unsigned char, FreeDeleter> buffer;
+    thread_local std::size_t capacity = 0;
+    bufferSize = (bufferSize + kDirectAlignment - 1) / kDirectAlignment * kDirectAlignment;
+    if (capacity < bufferSize) {
+        buffer.reset(static_cast<unsigned char *>(std::aligned_alloc(kDirectAlignment, bufferSize)));
+        capacity = buffer ? bufferSize : 0;
+        if (!buffer) {
+            return ENOMEM;
+        }
+    }
+    while (length > 0) {
+        const auto request = static_cast<std::size_t>(std::min<std::uint64_t>(bufferSize, length));
+        const ssize_t bytesRead = ::pread(fd, buffer.get(), request, static_cast<off_t>(offset));
+        if (bytesRead < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+#ifdef O_DIRECT
+            // Some filesystems accept O_DIRECT at open and refuse the read.
+            const int flags = ::fcntl(fd, F_GETFL);
+            if (errno == EINVAL && flags >= 0 && (flags & O_DIRECT)) {
+                ::fcntl(fd, F_SETFL, flags & ~O_DIRECT);
+                continue;
+            }
+#endif
+            return errno;
+        }
+        if (bytesRead == 0) {
+            return 0;
+        }
+        sink(buffer.get(), static_cast<std::size_t>(bytesRead));
+        offset += static_cast<std::uint64_t>(bytesRead);
+        length -= static_cast<std::uint64_t>(bytesRead);
+    }
+    return 0;
+}
+
+}
+
+int openForReading(const std::string &path, CachePolicy cachePolicy) {
+    int flags = O_RDONLY | O_CLOEXEC | O_NOCTTY;
+#ifdef O_DIRECT
+    if (cachePolicy == CachePolicy::Direct) {
+        flags |= O_DIRECT;
+    }
+#else
+    (void)cachePolicy;
+#endif
+    int fd;
+    do {
+        fd = ::open(path.c_str(), flags);
+    } while (fd < 0 && errno == EINTR);
+#ifdef O_DIRECT
+    // tmpfs and a few others refuse O_DIRECT outright.
+    if (fd < 0 && errno == EINVAL && (flags & O_DIRECT)) {
+        return openForReading(path, CachePolicy::DropBehind);
+    }
+#endif
+    return fd;
+}
+
+void prefetchFile(const std::string &path) {
+    const int fd = openForReading(path, CachePolicy::Keep);
+    if (fd < 0) {
+        return;
+    }
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    ::close(fd);
+}
+
+void releaseCachedPages(int fd, CachePolicy cachePolicy) {
+    if (cachePolicy != CachePolicy::Keep) {
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    }
+}
+
+int readFile(const std::string &path, const FileChunkSink &sink, const FileReaderOptions &options) {
+    return readFileRange(path, 0, std::numeric_limits<std::uint64_t>::max(), sink, options);
+}
+
+int readFileRange(const std::string &path,
+                  std::uint64_t offset,
+                  std::uint64_t length,
+                  const FileChunkSink &sink,
+                  const FileReaderOptions &options) {
+    const int fd = openForReading(path, options.cachePolicy);
+    if (fd < 0) {
+        return errno;
+    }
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        const int error = errno;
+        ::close(fd);
+        return error;
+    }
+
+    const auto fileSize = static_cast<std::uint64_t>(st.st_size);
+    const std::uint64_t available = offset < fileSize ? std::min(length, fileSize - offset) : 0;
+    const auto pageSize = static_cast<std::uint64_t>(::sysconf(_SC_PAGESIZE));
+    const std::size_t bufferSize = options.bufferSize > 0 ? options.bufferSize : FileReaderOptions{}.bufferSize;
+    int error = -1;
+    if (options.cachePolicy != CachePolicy::Direct && S_ISREG(st.st_mode) && available > 0
+        && available >= options.mmapThreshold && available <= SIZE_MAX && offset % pageSize == 0) {
+        error = readMapped(fd, offset, static_cast<std::size_t>(available), options.throttled ? bufferSize : 0, sink);
+    }
+    if (error < 0) {
+        error = readBuffered(fd, offset, length, bufferSize, sink);
+    }
+    if (options.cachePolicy != CachePolicy::Keep) {
+        // A length of 0 means up to the end of the file.
+        const std::uint64_t advised = length > fileSize - std::min(offset, fileSize) ? 0 : length;
+        ::posix_fadvise(fd, static_cast<off_t>(offset), static_cast<off_t>(advised), POSIX_FADV_DONTNEED);
+    }
+    ::close(fd);
+    return error;
+}
+
+} // namespace core
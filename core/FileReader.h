@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace core {
+
+// What reading a file leaves behind in the page cache. Background scans use
+// the last two so they do not evict the working set of the host.
+enum class CachePolicy {
+    Keep,       // plain cached reads
+    DropBehind, // POSIX_FADV_DONTNEED once a file is read
+    Direct,     // O_DIRECT where the filesystem supports it, DropBehind elsewhere
+};
+
+struct FileReaderOptions {
+    std::uint64_t mmapThreshold = 1024 * 1024; // regular files at least this big are mapped
+    std::size_t bufferSize = 256 * 1024;        // read() buffer for smaller files
+    CachePolicy cachePolicy = CachePolicy::Keep;
+    // Set when the sink throttles (e.g. with a ReadThrottle): a mapping is
+    // then handed over in bufferSize slices, so each slice is charged before
+    // its pages are faulted in rather than the whole file up front.
+    bool throttled = false;
+};
+
+// Gets the file content in order; the data is only valid during the call.
+using FileChunkSink = std::function<void(const unsigned char *data, std::size_t size)>;
+
+// Passes the whole content of path to sink and returns 0, or an errno value.
+//
+// Files of at least mmapThreshold bytes are mapped with MADV_SEQUENTIAL and
+// handed over without a copy into user space, in one call unless throttled. Smaller files (and any file
+// mmap refuses) are read into a buffer owned by the calling thread and reused
+// across calls, so no allocation happens per file.
+//
+// A mapped file truncated by someone else while it is being read raises
+// SIGBUS; that is caught for the reading thread and reported as EIO, and the
+// sink has then seen a partial file. Other SIGBUS signals keep their previous
+// disposition.
+//
+// With CachePolicy::Direct nothing is mapped; reads go through an aligned
+// buffer (bufferSize rounded up to 4 KiB).
+int readFile(const std::string &path, const FileChunkSink &sink, const FileReaderOptions &options = {});
+
+// readFile() restricted to at most length bytes starting at offset. The
+// range is only mapped when offset is page aligned.
+int readFileRange(const std::string &path,
+                  std::uint64_t offset,
+                  std::uint64_t length,
+                  const FileChunkSink &sink,
+                  const FileReaderOptions &options = {});
+
+// Opens the file descriptor the way readFile() does for the given policy:
+// with O_DIRECT for CachePolicy::Direct unless the filesystem refuses it.
+// Returns -1 with errno set on failure.
+int openForReading(const std::string &path, CachePolicy cachePolicy);
+
+// Tells the kernel the file is about to be read (POSIX_FADV_WILLNEED), so its
+// readahead overlaps with hashing the file before it.
+void prefetchFile(const std::string &path);
+
+// Drops the file's clean pages from the page cache unless the policy is Keep.
+void releaseCachedPages(int fd, CachePolicy cachePolicy);
+
+}
@@ -1,129 +1,183 @@
 #include "FileScanner.h"
 
+#include "ExcludeMatcher.h"
+#include "ParallelWalker.h"
+#include "Sha256Hasher.h"
+#include "SystemInfo.h"
+
+#include <algorithm>
+#include <deque>
 #include <filesystem>
-#include <sys/stat.h>
-#include <pwd.h>
-#include <grp.h>
-#include <set>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
 
 namespace core {
 
-FileScanner::FileScanner(Config config, IHasher &hasher) : m_config(std::move(config)), m_hasher(hasher) {}
+namespace {
 
-bool FileScanner::isExcluded(const std::filesystem::path &path) const {
-    const auto normalized = std::filesystem::weakly_canonical(path).string();
-    const auto fileName = path.filename().string();
+// Small files handed to IHasher::computeBatch() at a time.
+constexpr std::size_t kSmallFileBatch = 32;
 
-    for (const auto &rule : m_config.excludeRules) {
-        switch (rule.type) {
-        case ExcludeType::Path:
-            if (normalized.rfind(rule.pattern, 0) == 0) {
-                return true;
-            }
-            break;
-        case ExcludeType::Glob:
-            if (!rule.pattern.empty()) {
-                const auto &p = rule.pattern;
-                if (p.front() == '*' && p.back() == '*') {
-                    const auto needle = p.substr(1, p.size() - 2);
-                    if (fileName.find(needle) != std::string::npos) {
-                        return true;
-                    }
-                } else if (p.front() == '*') {
-                    const auto needle = p.substr(1);
-                    if (fileName.size() >= needle.size() && fileName.compare(fileName.size() - needle.size(), needle.size(), needle) == 0) {
-                        return true;
-                    }
-                } else if (p.back() == '*') {
-                    const auto needle = p.substr(0, p.size() - 1);
-                    if (fileName.rfind(needle, 0) == 0) {
-                        return true;
-                    }
-                } else if (fileName == p) {
-                    return true;
-                }
-            }
-            break;
-        }
+bool sameFingerprint(const FileMetadata &current, const FileMetadata &baseline) {
+    return current.device == baseline.device && current.inode == baseline.inode && current.size == baseline.size
+        && current.mtimeNs == baseline.mtimeNs && current.ctimeNs == baseline.ctimeNs;
+}
+
+bool trustedBaseline(const FileMetadata &meta) {
+    return !meta.hash.empty() && (meta.mtimeNs != 0 || meta.ctimeNs != 0) && meta.status != FileStatus::Error
+        && meta.status != FileStatus::Deleted;
+}
+
+// FNV-1a, so a path lands in the same rotation slot on every run.
+std::uint64_t stableHash(const std::string &text) {
+    std::uint64_t hash = 14695981039346656037ull;
+    for (const unsigned char ch : text) {
+        hash = (hash ^ ch) * 1099511628211ull;
     }
-    return false;
+    return hash;
+}
+
 }
 
-FileMetadata FileScanner::buildMetadata(const std::filesystem::directory_entry &entry) const {
+FileScanner::FileScanner(Config config, IHasher &hasher) : m_config(std::move(config)), m_hasher(hasher) {}
+
+FileMetadata FileScanner::buildMetadata(const WalkEntry &entry) const {
     FileMetadata meta;
-    const auto path = entry.path();
-    meta.path = path.string();
-    meta.size = entry.file_size();
-    const auto ftime = entry.last_write_time();
-    const auto sctp = std::chrono::time_point_cast<std::chrono::system_clock::duration>(
-        ftime - decltype(ftime)::clock::now() + std::chrono::system_clock::now());
-    meta.mtime = sctp;
-    meta.permissions = static_cast<std::uint64_t>(entry.status().permissions());
-
-#ifdef __unix__
-    struct stat st{};
-    if (::stat(path.c_str(), &st) == 0) {
-        meta.inode = static_cast<std::uint64_t>(st.st_ino);
-        if (auto *pwd = ::getpwuid(st.st_uid)) {
-            meta.owner = pwd->pw_name;
-        }
-        if (auto *grp = ::getgrgid(st.st_gid)) {
-            meta.group = grp->gr_name;
-        }
+    meta.path = entry.path;
+    meta.size = entry.size;
+    meta.mtime = std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(entry.mtimeNs)));
+    meta.permissions = entry.mode & 07777;
+    meta.inode = entry.inode;
+    meta.device = entry.device;
+    meta.mtimeNs = entry.mtimeNs;
+    meta.ctimeNs = entry.ctimeNs;
+    meta.uid = entry.uid;
+    meta.gid = entry.gid;
+    return meta;
+}
+
+unsigned FileScanner::threadCount() const {
+    if (m_config.scanThreads > 0) {
+        return static_cast<unsigned>(m_config.scanThreads);
     }
-#endif
+    return availableCpuCount();
+}
 
-    meta.hash = m_hasher.compute(path);
-    return meta;
+bool FileScanner::inRotationSlot(const std::string &path, std::uint64_t scanCycle) const {
+    if (m_config.fullRehashCycle <= 0) {
+        return false;
+    }
+    const auto cycle = static_cast<std::uint64_t>(m_config.fullRehashCycle);
+    return stableHash(path) % cycle == scanCycle % cycle;
 }
 
-std::vector<FileMetadata> FileScanner::scan() const {
-    std::vector<FileMetadata> files;
-    for (const auto &dir : m_config.directories) {
-        std::filesystem::path base(dir);
-        if (!std::filesystem::exists(base) || !std::filesystem::is_directory(base)) {
-            continue;
+std::vector<FileMetadata> FileScanner::scan(const std::vector<FileMetadata> &baseline, std::uint64_t scanCycle) const {
+    // Read-only after this point, so walker threads look it up without locking.
+    std::unordered_map<std::string, const FileMetadata *> baselineByPath;
+    if (m_config.fastIncremental) {
+        baselineByPath.reserve(baseline.size());
+        for (const auto &meta : baseline) {
+            if (trustedBaseline(meta)) {
+                baselineByPath.emplace(meta.path, &meta);
+            }
         }
+    }
 
-        auto options = std::filesystem::directory_options::skip_permission_denied;
-        if (m_config.followSymlinks) {
-            options |= std::filesystem::directory_options::follow_directory_symlink;
-        }
+    // Slots and walkers must outlive the pool: its destructor drains queued
+    // tasks that still reference them.
+    std::mutex slotsMutex;
+    std::deque<FileMetadata> slots;
+    std::vector<FileMetadata *> smallFiles; // guarded by slotsMutex
+    std::vector<std::unique_ptr<ParallelWalker>> walkers;
+    WorkStealingPool pool(threadCount());
 
-        if (m_config.recursive) {
-            std::set<std::string> visited;
-            for (auto it = std::filesystem::recursive_directory_iterator(base, options); it != std::filesystem::recursive_directory_iterator(); ++it) {
-                if (m_config.maxDepth >= 0 && it.depth() > m_config.maxDepth) {
-                    it.disable_recursion_pending();
-                    continue;
-                }
-                if (it->is_directory()) {
-                    const auto canonical = std::filesystem::weakly_canonical(it->path()).string();
-                    if (!visited.insert(canonical).second) {
-                        it.disable_recursion_pending();
-                    }
-                    continue;
-                }
-                if (!it->is_regular_file()) {
-                    continue;
-                }
-                if (isExcluded(it->path())) {
-                    continue;
-                }
-                files.push_back(buildMetadata(*it));
+    auto submitSmallFiles = [&](std::vector<FileMetadata *> batch) {
+        pool.submit([this, batch = std::move(batch)]() {
+            std::vector<std::filesystem::path> paths;
+            paths.reserve(batch.size());
+            for (const FileMetadata *slot : batch) {
+                paths.emplace_back(slot->path);
             }
-        } else {
-            for (const auto &entry : std::filesystem::directory_iterator(base, options)) {
-                if (!entry.is_regular_file()) {
-                    continue;
-                }
-                if (isExcluded(entry.path())) {
-                    continue;
+            std::vector<std::string> hashes = m_hasher.computeBatch(paths);
+            for (std::size_t i = 0; i < batch.size() && i < hashes.size(); ++i) {
+                batch[i]->hash = std::move(hashes[i]);
+            }
+        });
+    };
+
+    // Directory tasks build the metadata; hashing goes back onto the pool as a
+    // separate task so one huge directory still spreads across workers.
+    auto enqueue = [&](const WalkEntry &entry) {
+        auto meta = buildMetadata(entry);
+        const auto it = baselineByPath.find(meta.path);
+        const bool reuse = it != baselineByPath.end() && sameFingerprint(meta, *it->second)
+            && !inRotationSlot(meta.path, scanCycle);
+        if (reuse) {
+            meta.hash = it->second->hash;
+        }
+        const bool small = meta.size < kSmallFileBytes;
+        FileMetadata *slot = nullptr;
+        std::vector<FileMetadata *> fullBatch;
+        {
+            std::lock_guard<std::mutex> lock(slotsMutex);
+            slot = &slots.emplace_back(std::move(meta));
+            if (!reuse && small) {
+                smallFiles.push_back(slot);
+                if (smallFiles.size() >= kSmallFileBatch) {
+                    fullBatch.swap(smallFiles);
                 }
-                files.push_back(buildMetadata(entry));
             }
         }
+        if (reuse) {
+            return;
+        }
+        if (!small) {
+            pool.submit([this, slot]() { slot->hash = m_hasher.compute(slot->path); });
+        } else if (!fullBatch.empty()) {
+            submitSmallFiles(std::move(fullBatch));
+        }
+    };
+
+    // Compiled once for the scan. Paths come from the walker as the normalized
+    // root joined with entry names, so they need no per-file resolution, and
+    // an excluded directory is pruned before the walker opens it.
+    const ExcludeMatcher excludeMatcher(m_config.excludeRules);
+    WalkOptions options;
+    options.recursive = m_config.recursive;
+    options.followSymlinks = m_config.followSymlinks;
+    options.maxDepth = m_config.maxDepth;
+    if (!excludeMatcher.empty()) {
+        options.exclude = [&excludeMatcher](const std::string &path) { return excludeMatcher.excludes(path); };
     }
+
+    for (const auto &dir : m_config.directories) {
+        // Lexical only: the root keeps its configured spelling, symlinks
+        // included, so stored paths stay the same as in older baselines.
+        std::error_code ec;
+        auto base = std::filesystem::path(dir).lexically_normal();
+        if (!base.has_filename() && base.has_relative_path()) {
+            base = base.parent_path(); // "/data/" -> "/data"
+        }
+        if (!std::filesystem::is_directory(base, ec) || excludeMatcher.excludes(base.string())) {
+            continue;
+        }
+        // One walker per root keeps the visited set per root, as before.
+        walkers.push_back(std::make_unique<ParallelWalker>(pool, options));
+        walkers.back()->walk(base.string(), enqueue);
+    }
+    pool.wait();
+    if (!smallFiles.empty()) {
+        submitSmallFiles(std::move(smallFiles));
+        pool.wait();
+    }
+
+    std::vector<FileMetadata> files(std::make_move_iterator(slots.begin()), std::make_move_iterator(slots.end()));
+    std::sort(files.begin(), files.end(), [](const FileMetadata &a, const FileMetadata &b) { return a.path < b.path; });
     return files;
 }
 
@@ -3,8 +3,10 @@
 #include "Config.h"
 #include "FileMetadata.h"
 #include "IHasher.h"
+#include "ParallelWalker.h"
 
-#include <filesystem>
+#include <cstdint>
+#include <string>
 #include <vector>
 
 namespace core {
@@ -12,11 +14,15 @@ namespace core {
 class FileScanner {
 public:
     FileScanner(Config config, IHasher &hasher);
-    std::vector<FileMetadata> scan() const;
+    // With Config::fastIncremental, files whose stat fingerprint matches their
+    // baseline entry keep the baseline hash instead of being reread.
+    // scanCycle selects which 1/fullRehashCycle of the files is rehashed anyway.
+    std::vector<FileMetadata> scan(const std::vector<FileMetadata> &baseline = {}, std::uint64_t scanCycle = 0) const;
 
 private:
-    bool isExcluded(const std::filesystem::path &path) const;
-    FileMetadata buildMetadata(const std::filesystem::directory_entry &entry) const;
+    FileMetadata buildMetadata(const WalkEntry &entry) const;
+    unsigned threadCount() const;
+    bool inRotationSlot(const std::string &path, std::uint64_t scanCycle) const;
 
     Config m_config;
     IHasher &m_hasher;
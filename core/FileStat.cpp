@@ -0,0 +1,51 @@
+#include "FileStat.h"
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/sysmacros.h>
+#endif
+
+namespace core {
+
+int statFileAt(int dirfd, const char *name, bool follow, FileStat &stat) {
+#ifdef __linux__
+    struct statx stx {};
+    const int flags = AT_NO_AUTOMOUNT | (follow ? 0 : AT_SYMLINK_NOFOLLOW);
+    if (::statx(dirfd, name, flags, STATX_BASIC_STATS, &stx) != 0) {
+        return errno;
+    }
+    // Encoded like st_dev, so it matches stat() callers and isRotationalDevice().
+    stat.device = static_cast<std::uint64_t>(makedev(stx.stx_dev_major, stx.stx_dev_minor));
+    stat.inode = stx.stx_ino;
+    stat.size = stx.stx_size;
+    stat.hardlinkCount = stx.stx_nlink;
+    stat.mode = stx.stx_mode;
+    stat.uid = stx.stx_uid;
+    stat.gid = stx.stx_gid;
+    stat.mtimeNs = static_cast<std::int64_t>(stx.stx_mtime.tv_sec) * 1000000000 + stx.stx_mtime.tv_nsec;
+    stat.ctimeNs = static_cast<std::int64_t>(stx.stx_ctime.tv_sec) * 1000000000 + stx.stx_ctime.tv_nsec;
+#else
+    struct stat st {};
+    if (::fstatat(dirfd, name, &st, follow ? 0 : AT_SYMLINK_NOFOLLOW) != 0) {
+        return errno;
+    }
+    stat.device = static_cast<std::uint64_t>(st.st_dev);
+    stat.inode = static_cast<std::uint64_t>(st.st_ino);
+    stat.size = static_cast<std::uint64_t>(st.st_size);
+    stat.hardlinkCount = static_cast<std::uint64_t>(st.st_nlink);
+    stat.mode = st.st_mode;
+    stat.uid = st.st_uid;
+    stat.gid = st.st_gid;
+    stat.mtimeNs = static_cast<std::int64_t>(st.st_mtime) * 1000000000;
+    stat.ctimeNs = static_cast<std::int64_t>(st.st_ctime) * 1000000000;
+#endif
+    return 0;
+}
+
+int statFile(const std::string &path, FileStat &stat) { return statFileAt(AT_FDCWD, path.c_str(), false, stat); }
+
+} // namespace core
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace core {
+
+// The inode data the scanners keep per file, from a single stat call.
+struct FileStat {
+    std::uint64_t device = 0; // st_dev encoding
+    std::uint64_t inode = 0;
+    std::uint64_t size = 0;
+    std::uint64_t hardlinkCount = 0;
+    std::uint32_t mode = 0;
+    std::uint32_t uid = 0;
+    std::uint32_t gid = 0;
+    std::int64_t mtimeNs = 0;
+    std::int64_t ctimeNs = 0;
+};
+
+// One statx() of name relative to dirfd (AT_FDCWD for a plain path), or
+// fstatat() where statx is not available. A final symlink is followed only
+// with follow set. Returns 0 or the errno value.
+int statFileAt(int dirfd, const char *name, bool follow, FileStat &stat);
+// statFileAt(AT_FDCWD, path, false, stat): lstat semantics.
+int statFile(const std::string &path, FileStat &stat);
+
+}
@@ -1,14 +1,38 @@
 #pragma once
 
+#include "MultiDigest.h"
+
 #include <filesystem>
 #include <string>
+#include <vector>
 
 namespace core {
 
+// compute() may be called concurrently from the scanner's hashing pool, so
+// implementations must not keep per-call state in members.
 class IHasher {
 public:
     virtual ~IHasher() = default;
     virtual std::string compute(const std::filesystem::path &path) = 0;
+    // The scanner hands small files over in batches; results[i] belongs to
+    // paths[i], empty when the file could not be read. Implementations that
+    // gain nothing from a batch keep this default.
+    virtual std::vector<std::string> computeBatch(const std::vector<std::filesystem::path> &paths) {
+        std::vector<std::string> hashes;
+        hashes.reserve(paths.size());
+        for (const auto &path : paths) {
+            hashes.push_back(compute(path));
+        }
+        return hashes;
+    }
+    // Every digest in the DigestFlag mask from one read of the file; all
+    // members stay empty when it cannot be read. compute()'s own hash is not
+    // part of the set unless it is asked for.
+    virtual DigestSet computeDigests(const std::filesystem::path &path, unsigned digests) {
+        DigestSet result;
+        MultiDigest::hashFile(path.string(), digests, FileReaderOptions(), nullptr, result);
+        return result;
+    }
 };
 
 }
@@ -3,6 +3,7 @@
 #include "FileMetadata.h"
 #include "FileStatus.h"
 
+#include <cstdint>
 #include <vector>
 
 namespace core {
@@ -32,6 +33,9 @@ public:
     virtual void saveCurrentState(const std::vector<FileMetadata> &files) = 0;
     virtual void appendHistoryRecord(const HistoryEvent &rec) = 0;
     virtual std::vector<HistoryEvent> loadHistory(int limit = 500) = 0;
+    // Number of scans counted so far, then counts one more. Kept with the
+    // baseline so the rehash rotation carries over between engine instances.
+    virtual std::uint64_t nextScanCycle() = 0;
 };
 
 }
@@ -0,0 +1,141 @@
+#include "Md5.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace core {
+
+namespace {
+
+constexpr std::uint32_t kInitialState[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+
+// floor(abs(sin(i + 1)) * 2^32)
+constexpr std::uint32_t kRoundConstants[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+};
+
+constexpr unsigned kShifts[4][4] = {
+    {7, 12, 17, 22},
+    {5, 9, 14, 20},
+    {4, 11, 16, 23},
+    {6, 10, 15, 21},
+};
+
+inline std::uint32_t rotateLeft(std::uint32_t value, unsigned bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+inline std::uint32_t loadLittleEndian32(const unsigned char *bytes) {
+    return static_cast<std::uint32_t>(bytes[0]) | (static_cast<std::uint32_t>(bytes[1]) << 8)
+        | (static_cast<std::uint32_t>(bytes[2]) << 16) | (static_cast<std::uint32_t>(bytes[3]) << 24);
+}
+
+inline void storeLittleEndian32(unsigned char *bytes, std::uint32_t value) {
+    bytes[0] = static_cast<unsigned char>(value);
+    bytes[1] = static_cast<unsigned char>(value >> 8);
+    bytes[2] = static_cast<unsigned char>(value >> 16);
+    bytes[3] = static_cast<unsigned char>(value >> 24);
+}
+
+}
+
+Md5::Md5() {
+    std::memcpy(m_state, kInitialState, sizeof(m_state));
+}
+
+void Md5::compress(const unsigned char *blocks, std::size_t count) {
+    for (; count > 0; --count, blocks += kBlockSize) {
+        std::uint32_t m[16];
+        for (int i = 0; i < 16; ++i) {
+            m[i] = loadLittleEndian32(blocks + 4 * i);
+        }
+        std::uint32_t a = m_state[0], b = m_state[1], c = m_state[2], d = m_state[3];
+        for (unsigned i = 0; i < 64; ++i) {
+            const unsigned round = i / 16;
+            std::uint32_t f = 0;
+            unsigned word = 0;
+            switch (round) {
+            case 0:
+                f = (b & c) | (~b & d);
+                word = i;
+                break;
+            case 1:
+                f = (d & b) | (~d & c);
+                word = (5 * i + 1) % 16;
+                break;
+            case 2:
+                f = b ^ c ^ d;
+                word = (3 * i + 5) % 16;
+                break;
+            default:
+                f = c ^ (b | ~d);
+                word = (7 * i) % 16;
+                break;
+            }
+            const std::uint32_t next = b + rotateLeft(a + f + kRoundConstants[i] + m[word], kShifts[round][i % 4]);
+            a = d;
+            d = c;
+            c = b;
+            b = next;
+        }
+        m_state[0] += a;
+        m_state[1] += b;
+        m_state[2] += c;
+        m_state[3] += d;
+    }
+}
+
+void Md5::update(const unsigned char *data, std::size_t size) {
+    if (size == 0) {
+        return;
+    }
+    std::size_t buffered = static_cast<std::size_t>(m_length % kBlockSize);
+    m_length += size;
+    if (buffered > 0) {
+        const std::size_t take = std::min(size, kBlockSize - buffered);
+        std::memcpy(m_buffer + buffered, data, take);
+        data += take;
+        size -= take;
+        buffered += take;
+        if (buffered < kBlockSize) {
+            return;
+        }
+        compress(m_buffer, 1);
+    }
+    const std::size_t blocks = size / kBlockSize;
+    compress(data, blocks);
+    std::memcpy(m_buffer, data + blocks * kBlockSize, size - blocks * kBlockSize);
+}
+
+// Same padding as SHA-256, but the bit length is little endian.
+Md5::Digest Md5::digest() const {
+    Md5 last = *this;
+    unsigned char padding[2 * kBlockSize] = {0x80};
+    const std::size_t buffered = static_cast<std::size_t>(m_length % kBlockSize);
+    const std::size_t padLength = (buffered < 56 ? 56 : 120) - buffered;
+    const std::uint64_t bits = m_length * 8;
+    storeLittleEndian32(padding + padLength, static_cast<std::uint32_t>(bits));
+    storeLittleEndian32(padding + padLength + 4, static_cast<std::uint32_t>(bits >> 32));
+    last.update(padding, padLength + 8);
+
+    Digest digest;
+    for (int i = 0; i < 4; ++i) {
+        storeLittleEndian32(digest.data() + 4 * i, last.m_state[i]);
+    }
+    return digest;
+}
+
+Md5::Digest Md5::hash(const unsigned char *data, std::size_t size) {
+    Md5 md5;
+    md5.update(data, size);
+    return md5.digest();
+}
+
+} // namespace core
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace core {
+
+// Streaming MD5 (RFC 1321). Broken as a security hash; it is only computed
+// so that rows can be matched against legacy MD5 manifests.
+class Md5 {
+public:
+    static constexpr std::size_t kDigestSize = 16;
+    static constexpr std::size_t kBlockSize = 64;
+    using Digest = std::array<unsigned char, kDigestSize>;
+
+    Md5();
+
+    void update(const unsigned char *data, std::size_t size);
+    // Digest of everything fed so far; the hash can still be updated after.
+    Digest digest() const;
+
+    static Digest hash(const unsigned char *data, std::size_t size);
+
+private:
+    void compress(const unsigned char *blocks, std::size_t count);
+
+    std::uint32_t m_state[4];
+    std::uint64_t m_length = 0;
+    unsigned char m_buffer[kBlockSize];
+};
+
+}
@@ -0,0 +1,74 @@
+#include "MultiDigest.h"
+
+#include "ResourceGovernor.h"
+
+namespace core {
+
+namespace {
+
+template <std::size_t Size>
+std::string toHex(const std::array<unsigned char, Size> &digest) {
+    static const char kHex[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(2 * Size);
+    for (const unsigned char byte : digest) {
+        hex += kHex[byte >> 4];
+        hex += kHex[byte & 0xf];
+    }
+    return hex;
+}
+
+}
+
+MultiDigest::MultiDigest(unsigned digests) : m_digests(digests) {}
+
+void MultiDigest::update(const unsigned char *data, std::size_t size) {
+    if (m_digests & DigestSha256) {
+        m_sha256.update(data, size);
+    }
+    if (m_digests & DigestSha512) {
+        m_sha512.update(data, size);
+    }
+    if (m_digests & DigestMd5) {
+        m_md5.update(data, size);
+    }
+}
+
+DigestSet MultiDigest::result() const {
+    DigestSet result;
+    if (m_digests & DigestSha256) {
+        result.sha256 = toHex(m_sha256.digest());
+    }
+    if (m_digests & DigestSha512) {
+        result.sha512 = toHex(m_sha512.digest());
+    }
+    if (m_digests & DigestMd5) {
+        result.md5 = toHex(m_md5.digest());
+    }
+    return result;
+}
+
+int MultiDigest::hashFile(const std::string &path,
+                          unsigned digests,
+                          const FileReaderOptions &options,
+                          ReadThrottle *throttle,
+                          DigestSet &result) {
+    MultiDigest multi(digests);
+    FileReaderOptions readerOptions = options;
+    readerOptions.throttled = readerOptions.throttled || throttle;
+    const int error = readFile(path,
+                               [throttle, &multi](const unsigned char *data, std::size_t size) {
+                                   if (throttle) {
+                                       throttle->acquire(size);
+                                   }
+                                   multi.update(data, size);
+                               },
+                               readerOptions);
+    if (error != 0) {
+        return error;
+    }
+    result = multi.result();
+    return 0;
+}
+
+} // namespace core
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "FileReader.h"
+#include "Md5.h"
+#include "Sha256.h"
+#include "Sha512.h"
+
+#include <string>
+
+namespace core {
+
+class ReadThrottle;
+
+// Digests a single read of a file can feed at once; combine as a bit mask.
+enum DigestFlag : unsigned {
+    DigestSha256 = 1u << 0,
+    DigestSha512 = 1u << 1,
+    DigestMd5 = 1u << 2,
+};
+
+// Lowercase hex; empty for the digests that were not asked for.
+struct DigestSet {
+    std::string sha256;
+    std::string sha512;
+    std::string md5;
+};
+
+// Feeds the same bytes to every digest in the mask, so the extra digests
+// cost CPU time but no further reads.
+class MultiDigest {
+public:
+    explicit MultiDigest(unsigned digests);
+
+    void update(const unsigned char *data, std::size_t size);
+    DigestSet result() const;
+    unsigned digests() const { return m_digests; }
+
+    // Reads path once into every digest in the mask, charging throttle (when
+    // set) for the bytes. Returns 0 or an errno value; result is only
+    // written on success.
+    static int hashFile(const std::string &path,
+                        unsigned digests,
+                        const FileReaderOptions &options,
+                        ReadThrottle *throttle,
+                        DigestSet &result);
+
+private:
+    unsigned m_digests;
+    Sha256 m_sha256;
+    Sha512 m_sha512;
+    Md5 m_md5;
+};
+
+}
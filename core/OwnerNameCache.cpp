@@ -0,0 +1,64 @@
+#include "OwnerNameCache.h"
+
+#include <cerrno>
+#include <vector>
+
+#include <grp.h>
+#include <pwd.h>
+
+namespace core {
+
+namespace {
+
+// Reentrant lookups, sized up until the entry fits.
+std::string lookupUser(uid_t uid) {
+    std::vector<char> buffer(4096);
+    struct passwd pwd {};
+    struct passwd *result = nullptr;
+    int error = 0;
+    while ((error = ::getpwuid_r(uid, &pwd, buffer.data(), buffer.size(), &result)) == ERANGE
+           && buffer.size() < (1u << 20)) {
+        buffer.resize(buffer.size() * 2);
+    }
+    return error == 0 && result ? std::string(result->pw_name) : std::string();
+}
+
+std::string lookupGroup(gid_t gid) {
+    std::vector<char> buffer(4096);
+    struct group grp {};
+    struct group *result = nullptr;
+    int error = 0;
+    while ((error = ::getgrgid_r(gid, &grp, buffer.data(), buffer.size(), &result)) == ERANGE
+           && buffer.size() < (1u << 20)) {
+        buffer.resize(buffer.size() * 2);
+    }
+    return error == 0 && result ? std::string(result->gr_name) : std::string();
+}
+
+}
+
+std::string OwnerNameCache::userName(std::uint32_t uid) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_users.find(uid);
+    if (it == m_users.end()) {
+        it = m_users.emplace(uid, lookupUser(static_cast<uid_t>(uid))).first;
+    }
+    return it->second;
+}
+
+std::string OwnerNameCache::groupName(std::uint32_t gid) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_groups.find(gid);
+    if (it == m_groups.end()) {
+        it = m_groups.emplace(gid, lookupGroup(static_cast<gid_t>(gid))).first;
+    }
+    return it->second;
+}
+
+void OwnerNameCache::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_users.clear();
+    m_groups.clear();
+}
+
+} // namespace core
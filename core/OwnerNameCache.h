@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace core {
+
+// User and group names by id, each looked up through NSS once. Meant to live
+// for one scan, so renamed accounts show up on the next one. Thread-safe.
+// An id without an entry maps to an empty name.
+class OwnerNameCache {
+public:
+    std::string userName(std::uint32_t uid);
+    std::string groupName(std::uint32_t gid);
+    // Forgets every name, e.g. when a new scan starts.
+    void clear();
+
+private:
+    std::mutex m_mutex;
+    std::unordered_map<std::uint32_t, std::string> m_users;
+    std::unordered_map<std::uint32_t, std::string> m_groups;
+};
+
+}
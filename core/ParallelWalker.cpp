@@ -0,0 +1,161 @@
+#include "ParallelWalker.h"
+
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#else
+#include <dirent.h>
+#endif
+
+namespace core {
+
+namespace {
+
+std::string joinPath(const std::string &directory, const char *name) {
+    std::string path;
+    path.reserve(directory.size() + std::strlen(name) + 1);
+    path = directory;
+    if (path.empty() || path.back() != '/') {
+        path += '/';
+    }
+    path += name;
+    return path;
+}
+
+bool isDotOrDotDot(const char *name) {
+    return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+#ifdef __linux__
+struct LinuxDirent64 {
+    std::uint64_t d_ino;
+    std::int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+
+constexpr std::size_t kDentsBufferSize = 64 * 1024;
+#endif
+
+bool statAt(int dirfd, const char *name, bool follow, WalkEntry &entry) {
+    return statFileAt(dirfd, name, follow, entry) == 0;
+}
+
+// Calls fn(name) for every entry of the open directory except "." and "..".
+template <typename Fn>
+void forEachName(int dirfd, Fn &&fn) {
+#ifdef __linux__
+    std::vector<char> buffer(kDentsBufferSize);
+    while (true) {
+        const long read = ::syscall(SYS_getdents64, dirfd, buffer.data(), buffer.size());
+        if (read <= 0) {
+            return;
+        }
+        for (long offset = 0; offset < read;) {
+            const auto *dirent = reinterpret_cast<const LinuxDirent64 *>(buffer.data() + offset);
+            offset += dirent->d_reclen;
+            if (!isDotOrDotDot(dirent->d_name)) {
+                fn(dirent->d_name);
+            }
+        }
+    }
+#else
+    const int ownFd = ::dup(dirfd);
+    DIR *dir = ownFd >= 0 ? ::fdopendir(ownFd) : nullptr;
+    if (!dir) {
+        if (ownFd >= 0) {
+            ::close(ownFd);
+        }
+        return;
+    }
+    while (const auto *dirent = ::readdir(dir)) {
+        if (!isDotOrDotDot(dirent->d_name)) {
+            fn(dirent->d_name);
+        }
+    }
+    ::closedir(dir);
+#endif
+}
+
+}
+
+ParallelWalker::ParallelWalker(WorkStealingPool &pool, WalkOptions options)
+    : m_pool(pool), m_options(options) {}
+
+void ParallelWalker::walk(const std::string &root, FileVisitor visitor) {
+    WalkEntry rootEntry;
+    if (!statAt(AT_FDCWD, root.c_str(), true, rootEntry) || !S_ISDIR(rootEntry.mode)) {
+        return;
+    }
+    if (!markVisited(rootEntry.device, rootEntry.inode)) {
+        return;
+    }
+    auto shared = std::make_shared<FileVisitor>(std::move(visitor));
+    m_pool.submit([this, root, shared]() { walkDirectory(root, 0, shared); });
+}
+
+bool ParallelWalker::markVisited(std::uint64_t device, std::uint64_t inode) {
+    std::lock_guard<std::mutex> lock(m_visitedMutex);
+    return m_visited.emplace(device, inode).second;
+}
+
+void ParallelWalker::walkDirectory(const std::string &directory,
+                                   int depth,
+                                   const std::shared_ptr<FileVisitor> &visitor) {
+    // A directory that vanished or became unreadable mid-scan is skipped
+    // rather than aborting the whole walk. The descriptor is opened by path
+    // (once per directory) so queued subtrees do not pin descriptors.
+    const int dirfd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirfd < 0) {
+        return;
+    }
+
+    const bool descend = m_options.recursive && (m_options.maxDepth < 0 || depth + 1 <= m_options.maxDepth);
+
+    forEachName(dirfd, [&](const char *name) {
+        std::string path = joinPath(directory, name);
+        if (m_options.exclude && m_options.exclude(path)) {
+            return;
+        }
+        WalkEntry entry;
+        if (!statAt(dirfd, name, false, entry)) {
+            return;
+        }
+        if (S_ISLNK(entry.mode)) {
+            // Symlinked files are hashed through the link; symlinked
+            // directories are entered only when following symlinks.
+            if (!statAt(dirfd, name, true, entry)) {
+                return;
+            }
+            if (S_ISDIR(entry.mode) && !m_options.followSymlinks) {
+                return;
+            }
+        }
+
+        if (S_ISDIR(entry.mode)) {
+            if (!descend || !markVisited(entry.device, entry.inode)) {
+                return;
+            }
+            m_pool.submit([this, path = std::move(path), depth, visitor]() {
+                walkDirectory(path, depth + 1, visitor);
+            });
+            return;
+        }
+
+        if (S_ISREG(entry.mode)) {
+            entry.path = std::move(path);
+            (*visitor)(entry);
+        }
+    });
+
+    ::close(dirfd);
+}
+
+} // namespace core
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "FileStat.h"
+#include "WorkStealingPool.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+
+namespace core {
+
+struct WalkOptions {
+    bool recursive = true;
+    bool followSymlinks = false;
+    int maxDepth = 20; // <0 disables the limit
+    // Entries it returns true for are skipped before they are stat'ed; an
+    // excluded directory is never opened. Called concurrently.
+    std::function<bool(const std::string &path)> exclude;
+};
+
+// A regular file found by the walker, with the stat data gathered while
+// walking so consumers need no further path lookups. Symlinks to regular
+// files are reported with the stat of their target.
+struct WalkEntry : FileStat {
+    std::string path;
+};
+
+// Walks a directory tree on a WorkStealingPool. Every directory is one task;
+// subdirectories are queued on the worker that found them, so an idle worker
+// steals a whole subtree at a time. Directories are visited once, keyed by
+// (device, inode), which also breaks symlink loops when following symlinks.
+//
+// On Linux a directory is read with getdents64 on its descriptor and every
+// entry is examined with a single statx relative to it.
+class ParallelWalker {
+public:
+    // Called concurrently from pool threads for every regular file.
+    using FileVisitor = std::function<void(const WalkEntry &entry)>;
+
+    ParallelWalker(WorkStealingPool &pool, WalkOptions options);
+
+    // Queues the walk of root on the pool; call pool.wait() to finish it.
+    void walk(const std::string &root, FileVisitor visitor);
+
+private:
+    void walkDirectory(const std::string &directory, int depth, const std::shared_ptr<FileVisitor> &visitor);
+    bool markVisited(std::uint64_t device, std::uint64_t inode);
+
+    WorkStealingPool &m_pool;
+    WalkOptions m_options;
+    std::mutex m_visitedMutex;
+    std::set<std::pair<std::uint64_t, std::uint64_t>> m_visited;
+};
+
+}
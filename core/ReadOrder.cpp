@@ -0,0 +1,113 @@
+#include "ReadOrder.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
+
+namespace core {
+
+namespace {
+
+struct ReadKey {
+    bool resident = false;
+    std::uint64_t physical = 0;
+    std::uint64_t inode = std::numeric_limits<std::uint64_t>::max();
+};
+
+bool isResident(int fd, std::uint64_t size) {
+    if (size == 0) {
+        return true;
+    }
+    if (size > std::numeric_limits<std::size_t>::max()) {
+        return false;
+    }
+    // Mapping only to ask mincore(); no page is touched, so nothing is read.
+    void *mapping = ::mmap(nullptr, static_cast<std::size_t>(size), PROT_READ, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    const auto pageSize = static_cast<std::uint64_t>(::sysconf(_SC_PAGESIZE));
+    std::vector<unsigned char> pages(static_cast<std::size_t>((size + pageSize - 1) / pageSize));
+    const bool queried = ::mincore(mapping, static_cast<std::size_t>(size), pages.data()) == 0;
+    ::munmap(mapping, static_cast<std::size_t>(size));
+    return queried && std::all_of(pages.begin(), pages.end(), [](unsigned char page) { return page & 1; });
+}
+
+// 0 for files without a mapped extent (empty, inline, tmpfs): reading them
+// does not move the disk head anyway.
+std::uint64_t firstPhysicalOffset(int fd) {
+#ifdef __linux__
+    alignas(struct fiemap) unsigned char request[sizeof(struct fiemap) + sizeof(struct fiemap_extent)] {};
+    auto *map = reinterpret_cast<struct fiemap *>(request);
+    map->fm_start = 0;
+    map->fm_length = FIEMAP_MAX_OFFSET;
+    map->fm_extent_count = 1;
+    if (::ioctl(fd, FS_IOC_FIEMAP, map) == 0 && map->fm_mapped_extents > 0) {
+        return map->fm_extents[0].fe_physical;
+    }
+#else
+    (void)fd;
+#endif
+    return 0;
+}
+
+ReadKey readKey(const std::string &path, ReadOrder order) {
+    ReadKey key;
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0) {
+        key.physical = std::numeric_limits<std::uint64_t>::max();
+        return key;
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        key.inode = static_cast<std::uint64_t>(st.st_ino);
+        key.resident = isResident(fd, static_cast<std::uint64_t>(st.st_size));
+        if (order == ReadOrder::Extent && !key.resident) {
+            key.physical = firstPhysicalOffset(fd);
+        }
+    }
+    ::close(fd);
+    return key;
+}
+
+}
+
+std::vector<std::size_t> readingOrder(const std::vector<std::string> &paths, ReadOrder order) {
+    std::vector<std::size_t> indexes(paths.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    if (order == ReadOrder::Discovery || paths.size() < 2) {
+        return indexes;
+    }
+
+    std::vector<ReadKey> keys;
+    keys.reserve(paths.size());
+    for (const std::string &path : paths) {
+        keys.push_back(readKey(path, order));
+    }
+    std::stable_sort(indexes.begin(), indexes.end(), [&keys](std::size_t a, std::size_t b) {
+        const ReadKey &left = keys[a];
+        const ReadKey &right = keys[b];
+        if (left.resident != right.resident) {
+            return left.resident;
+        }
+        if (left.physical != right.physical) {
+            return left.physical < right.physical;
+        }
+        return left.inode < right.inode;
+    });
+    return indexes;
+}
+
+} // namespace core
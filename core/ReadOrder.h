@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace core {
+
+// Order in which a batch of files is read. On a spinning disk reading in
+// on-disk order turns most seeks into short forward skips.
+enum class ReadOrder {
+    Discovery, // as the walker found them
+    Inode,     // by inode number, which most filesystems allocate near the data
+    Extent,    // by the physical offset of the first extent (FIEMAP), inode where unknown
+};
+
+// Returns the indexes of paths in the order they should be read. Files whose
+// pages are all in the page cache (mincore) come first, since reading them
+// costs no I/O; the rest are sorted by the ReadOrder key. Files that cannot be
+// opened go last. With ReadOrder::Discovery this is the identity.
+std::vector<std::size_t> readingOrder(const std::vector<std::string> &paths, ReadOrder order);
+
+}
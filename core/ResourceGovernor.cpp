@@ -0,0 +1,141 @@
+#include "ResourceGovernor.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+
+namespace core {
+
+namespace {
+
+#ifdef __linux__
+// From linux/ioprio.h, which older kernel headers do not ship.
+constexpr int kIoprioWhoProcess = 1;
+constexpr int kIoprioClassIdle = 3;
+constexpr int kIoprioClassShift = 13;
+#endif
+
+const std::string kCgroupRoot = "/sys/fs/cgroup";
+
+// Returns the cgroup v2 path of this process relative to kCgroupRoot, or an
+// empty string on a v1-only system.
+std::string currentCgroup() {
+    std::ifstream in("/proc/self/cgroup");
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.compare(0, 3, "0::") == 0) {
+            return line.substr(3);
+        }
+    }
+    return {};
+}
+
+bool writeFile(const std::string &path, const std::string &value) {
+    std::ofstream out(path);
+    out << value;
+    out.flush();
+    return static_cast<bool>(out);
+}
+
+}
+
+ReadThrottle::ReadThrottle(std::uint64_t bytesPerSecond)
+    : m_rate(static_cast<double>(std::max<std::uint64_t>(bytesPerSecond, 1))),
+      m_tokens(m_rate),
+      m_lastRefill(Clock::now()) {}
+
+void ReadThrottle::acquire(std::size_t bytes) {
+    double debt = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const auto now = Clock::now();
+        const double elapsed = std::chrono::duration<double>(now - m_lastRefill).count();
+        m_lastRefill = now;
+        m_tokens = std::min(m_rate, m_tokens + elapsed * m_rate) - static_cast<double>(bytes);
+        debt = -m_tokens;
+    }
+    // Every caller sleeps off the debt as it stood after its own charge, so
+    // concurrent readers queue up behind each other.
+    if (debt > 0) {
+        std::this_thread::sleep_for(std::chrono::duration<double>(debt / m_rate));
+    }
+}
+
+bool lowerCurrentThreadPriority() {
+#ifdef __linux__
+    // With pid 0 these act on the calling thread only, not the whole process.
+    ::syscall(SYS_ioprio_set, kIoprioWhoProcess, 0, kIoprioClassIdle << kIoprioClassShift);
+    sched_param param {};
+    if (::sched_setscheduler(0, SCHED_IDLE, &param) == 0) {
+        return true;
+    }
+    return ::setpriority(PRIO_PROCESS, static_cast<id_t>(::syscall(SYS_gettid)), 19) == 0;
+#else
+    return false;
+#endif
+}
+
+ScanCgroup::~ScanCgroup() { leave(); }
+
+bool ScanCgroup::enter(const ResourceBudget &budget, const std::string &name) {
+    leave();
+    const std::string current = currentCgroup();
+    const auto slash = current.find_last_of('/');
+    if (current.empty() || current == "/" || slash == std::string::npos) {
+        m_error = "cgroup v2 is not available for this process";
+        return false;
+    }
+    const std::string parent = kCgroupRoot + current.substr(0, slash);
+    const std::string path = parent + "/" + name + "-" + std::to_string(::getpid());
+    if (::mkdir(path.c_str(), 0755) != 0 && errno != EEXIST) {
+        m_error = path + ": " + std::strerror(errno);
+        return false;
+    }
+
+    // Usually already enabled by whoever delegated the subtree.
+    for (const char *controller : {"+cpu", "+io", "+memory"}) {
+        writeFile(parent + "/cgroup.subtree_control", controller);
+    }
+    bool limited = true;
+    if (budget.cpuPercent > 0) {
+        limited = limited && writeFile(path + "/cpu.max", std::to_string(budget.cpuPercent * 1000) + " 100000");
+    }
+    if (budget.ioWeight > 0) {
+        limited = limited && writeFile(path + "/io.weight", "default " + std::to_string(budget.ioWeight));
+    }
+    if (budget.memoryLimitBytes > 0) {
+        limited = limited && writeFile(path + "/memory.high", std::to_string(budget.memoryLimitBytes));
+    }
+    if (!limited || !writeFile(path + "/cgroup.procs", "0")) {
+        m_error = path + ": the cpu, io or memory controller is not delegated";
+        ::rmdir(path.c_str());
+        return false;
+    }
+    m_originalPath = kCgroupRoot + current;
+    m_path = path;
+    m_error.clear();
+    return true;
+}
+
+void ScanCgroup::leave() {
+    if (m_path.empty()) {
+        return;
+    }
+    writeFile(m_originalPath + "/cgroup.procs", "0");
+    ::rmdir(m_path.c_str());
+    m_path.clear();
+    m_originalPath.clear();
+}
+
+} // namespace core
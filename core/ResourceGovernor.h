@@ -0,0 +1,69 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace core {
+
+// What a scan may take from the machine. The defaults take everything.
+struct ResourceBudget {
+    bool idlePriority = false;            // SCHED_IDLE (nice 19 as fallback) and the idle I/O class
+    std::uint64_t readBytesPerSecond = 0; // file content read by hashing, 0 = unlimited
+    std::uint64_t memoryLimitBytes = 0;   // memory.high of the scan cgroup, 0 = unlimited
+    bool ownCgroup = false;               // run the scan in a cgroup v2 of its own
+    unsigned cpuPercent = 0;              // cpu.max of that cgroup in % of one CPU, 0 = unlimited
+    unsigned ioWeight = 0;                // io.weight of that cgroup (1-10000), 0 = inherited
+};
+
+// Token bucket shared by every thread that reads for one scan. acquire()
+// charges the bytes and sleeps until the average rate is back within
+// bytesPerSecond; up to one second of reads may pass as a burst.
+class ReadThrottle {
+public:
+    explicit ReadThrottle(std::uint64_t bytesPerSecond);
+
+    void acquire(std::size_t bytes);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    std::mutex m_mutex;
+    double m_rate;
+    double m_tokens;
+    Clock::time_point m_lastRefill;
+};
+
+// Moves the calling thread to SCHED_IDLE, or to nice 19 where that is not
+// allowed, and to the idle I/O priority class. Threads it starts afterwards
+// inherit both. Returns false when neither CPU setting could be applied.
+bool lowerCurrentThreadPriority();
+
+// A cgroup v2 created next to the one the process runs in, holding the
+// process for the lifetime of this object. io and memory are domain
+// controllers, so a single thread cannot be placed on its own: the whole
+// process moves, and moves back in the destructor.
+//
+// Needs the parent cgroup to be delegated to the user (as systemd does for
+// user@.service); enter() fails otherwise and leaves nothing behind.
+class ScanCgroup {
+public:
+    ScanCgroup() = default;
+    ~ScanCgroup();
+
+    ScanCgroup(const ScanCgroup &) = delete;
+    ScanCgroup &operator=(const ScanCgroup &) = delete;
+
+    bool enter(const ResourceBudget &budget, const std::string &name);
+    void leave();
+    const std::string &errorString() const { return m_error; }
+
+private:
+    std::string m_originalPath;
+    std::string m_path;
+    std::string m_error;
+};
+
+}
@@ -0,0 +1,105 @@
+#include "SampledDigest.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <set>
+
+#include <unistd.h>
+
+namespace core {
+
+namespace {
+
+// splitmix64: tiny, and fully determined by the seed on every platform,
+// unlike the standard distributions.
+std::uint64_t nextRandom(std::uint64_t &state) {
+    std::uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+void storeBigEndian64(unsigned char *bytes, std::uint64_t value) {
+    for (int i = 7; i >= 0; --i) {
+        bytes[i] = static_cast<unsigned char>(value);
+        value >>= 8;
+    }
+}
+
+}
+
+std::vector<std::uint64_t> sampleOffsets(std::uint64_t size, std::uint64_t seed, const SampleOptions &options) {
+    const std::uint64_t blockSize = std::max<std::uint64_t>(1, options.blockSize);
+    const std::uint64_t blocks = (size + blockSize - 1) / blockSize;
+    std::vector<std::uint64_t> offsets;
+    if (blocks <= std::uint64_t{options.interiorBlocks} + 2) {
+        for (std::uint64_t i = 0; i < blocks; ++i) {
+            offsets.push_back(i * blockSize);
+        }
+        return offsets;
+    }
+
+    // More than interiorBlocks candidates are left between the ends, so this
+    // terminates; with files far larger than the sample it rarely repeats.
+    std::set<std::uint64_t> picked{0, blocks - 1};
+    std::uint64_t state = seed;
+    while (picked.size() < std::size_t{options.interiorBlocks} + 2) {
+        picked.insert(1 + nextRandom(state) % (blocks - 2));
+    }
+    for (const std::uint64_t block : picked) {
+        offsets.push_back(block * blockSize);
+    }
+    return offsets;
+}
+
+int sampledDigest(const std::string &path,
+                  std::uint64_t size,
+                  const std::vector<std::uint64_t> &offsets,
+                  std::uint64_t blockSize,
+                  CachePolicy cachePolicy,
+                  Sha256::Digest &digest) {
+    // Blocks land at arbitrary offsets, which O_DIRECT would refuse.
+    const int fd = openForReading(path, cachePolicy == CachePolicy::Direct ? CachePolicy::DropBehind : cachePolicy);
+    if (fd < 0) {
+        return errno;
+    }
+
+    Sha256 sha;
+    unsigned char header[8];
+    storeBigEndian64(header, size);
+    sha.update(header, sizeof(header));
+    std::vector<unsigned char> buffer(static_cast<std::size_t>(blockSize));
+    int error = 0;
+    for (const std::uint64_t offset : offsets) {
+        storeBigEndian64(header, offset);
+        sha.update(header, sizeof(header));
+        std::size_t filled = 0;
+        while (filled < buffer.size()) {
+            const ssize_t bytesRead = ::pread(fd, buffer.data() + filled, buffer.size() - filled,
+                                              static_cast<off_t>(offset + filled));
+            if (bytesRead < 0 && errno == EINTR) {
+                continue;
+            }
+            if (bytesRead < 0) {
+                error = errno;
+                break;
+            }
+            if (bytesRead == 0) {
+                break;
+            }
+            filled += static_cast<std::size_t>(bytesRead);
+        }
+        if (error != 0) {
+            break;
+        }
+        sha.update(buffer.data(), filled);
+    }
+    releaseCachedPages(fd, cachePolicy);
+    ::close(fd);
+    if (error == 0) {
+        digest = sha.digest();
+    }
+    return error;
+}
+
+} // namespace core
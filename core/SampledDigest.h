@@ -0,0 +1,36 @@
+#pragma once
+
+#include "FileReader.h"
+#include "Sha256.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace core {
+
+struct SampleOptions {
+    std::uint64_t blockSize = 64 * 1024; // bytes per sampled block
+    unsigned interiorBlocks = 64;         // blocks sampled between the first and the last one
+};
+
+// Offsets of the blocks a sampled digest reads, ascending: the first and the
+// last block of a file of the given size, and interiorBlocks distinct blocks
+// in between picked by a generator seeded with seed. A file with no more
+// blocks than that is covered completely.
+std::vector<std::uint64_t> sampleOffsets(std::uint64_t size, std::uint64_t seed, const SampleOptions &options);
+
+// SHA-256 over size and every block at offsets (each preceded by its
+// offset), read through one descriptor. Returns 0 or an errno value.
+//
+// This only detects changes that touch a sampled block or the size, so it
+// stands in for a full hash between full hashes, not for one; with a seed
+// the attacker cannot know, which blocks those are cannot be predicted.
+int sampledDigest(const std::string &path,
+                  std::uint64_t size,
+                  const std::vector<std::uint64_t> &offsets,
+                  std::uint64_t blockSize,
+                  CachePolicy cachePolicy,
+                  Sha256::Digest &digest);
+
+}
@@ -0,0 +1,222 @@
+#include "Sha256.h"
+
+#include "Sha256Impl.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace core {
+
+using namespace sha256;
+
+namespace {
+
+constexpr std::size_t kSavedHeader = 8 * 4 + 8;
+
+inline std::uint32_t rotateRight(std::uint32_t value, unsigned bits) {
+    return (value >> bits) | (value << (32 - bits));
+}
+
+inline std::uint32_t loadBigEndian32(const unsigned char *bytes) {
+    return (static_cast<std::uint32_t>(bytes[0]) << 24) | (static_cast<std::uint32_t>(bytes[1]) << 16)
+        | (static_cast<std::uint32_t>(bytes[2]) << 8) | static_cast<std::uint32_t>(bytes[3]);
+}
+
+inline void storeBigEndian32(unsigned char *bytes, std::uint32_t value) {
+    bytes[0] = static_cast<unsigned char>(value >> 24);
+    bytes[1] = static_cast<unsigned char>(value >> 16);
+    bytes[2] = static_cast<unsigned char>(value >> 8);
+    bytes[3] = static_cast<unsigned char>(value);
+}
+
+inline void storeBigEndian64(unsigned char *bytes, std::uint64_t value) {
+    storeBigEndian32(bytes, static_cast<std::uint32_t>(value >> 32));
+    storeBigEndian32(bytes + 4, static_cast<std::uint32_t>(value));
+}
+
+struct Dispatch {
+    const char *name;
+    CompressFn compress;
+    HashManyFn hashMany; // nullptr: one message after the other
+};
+
+// SHA-NI wins over the AVX2 lanes even for many messages: its rounds are
+// cheaper than eight lanes' worth of vector arithmetic.
+Dispatch selectDispatch() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (shaNiCompress() && __builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1")) {
+        return Dispatch{"sha-ni", shaNiCompress(), nullptr};
+    }
+    if (avx2HashMany() && __builtin_cpu_supports("avx2")) {
+        return Dispatch{"avx2", compressPortable, avx2HashMany()};
+    }
+#endif
+    return Dispatch{"portable", compressPortable, nullptr};
+}
+
+const Dispatch &dispatch() {
+    static const Dispatch selected = selectDispatch();
+    return selected;
+}
+
+}
+
+namespace sha256 {
+
+void compressPortable(std::uint32_t state[8], const unsigned char *blocks, std::size_t count) {
+    std::uint32_t schedule[64];
+    for (; count > 0; --count, blocks += kBlockSize) {
+        for (int i = 0; i < 16; ++i) {
+            schedule[i] = loadBigEndian32(blocks + 4 * i);
+        }
+        for (int i = 16; i < 64; ++i) {
+            const std::uint32_t s0 = rotateRight(schedule[i - 15], 7) ^ rotateRight(schedule[i - 15], 18)
+                ^ (schedule[i - 15] >> 3);
+            const std::uint32_t s1 = rotateRight(schedule[i - 2], 17) ^ rotateRight(schedule[i - 2], 19)
+                ^ (schedule[i - 2] >> 10);
+            schedule[i] = schedule[i - 16] + s0 + schedule[i - 7] + s1;
+        }
+
+        std::uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        std::uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; ++i) {
+            const std::uint32_t s1 = rotateRight(e, 6) ^ rotateRight(e, 11) ^ rotateRight(e, 25);
+            const std::uint32_t choose = (e & f) ^ (~e & g);
+            const std::uint32_t t1 = h + s1 + choose + kRoundConstants[i] + schedule[i];
+            const std::uint32_t s0 = rotateRight(a, 2) ^ rotateRight(a, 13) ^ rotateRight(a, 22);
+            const std::uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+            const std::uint32_t t2 = s0 + majority;
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+std::size_t paddedTail(const unsigned char *message, std::size_t size, unsigned char tail[2 * kBlockSize]) {
+    const std::size_t rest = size % kBlockSize;
+    const std::size_t blocks = rest < 56 ? 1 : 2;
+    std::memset(tail, 0, blocks * kBlockSize);
+    if (rest > 0) {
+        std::memcpy(tail, message + size - rest, rest);
+    }
+    tail[rest] = 0x80;
+    storeBigEndian64(tail + blocks * kBlockSize - 8, static_cast<std::uint64_t>(size) * 8);
+    return blocks;
+}
+
+} // namespace sha256
+
+Sha256::Sha256() {
+    std::memcpy(m_state, kInitialState, sizeof(m_state));
+}
+
+void Sha256::compress(const unsigned char *blocks, std::size_t count) {
+    if (count > 0) {
+        dispatch().compress(m_state, blocks, count);
+    }
+}
+
+void Sha256::update(const unsigned char *data, std::size_t size) {
+    if (size == 0) {
+        return;
+    }
+    std::size_t buffered = static_cast<std::size_t>(m_length % kBlockSize);
+    m_length += size;
+    if (buffered > 0) {
+        const std::size_t take = std::min(size, kBlockSize - buffered);
+        std::memcpy(m_buffer + buffered, data, take);
+        data += take;
+        size -= take;
+        buffered += take;
+        if (buffered < kBlockSize) {
+            return;
+        }
+        compress(m_buffer, 1);
+    }
+    const std::size_t blocks = size / kBlockSize;
+    compress(data, blocks);
+    std::memcpy(m_buffer, data + blocks * kBlockSize, size - blocks * kBlockSize);
+}
+
+Sha256::Digest Sha256::digest() const {
+    Sha256 last = *this;
+    unsigned char padding[2 * kBlockSize] = {0x80};
+    const std::size_t buffered = static_cast<std::size_t>(m_length % kBlockSize);
+    const std::size_t padLength = (buffered < 56 ? 56 : 120) - buffered;
+    storeBigEndian64(padding + padLength, m_length * 8);
+    last.update(padding, padLength + 8);
+
+    Digest digest;
+    for (int i = 0; i < 8; ++i) {
+        storeBigEndian32(digest.data() + 4 * i, last.m_state[i]);
+    }
+    return digest;
+}
+
+std::string Sha256::saveState() const {
+    const std::size_t buffered = static_cast<std::size_t>(m_length % kBlockSize);
+    std::string state(kSavedHeader + buffered, '\0');
+    auto *bytes = reinterpret_cast<unsigned char *>(&state[0]);
+    for (int i = 0; i < 8; ++i) {
+        storeBigEndian32(bytes + 4 * i, m_state[i]);
+    }
+    storeBigEndian64(bytes + 32, m_length);
+    std::memcpy(bytes + kSavedHeader, m_buffer, buffered);
+    return state;
+}
+
+bool Sha256::restoreState(const std::string &state) {
+    if (state.size() < kSavedHeader) {
+        return false;
+    }
+    const auto *bytes = reinterpret_cast<const unsigned char *>(state.data());
+    const std::uint64_t length = (static_cast<std::uint64_t>(loadBigEndian32(bytes + 32)) << 32)
+        | loadBigEndian32(bytes + 36);
+    if (state.size() != kSavedHeader + length % kBlockSize) {
+        return false;
+    }
+    for (int i = 0; i < 8; ++i) {
+        m_state[i] = loadBigEndian32(bytes + 4 * i);
+    }
+    m_length = length;
+    std::memcpy(m_buffer, bytes + kSavedHeader, static_cast<std::size_t>(length % kBlockSize));
+    return true;
+}
+
+Sha256::Digest Sha256::hash(const unsigned char *data, std::size_t size) {
+    Sha256 sha;
+    sha.update(data, size);
+    return sha.digest();
+}
+
+void Sha256::hashMany(const unsigned char *const *messages, const std::size_t *sizes, std::size_t count, Digest *digests) {
+    static_assert(sizeof(Digest) == kDigestSize, "digests are written back to back");
+    if (const HashManyFn hashMany = dispatch().hashMany) {
+        hashMany(messages, sizes, count, digests->data());
+        return;
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+        digests[i] = hash(messages[i], sizes[i]);
+    }
+}
+
+const char *Sha256::implementation() {
+    return dispatch().name;
+}
+
+} // namespace core
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace core {
+
+// Streaming SHA-256 (FIPS 180-4) whose intermediate state can be saved and
+// restored. Hashing a file, saving the state and later feeding only the bytes
+// appended since gives the same digest as hashing the grown file from the
+// start, which is what lets append-only files skip rereading their prefix.
+class Sha256 {
+public:
+    static constexpr std::size_t kDigestSize = 32;
+    static constexpr std::size_t kBlockSize = 64;
+    using Digest = std::array<unsigned char, kDigestSize>;
+
+    Sha256();
+
+    void update(const unsigned char *data, std::size_t size);
+    // Digest of everything fed so far; the hash can still be updated after.
+    Digest digest() const;
+    // Bytes fed so far.
+    std::uint64_t length() const { return m_length; }
+
+    // The chaining value (32 bytes) and the length (8 bytes), both big
+    // endian, followed by the length % 64 bytes not yet compressed.
+    std::string saveState() const;
+    // Takes a saveState() result; returns false and leaves the hash
+    // unchanged when the state is malformed.
+    bool restoreState(const std::string &state);
+
+    static Digest hash(const unsigned char *data, std::size_t size);
+    // digests[i] = hash(messages[i], sizes[i]). Without SHA-NI but with AVX2
+    // eight messages are hashed side by side, which pays off for many small
+    // files.
+    static void hashMany(const unsigned char *const *messages,
+                         const std::size_t *sizes,
+                         std::size_t count,
+                         Digest *digests);
+    // "sha-ni", "avx2" (hashMany() only) or "portable".
+    static const char *implementation();
+
+private:
+    void compress(const unsigned char *blocks, std::size_t count);
+
+    std::uint32_t m_state[8];
+    std::uint64_t m_length = 0;
+    unsigned char m_buffer[kBlockSize];
+};
+
+}
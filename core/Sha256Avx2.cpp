@@ -0,0 +1,147 @@
+// Built with -mavx2 on x86-64; see CMakeLists.txt.
+#include "Sha256Impl.h"
+
+namespace core {
+namespace sha256 {
+
+#if defined(__AVX2__)
+namespace {
+
+constexpr std::size_t kLanes = 8;
+typedef std::uint32_t Lanes8 __attribute__((vector_size(32)));
+
+inline std::uint32_t loadBigEndian32(const unsigned char *bytes) {
+    return (static_cast<std::uint32_t>(bytes[0]) << 24) | (static_cast<std::uint32_t>(bytes[1]) << 16)
+        | (static_cast<std::uint32_t>(bytes[2]) << 8) | static_cast<std::uint32_t>(bytes[3]);
+}
+
+inline Lanes8 rotateRight(Lanes8 value, int bits) {
+    return (value >> bits) | (value << (32 - bits));
+}
+
+// One block of each of the eight messages, lane i of every vector belonging
+// to message i.
+void compressLanes(Lanes8 state[8], const unsigned char *const blocks[kLanes]) {
+    Lanes8 schedule[64];
+    for (int i = 0; i < 16; ++i) {
+        for (std::size_t lane = 0; lane < kLanes; ++lane) {
+            schedule[i][lane] = loadBigEndian32(blocks[lane] + 4 * i);
+        }
+    }
+    for (int i = 16; i < 64; ++i) {
+        const Lanes8 s0 = rotateRight(schedule[i - 15], 7) ^ rotateRight(schedule[i - 15], 18) ^ (schedule[i - 15] >> 3);
+        const Lanes8 s1 = rotateRight(schedule[i - 2], 17) ^ rotateRight(schedule[i - 2], 19) ^ (schedule[i - 2] >> 10);
+        schedule[i] = schedule[i - 16] + s0 + schedule[i - 7] + s1;
+    }
+
+    Lanes8 a = state[0], b = state[1], c = state[2], d = state[3];
+    Lanes8 e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; ++i) {
+        const Lanes8 s1 = rotateRight(e, 6) ^ rotateRight(e, 11) ^ rotateRight(e, 25);
+        const Lanes8 choose = (e & f) ^ (~e & g);
+        const Lanes8 t1 = h + s1 + choose + kRoundConstants[i] + schedule[i];
+        const Lanes8 s0 = rotateRight(a, 2) ^ rotateRight(a, 13) ^ rotateRight(a, 22);
+        const Lanes8 majority = (a & b) ^ (a & c) ^ (b & c);
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + s0 + majority;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+struct Lane {
+    const unsigned char *message = nullptr;
+    std::size_t wholeBlocks = 0;
+    std::size_t totalBlocks = 0;
+    std::size_t block = 0;
+    std::size_t index = 0;
+    bool active = false;
+    unsigned char tail[2 * kBlockSize];
+};
+
+// A lane takes the next message as soon as its current one is done, so
+// messages of different lengths keep all eight lanes busy until the last few.
+void hashMany8(const unsigned char *const *messages, const std::size_t *sizes, std::size_t count, unsigned char *digests) {
+    static const unsigned char kIdleBlock[kBlockSize] = {};
+    Lanes8 state[8];
+    Lane lanes[kLanes];
+    std::size_t next = 0;
+    std::size_t active = 0;
+
+    auto startNext = [&](std::size_t laneIndex) {
+        Lane &lane = lanes[laneIndex];
+        lane.active = next < count;
+        if (!lane.active) {
+            return;
+        }
+        lane.message = messages[next];
+        lane.wholeBlocks = sizes[next] / kBlockSize;
+        lane.totalBlocks = lane.wholeBlocks + paddedTail(messages[next], sizes[next], lane.tail);
+        lane.block = 0;
+        lane.index = next++;
+        for (int word = 0; word < 8; ++word) {
+            state[word][laneIndex] = kInitialState[word];
+        }
+        ++active;
+    };
+    for (std::size_t lane = 0; lane < kLanes; ++lane) {
+        startNext(lane);
+    }
+
+    const unsigned char *blocks[kLanes];
+    while (active > 0) {
+        for (std::size_t i = 0; i < kLanes; ++i) {
+            const Lane &lane = lanes[i];
+            if (!lane.active) {
+                blocks[i] = kIdleBlock;
+            } else if (lane.block < lane.wholeBlocks) {
+                blocks[i] = lane.message + lane.block * kBlockSize;
+            } else {
+                blocks[i] = lane.tail + (lane.block - lane.wholeBlocks) * kBlockSize;
+            }
+        }
+        compressLanes(state, blocks);
+        for (std::size_t i = 0; i < kLanes; ++i) {
+            Lane &lane = lanes[i];
+            if (!lane.active || ++lane.block < lane.totalBlocks) {
+                continue;
+            }
+            unsigned char *digest = digests + lane.index * kDigestSize;
+            for (int word = 0; word < 8; ++word) {
+                const std::uint32_t value = state[word][i];
+                digest[4 * word] = static_cast<unsigned char>(value >> 24);
+                digest[4 * word + 1] = static_cast<unsigned char>(value >> 16);
+                digest[4 * word + 2] = static_cast<unsigned char>(value >> 8);
+                digest[4 * word + 3] = static_cast<unsigned char>(value);
+            }
+            --active;
+            startNext(i);
+        }
+    }
+}
+
+}
+
+HashManyFn avx2HashMany() {
+    return hashMany8;
+}
+#else
+HashManyFn avx2HashMany() {
+    return nullptr;
+}
+#endif
+
+} // namespace sha256
+} // namespace core
@@ -0,0 +1,139 @@
+#include "Sha256Hasher.h"
+
+#include "ResourceGovernor.h"
+
+#include <utility>
+
+#include <sys/stat.h>
+
+namespace core {
+
+namespace {
+
+std::string toHex(const Sha256::Digest &digest) {
+    static const char kHex[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(2 * digest.size());
+    for (const unsigned char byte : digest) {
+        hex += kHex[byte >> 4];
+        hex += kHex[byte & 0xf];
+    }
+    return hex;
+}
+
+bool isSmallFile(const std::string &path) {
+    struct stat info {};
+    return ::stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode)
+        && static_cast<std::uint64_t>(info.st_size) < kSmallFileBytes;
+}
+
+}
+
+Sha256Hasher::Sha256Hasher(Sha256HasherOptions options) : m_options(std::move(options)) {}
+
+std::string Sha256Hasher::compute(const std::filesystem::path &path) {
+    Sha256::Digest digest;
+    if (hashFile(path.string(), m_options, digest) != 0) {
+        return {};
+    }
+    return toHex(digest);
+}
+
+std::vector<std::string> Sha256Hasher::computeBatch(const std::vector<std::filesystem::path> &paths) {
+    std::vector<std::string> hashes(paths.size());
+    std::vector<std::string> small;
+    std::vector<std::size_t> owners;
+    for (std::size_t i = 0; i < paths.size(); ++i) {
+        std::string path = paths[i].string();
+        if (isSmallFile(path)) {
+            small.push_back(std::move(path));
+            owners.push_back(i);
+        } else {
+            hashes[i] = compute(paths[i]);
+        }
+    }
+    std::vector<Sha256::Digest> digests;
+    std::vector<int> errors;
+    hashSmallFiles(small, m_options, digests, errors);
+    for (std::size_t i = 0; i < small.size(); ++i) {
+        if (errors[i] == 0) {
+            hashes[owners[i]] = toHex(digests[i]);
+        }
+    }
+    return hashes;
+}
+
+DigestSet Sha256Hasher::computeDigests(const std::filesystem::path &path, unsigned digests) {
+    FileReaderOptions readerOptions;
+    readerOptions.cachePolicy = m_options.cachePolicy;
+    DigestSet result;
+    MultiDigest::hashFile(path.string(), digests, readerOptions, m_options.throttle, result);
+    return result;
+}
+
+int Sha256Hasher::hashFile(const std::string &path, const Sha256HasherOptions &options, Sha256::Digest &digest) {
+    Sha256 sha;
+    FileReaderOptions readerOptions;
+    readerOptions.cachePolicy = options.cachePolicy;
+    readerOptions.throttled = options.throttle != nullptr;
+    const int error = readFile(path,
+                               [&options, &sha](const unsigned char *data, std::size_t size) {
+                                   if (options.throttle) {
+                                       options.throttle->acquire(size);
+                                   }
+                                   sha.update(data, size);
+                               },
+                               readerOptions);
+    if (error != 0) {
+        return error;
+    }
+    digest = sha.digest();
+    return 0;
+}
+
+void Sha256Hasher::hashSmallFiles(const std::vector<std::string> &paths,
+                                  const Sha256HasherOptions &options,
+                                  std::vector<Sha256::Digest> &digests,
+                                  std::vector<int> &errors) {
+    digests.assign(paths.size(), Sha256::Digest{});
+    errors.assign(paths.size(), 0);
+    // Offsets rather than pointers: the buffer grows while files are read.
+    std::vector<unsigned char> contents;
+    std::vector<std::size_t> offsets(paths.size() + 1, 0);
+    FileReaderOptions readerOptions;
+    readerOptions.cachePolicy = options.cachePolicy;
+    readerOptions.throttled = options.throttle != nullptr;
+    for (std::size_t i = 0; i < paths.size(); ++i) {
+        const std::size_t start = contents.size();
+        errors[i] = readFile(paths[i],
+                             [&options, &contents](const unsigned char *data, std::size_t size) {
+                                 if (options.throttle) {
+                                     options.throttle->acquire(size);
+                                 }
+                                 contents.insert(contents.end(), data, data + size);
+                             },
+                             readerOptions);
+        if (errors[i] != 0) {
+            contents.resize(start);
+        }
+        offsets[i + 1] = contents.size();
+    }
+
+    std::vector<const unsigned char *> messages;
+    std::vector<std::size_t> sizes;
+    std::vector<std::size_t> owners;
+    for (std::size_t i = 0; i < paths.size(); ++i) {
+        if (errors[i] == 0) {
+            messages.push_back(contents.data() + offsets[i]);
+            sizes.push_back(offsets[i + 1] - offsets[i]);
+            owners.push_back(i);
+        }
+    }
+    std::vector<Sha256::Digest> hashed(messages.size());
+    Sha256::hashMany(messages.data(), sizes.data(), messages.size(), hashed.data());
+    for (std::size_t i = 0; i < owners.size(); ++i) {
+        digests[owners[i]] = hashed[i];
+    }
+}
+
+} // namespace core
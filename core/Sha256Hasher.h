@@ -0,0 +1,49 @@
+#pragma once
+
+#include "FileReader.h"
+#include "IHasher.h"
+#include "Sha256.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace core {
+
+class ReadThrottle;
+
+// Files below this size are read whole and hashed together by batches.
+constexpr std::uint64_t kSmallFileBytes = 64 * 1024;
+
+struct Sha256HasherOptions {
+    CachePolicy cachePolicy = CachePolicy::Keep;
+    ReadThrottle *throttle = nullptr; // charged for every byte read when set
+};
+
+// SHA-256 of a file as lowercase hex, or an empty string when it cannot be
+// read. computeBatch() reads the small files of a batch into one buffer and
+// runs them through Sha256::hashMany().
+class Sha256Hasher : public IHasher {
+public:
+    explicit Sha256Hasher(Sha256HasherOptions options = {});
+
+    std::string compute(const std::filesystem::path &path) override;
+    std::vector<std::string> computeBatch(const std::vector<std::filesystem::path> &paths) override;
+    DigestSet computeDigests(const std::filesystem::path &path, unsigned digests) override;
+
+    // Returns 0 or an errno value.
+    static int hashFile(const std::string &path, const Sha256HasherOptions &options, Sha256::Digest &digest);
+    // Reads every file whole, so meant for files below kSmallFileBytes.
+    // errors[i] is 0 when digests[i] holds the digest of paths[i], an errno
+    // value otherwise.
+    static void hashSmallFiles(const std::vector<std::string> &paths,
+                               const Sha256HasherOptions &options,
+                               std::vector<Sha256::Digest> &digests,
+                               std::vector<int> &errors);
+
+private:
+    Sha256HasherOptions m_options;
+};
+
+}
@@ -0,0 +1,68 @@
+// Built with -msha -msse4.1 on x86-64; see CMakeLists.txt.
+#include "Sha256Impl.h"
+
+#if defined(__SHA__) && defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+namespace core {
+namespace sha256 {
+
+#if defined(__SHA__) && defined(__SSE4_1__)
+namespace {
+
+// The SHA extensions keep the state as ABEF and CDGH and run four rounds
+// per pair of sha256rnds2, with sha256msg1/msg2 extending the schedule.
+void compressShaNi(std::uint32_t state[8], const unsigned char *blocks, std::size_t count) {
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bll, 0x0405060700010203ll);
+
+    __m128i cdab = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(state)), 0xb1);
+    __m128i cdgh = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(state + 4)), 0x1b);
+    __m128i abef = _mm_alignr_epi8(cdab, cdgh, 8);
+    cdgh = _mm_blend_epi16(cdgh, cdab, 0xf0);
+
+    for (; count > 0; --count, blocks += kBlockSize) {
+        const __m128i abefSaved = abef;
+        const __m128i cdghSaved = cdgh;
+        __m128i words[4];
+        for (int group = 0; group < 16; ++group) {
+            __m128i &current = words[group % 4];
+            if (group < 4) {
+                current = _mm_shuffle_epi8(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i *>(blocks + 16 * group)), byteSwap);
+            } else {
+                // words[group % 4] still holds group - 4, the others the three after it.
+                const __m128i &previous = words[(group + 3) % 4];
+                const __m128i partial = _mm_add_epi32(_mm_sha256msg1_epu32(current, words[(group + 1) % 4]),
+                                                      _mm_alignr_epi8(previous, words[(group + 2) % 4], 4));
+                current = _mm_sha256msg2_epu32(partial, previous);
+            }
+            __m128i message = _mm_add_epi32(
+                current, _mm_loadu_si128(reinterpret_cast<const __m128i *>(kRoundConstants + 4 * group)));
+            cdgh = _mm_sha256rnds2_epu32(cdgh, abef, message);
+            message = _mm_shuffle_epi32(message, 0x0e);
+            abef = _mm_sha256rnds2_epu32(abef, cdgh, message);
+        }
+        abef = _mm_add_epi32(abef, abefSaved);
+        cdgh = _mm_add_epi32(cdgh, cdghSaved);
+    }
+
+    const __m128i feba = _mm_shuffle_epi32(abef, 0x1b);
+    const __m128i dchg = _mm_shuffle_epi32(cdgh, 0xb1);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(state), _mm_blend_epi16(feba, dchg, 0xf0));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(state + 4), _mm_alignr_epi8(dchg, feba, 8));
+}
+
+}
+
+CompressFn shaNiCompress() {
+    return compressShaNi;
+}
+#else
+CompressFn shaNiCompress() {
+    return nullptr;
+}
+#endif
+
+} // namespace sha256
+} // namespace core
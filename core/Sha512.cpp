@@ -0,0 +1,148 @@
+#include "Sha512.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace core {
+
+namespace {
+
+constexpr std::uint64_t kInitialState[8] = {
+    0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+    0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL,
+};
+
+constexpr std::uint64_t kRoundConstants[80] = {
+    0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+    0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+    0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+    0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+    0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+    0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+    0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+    0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+    0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+    0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+    0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+    0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+    0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+    0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+    0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+    0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+    0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+    0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+    0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+    0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL,
+};
+
+inline std::uint64_t rotateRight(std::uint64_t value, unsigned bits) {
+    return (value >> bits) | (value << (64 - bits));
+}
+
+inline std::uint64_t loadBigEndian64(const unsigned char *bytes) {
+    std::uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+inline void storeBigEndian64(unsigned char *bytes, std::uint64_t value) {
+    for (int i = 7; i >= 0; --i) {
+        bytes[i] = static_cast<unsigned char>(value);
+        value >>= 8;
+    }
+}
+
+}
+
+Sha512::Sha512() {
+    std::memcpy(m_state, kInitialState, sizeof(m_state));
+}
+
+void Sha512::compress(const unsigned char *blocks, std::size_t count) {
+    for (; count > 0; --count, blocks += kBlockSize) {
+        std::uint64_t w[80];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = loadBigEndian64(blocks + 8 * i);
+        }
+        for (int i = 16; i < 80; ++i) {
+            const std::uint64_t s0 = rotateRight(w[i - 15], 1) ^ rotateRight(w[i - 15], 8) ^ (w[i - 15] >> 7);
+            const std::uint64_t s1 = rotateRight(w[i - 2], 19) ^ rotateRight(w[i - 2], 61) ^ (w[i - 2] >> 6);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        std::uint64_t a = m_state[0], b = m_state[1], c = m_state[2], d = m_state[3];
+        std::uint64_t e = m_state[4], f = m_state[5], g = m_state[6], h = m_state[7];
+        for (int i = 0; i < 80; ++i) {
+            const std::uint64_t s1 = rotateRight(e, 14) ^ rotateRight(e, 18) ^ rotateRight(e, 41);
+            const std::uint64_t choose = (e & f) ^ (~e & g);
+            const std::uint64_t t1 = h + s1 + choose + kRoundConstants[i] + w[i];
+            const std::uint64_t s0 = rotateRight(a, 28) ^ rotateRight(a, 34) ^ rotateRight(a, 39);
+            const std::uint64_t majority = (a & b) ^ (a & c) ^ (b & c);
+            const std::uint64_t t2 = s0 + majority;
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        m_state[0] += a;
+        m_state[1] += b;
+        m_state[2] += c;
+        m_state[3] += d;
+        m_state[4] += e;
+        m_state[5] += f;
+        m_state[6] += g;
+        m_state[7] += h;
+    }
+}
+
+void Sha512::update(const unsigned char *data, std::size_t size) {
+    if (size == 0) {
+        return;
+    }
+    std::size_t buffered = static_cast<std::size_t>(m_length % kBlockSize);
+    m_length += size;
+    if (buffered > 0) {
+        const std::size_t take = std::min(size, kBlockSize - buffered);
+        std::memcpy(m_buffer + buffered, data, take);
+        data += take;
+        size -= take;
+        buffered += take;
+        if (buffered < kBlockSize) {
+            return;
+        }
+        compress(m_buffer, 1);
+    }
+    const std::size_t blocks = size / kBlockSize;
+    compress(data, blocks);
+    std::memcpy(m_buffer, data + blocks * kBlockSize, size - blocks * kBlockSize);
+}
+
+// The length field is 128 bits; its upper half stays zero.
+Sha512::Digest Sha512::digest() const {
+    Sha512 last = *this;
+    unsigned char padding[2 * kBlockSize] = {0x80};
+    const std::size_t buffered = static_cast<std::size_t>(m_length % kBlockSize);
+    const std::size_t padLength = (buffered < 112 ? 112 : 240) - buffered;
+    storeBigEndian64(padding + padLength + 8, m_length * 8);
+    last.update(padding, padLength + 16);
+
+    Digest digest;
+    for (int i = 0; i < 8; ++i) {
+        storeBigEndian64(digest.data() + 8 * i, last.m_state[i]);
+    }
+    return digest;
+}
+
+Sha512::Digest Sha512::hash(const unsigned char *data, std::size_t size) {
+    Sha512 sha;
+    sha.update(data, size);
+    return sha.digest();
+}
+
+} // namespace core
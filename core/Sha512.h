@@ -0,0 +1,33 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace core {
+
+// Streaming SHA-512 (FIPS 180-4). Only kept next to the row hash for
+// manifests that ask for it, so there is no state saving and no SIMD.
+class Sha512 {
+public:
+    static constexpr std::size_t kDigestSize = 64;
+    static constexpr std::size_t kBlockSize = 128;
+    using Digest = std::array<unsigned char, kDigestSize>;
+
+    Sha512();
+
+    void update(const unsigned char *data, std::size_t size);
+    // Digest of everything fed so far; the hash can still be updated after.
+    Digest digest() const;
+
+    static Digest hash(const unsigned char *data, std::size_t size);
+
+private:
+    void compress(const unsigned char *blocks, std::size_t count);
+
+    std::uint64_t m_state[8];
+    std::uint64_t m_length = 0; // bytes; files stay far below 2^64
+    unsigned char m_buffer[kBlockSize];
+};
+
+}
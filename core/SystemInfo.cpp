@@ -0,0 +1,129 @@
+#include "SystemInfo.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/sysmacros.h>
+#endif
+
+namespace core {
+
+namespace {
+
+#ifdef __linux__
+// Returns the quota expressed in CPUs, or 0 when the cgroup is unlimited.
+double readCgroupV2Quota(const std::string &cgroupDir) {
+    std::ifstream in(cgroupDir + "/cpu.max");
+    std::string quota;
+    double period = 0;
+    if (!(in >> quota >> period) || quota == "max" || period <= 0) {
+        return 0;
+    }
+    return std::stod(quota) / period;
+}
+
+double readCgroupV1Quota(const std::string &cgroupDir) {
+    std::ifstream quotaIn(cgroupDir + "/cpu.cfs_quota_us");
+    std::ifstream periodIn(cgroupDir + "/cpu.cfs_period_us");
+    double quota = 0;
+    double period = 0;
+    if (!(quotaIn >> quota) || !(periodIn >> period) || quota <= 0 || period <= 0) {
+        return 0;
+    }
+    return quota / period;
+}
+
+double cgroupCpuQuota() {
+    std::ifstream in("/proc/self/cgroup");
+    std::string line;
+    double best = 0;
+    auto consider = [&best](double quota) {
+        if (quota > 0 && (best == 0 || quota < best)) {
+            best = quota;
+        }
+    };
+
+    while (std::getline(in, line)) {
+        // Format: hierarchy-id:controller-list:path
+        const auto first = line.find(':');
+        const auto second = line.find(':', first + 1);
+        if (first == std::string::npos || second == std::string::npos) {
+            continue;
+        }
+        const auto controllers = line.substr(first + 1, second - first - 1);
+        std::string path = line.substr(second + 1);
+
+        if (controllers.empty()) {
+            // cgroup v2: every ancestor may carry its own limit, the tightest wins.
+            while (true) {
+                consider(readCgroupV2Quota("/sys/fs/cgroup" + (path == "/" ? std::string() : path)));
+                if (path.empty() || path == "/") {
+                    break;
+                }
+                const auto slash = path.find_last_of('/');
+                path = slash == 0 || slash == std::string::npos ? "/" : path.substr(0, slash);
+            }
+        } else if (controllers.find("cpu") != std::string::npos) {
+            std::istringstream list(controllers);
+            std::string controller;
+            while (std::getline(list, controller, ',')) {
+                if (controller != "cpu") {
+                    continue;
+                }
+                const std::string root = "/sys/fs/cgroup/" + controllers;
+                consider(readCgroupV1Quota(root + path));
+                consider(readCgroupV1Quota(root));
+            }
+        }
+    }
+    return best;
+}
+#endif
+
+}
+
+unsigned availableCpuCount() {
+    unsigned count = std::thread::hardware_concurrency();
+
+#ifdef __linux__
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (::sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+        const int affinity = CPU_COUNT(&mask);
+        if (affinity > 0) {
+            count = static_cast<unsigned>(affinity);
+        }
+    }
+
+    const double quota = cgroupCpuQuota();
+    if (quota > 0) {
+        count = std::min(count, static_cast<unsigned>(std::ceil(quota)));
+    }
+#endif
+
+    return std::max(count, 1u);
+}
+
+bool isRotationalDevice(std::uint64_t device) {
+#ifdef __linux__
+    const std::string base = "/sys/dev/block/" + std::to_string(major(device)) + ":" + std::to_string(minor(device));
+    for (const char *queue : {"/queue/rotational", "/../queue/rotational"}) {
+        std::ifstream in(base + queue);
+        int rotational = 0;
+        if (in >> rotational) {
+            return rotational != 0;
+        }
+    }
+#else
+    (void)device;
+#endif
+    return false;
+}
+
+} // namespace core
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+namespace core {
+
+// Number of CPUs the current process may actually use: the sched_getaffinity
+// mask, clipped by the cgroup CPU quota (v2 cpu.max or v1 cfs_quota_us).
+// Never returns less than 1.
+unsigned availableCpuCount();
+
+// Whether the block device behind a st_dev value is a spinning disk, read
+// from /sys/dev/block/MAJ:MIN (the partition's parent for partitions).
+// Devices without a block queue (tmpfs, overlay, network filesystems) count as
+// non-rotational.
+bool isRotationalDevice(std::uint64_t device);
+
+}
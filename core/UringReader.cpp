@@ -0,0 +1,328 @@
+#include "UringReader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace core {
+
+namespace {
+
+constexpr std::size_t kBufferAlignment = 4096;
+
+std::uint64_t fileSize(int fd) {
+    struct stat st {};
+    return ::fstat(fd, &st) == 0 ? static_cast<std::uint64_t>(st.st_size) : 0;
+}
+
+// A filesystem may take O_DIRECT at open and refuse the read, and a short
+// read leaves the next offset unaligned; both are retried as buffered reads.
+bool dropDirectIo(int fd) {
+#ifdef O_DIRECT
+    const int flags = ::fcntl(fd, F_GETFL);
+    if (flags >= 0 && (flags & O_DIRECT)) {
+        return ::fcntl(fd, F_SETFL, flags & ~O_DIRECT) == 0;
+    }
+#else
+    (void)fd;
+#endif
+    return false;
+}
+
+#ifdef __linux__
+// liburing is not a dependency; these are the three raw system calls.
+int ioUringSetup(unsigned entries, io_uring_params *params) {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ioUringEnter(int ringFd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+int ioUringRegister(int ringFd, unsigned opcode, const void *arg, unsigned count) {
+    return static_cast<int>(::syscall(__NR_io_uring_register, ringFd, opcode, arg, count));
+}
+
+template <typename T>
+T *ringField(void *ring, std::uint32_t offset) {
+    return reinterpret_cast<T *>(static_cast<char *>(ring) + offset);
+}
+#endif
+
+}
+
+UringReader::UringReader(UringReaderOptions options) : m_options(options) {
+    m_options.queueDepth = std::max(1u, m_options.queueDepth);
+    m_options.chunkSize = std::max<std::size_t>(kBufferAlignment,
+                                                (m_options.chunkSize + kBufferAlignment - 1) / kBufferAlignment * kBufferAlignment);
+    m_buffers = static_cast<unsigned char *>(
+        std::aligned_alloc(kBufferAlignment, m_options.chunkSize * m_options.queueDepth));
+    if (!m_buffers) {
+        throw std::bad_alloc();
+    }
+    setupRing();
+}
+
+UringReader::~UringReader() {
+    teardownRing();
+    std::free(m_buffers);
+}
+
+bool UringReader::setupRing() {
+#ifdef __linux__
+    io_uring_params params {};
+    m_ringFd = ioUringSetup(m_options.queueDepth, &params);
+    if (m_ringFd < 0) {
+        m_ringFd = -1;
+        return false;
+    }
+
+    m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMmap) {
+        m_sqRingSize = m_cqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+    }
+    m_sqRing = ::mmap(nullptr, m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd,
+                      IORING_OFF_SQ_RING);
+    if (m_sqRing == MAP_FAILED) {
+        m_sqRing = nullptr;
+        teardownRing();
+        return false;
+    }
+    if (singleMmap) {
+        m_cqRing = m_sqRing;
+    } else {
+        m_cqRing = ::mmap(nullptr, m_cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd,
+                          IORING_OFF_CQ_RING);
+        if (m_cqRing == MAP_FAILED) {
+            m_cqRing = nullptr;
+            teardownRing();
+            return false;
+        }
+    }
+    m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    m_sqes = ::mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_SQES);
+    if (m_sqes == MAP_FAILED) {
+        m_sqes = nullptr;
+        teardownRing();
+        return false;
+    }
+
+    m_sqTail = ringField<unsigned>(m_sqRing, params.sq_off.tail);
+    m_sqMask = ringField<unsigned>(m_sqRing, params.sq_off.ring_mask);
+    m_sqArray = ringField<unsigned>(m_sqRing, params.sq_off.array);
+    m_cqHead = ringField<unsigned>(m_cqRing, params.cq_off.head);
+    m_cqTail = ringField<unsigned>(m_cqRing, params.cq_off.tail);
+    m_cqMask = ringField<unsigned>(m_cqRing, params.cq_off.ring_mask);
+    m_cqes = ringField<io_uring_cqe>(m_cqRing, params.cq_off.cqes);
+
+    // Registered buffers skip the per-read page pinning; they count against
+    // RLIMIT_MEMLOCK, so failing here just means plain reads.
+    std::vector<iovec> iovecs(m_options.queueDepth);
+    for (unsigned i = 0; i < m_options.queueDepth; ++i) {
+        iovecs[i].iov_base = buffer(i);
+        iovecs[i].iov_len = m_options.chunkSize;
+    }
+    m_fixedBuffers = ioUringRegister(m_ringFd, IORING_REGISTER_BUFFERS, iovecs.data(), m_options.queueDepth) == 0;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void UringReader::teardownRing() {
+#ifdef __linux__
+    if (m_sqes) {
+        ::munmap(m_sqes, m_sqesSize);
+    }
+    if (m_cqRing && m_cqRing != m_sqRing) {
+        ::munmap(m_cqRing, m_cqRingSize);
+    }
+    if (m_sqRing) {
+        ::munmap(m_sqRing, m_sqRingSize);
+    }
+    if (m_ringFd >= 0) {
+        ::close(m_ringFd);
+    }
+#endif
+    m_sqes = m_cqRing = m_sqRing = nullptr;
+    m_ringFd = -1;
+    m_fixedBuffers = false;
+}
+
+void UringReader::queueRead(unsigned slot, const Slot &state) {
+#ifdef __linux__
+    // Only this thread produces entries, so the tail needs no atomic
+    // read-modify-write; the release store publishes the entry to the kernel.
+    const unsigned tail = *m_sqTail;
+    const unsigned index = tail & *m_sqMask;
+    auto *sqe = static_cast<io_uring_sqe *>(m_sqes) + index;
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = m_fixedBuffers ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    sqe->fd = state.fd;
+    sqe->addr = reinterpret_cast<std::uint64_t>(buffer(slot));
+    sqe->len = static_cast<std::uint32_t>(m_options.chunkSize);
+    sqe->off = state.offset;
+    sqe->buf_index = static_cast<std::uint16_t>(m_fixedBuffers ? slot : 0);
+    sqe->user_data = slot;
+    m_sqArray[index] = index;
+    __atomic_store_n(m_sqTail, tail + 1, __ATOMIC_RELEASE);
+#else
+    (void)slot;
+    (void)state;
+#endif
+}
+
+int UringReader::submitAndWait(unsigned toSubmit) {
+#ifdef __linux__
+    int result;
+    do {
+        result = ioUringEnter(m_ringFd, toSubmit, 1, IORING_ENTER_GETEVENTS);
+    } while (result < 0 && errno == EINTR);
+    return result < 0 ? -errno : result;
+#else
+    (void)toSubmit;
+    return -ENOSYS;
+#endif
+}
+
+void UringReader::readBlocking(Slot &state, unsigned char *buffer, const ChunkSink &onChunk, const DoneSink &onDone) {
+    int error = 0;
+    while (true) {
+        const ssize_t bytesRead = ::pread(state.fd, buffer, m_options.chunkSize, static_cast<off_t>(state.offset));
+        if (bytesRead < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            error = errno;
+            break;
+        }
+        if (bytesRead == 0) {
+            break;
+        }
+        onChunk(state.fileIndex, buffer, static_cast<std::size_t>(bytesRead));
+        state.offset += static_cast<std::uint64_t>(bytesRead);
+    }
+    releaseCachedPages(state.fd, m_options.cachePolicy);
+    ::close(state.fd);
+    state.fd = -1;
+    onDone(state.fileIndex, error);
+}
+
+void UringReader::readFiles(const std::vector<std::string> &paths, const ChunkSink &onChunk, const DoneSink &onDone) {
+    std::size_t next = 0;
+    // Opens the next readable file into state; files that fail to open are
+    // reported right away.
+    auto openNext = [&](Slot &state) {
+        while (next < paths.size()) {
+            const std::size_t fileIndex = next++;
+            const int fd = openForReading(paths[fileIndex], m_options.cachePolicy);
+            if (fd < 0) {
+                onDone(fileIndex, errno);
+                continue;
+            }
+            state = Slot{fd, fileIndex, 0, fileSize(fd)};
+            return true;
+        }
+        return false;
+    };
+
+    std::vector<Slot> slots(m_options.queueDepth);
+    unsigned inFlight = 0;
+    unsigned toSubmit = 0;
+    if (usesUring()) {
+        for (unsigned i = 0; i < slots.size() && openNext(slots[i]); ++i) {
+            queueRead(i, slots[i]);
+            ++inFlight;
+            ++toSubmit;
+        }
+    }
+
+#ifdef __linux__
+    try {
+        while (inFlight > 0) {
+            int submitted = submitAndWait(toSubmit);
+            if (submitted < 0 && (submitted == -EAGAIN || submitted == -EBUSY) && inFlight > toSubmit) {
+                // The kernel is short on resources: wait for reads already in
+                // flight and retry the submission on the next round.
+                submitted = submitAndWait(0);
+            }
+            if (submitted < 0) {
+                throw std::system_error(-submitted, std::generic_category(), "io_uring_enter");
+            }
+            toSubmit -= std::min(toSubmit, static_cast<unsigned>(submitted));
+
+            unsigned head = *m_cqHead;
+            const unsigned tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+            for (; head != tail; ++head) {
+                const auto &cqe = static_cast<const io_uring_cqe *>(m_cqes)[head & *m_cqMask];
+                const auto slot = static_cast<unsigned>(cqe.user_data);
+                Slot &state = slots[slot];
+                const int result = cqe.res;
+
+                if (result == -EINTR || result == -EAGAIN || (result == -EINVAL && dropDirectIo(state.fd))) {
+                    queueRead(slot, state);
+                    ++toSubmit;
+                    continue;
+                }
+                bool finished = result <= 0;
+                if (result > 0) {
+                    onChunk(state.fileIndex, buffer(slot), static_cast<std::size_t>(result));
+                    state.offset += static_cast<std::uint64_t>(result);
+                    // A short read at the size seen at open is the end; a file
+                    // that grew meanwhile is read on until a read returns 0.
+                    finished = static_cast<std::size_t>(result) < m_options.chunkSize && state.offset >= state.size;
+                }
+                if (!finished) {
+                    queueRead(slot, state);
+                    ++toSubmit;
+                    continue;
+                }
+                releaseCachedPages(state.fd, m_options.cachePolicy);
+                ::close(state.fd);
+                state.fd = -1;
+                onDone(state.fileIndex, result < 0 ? -result : 0);
+                --inFlight;
+                if (openNext(state)) {
+                    queueRead(slot, state);
+                    ++inFlight;
+                    ++toSubmit;
+                }
+            }
+            __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+        }
+    } catch (...) {
+        // A throwing sink or a broken ring: drop the ring so no read still in
+        // flight can complete into a buffer that is reused later.
+        teardownRing();
+        for (Slot &state : slots) {
+            if (state.fd >= 0) {
+                ::close(state.fd);
+            }
+        }
+        throw;
+    }
+#endif
+
+    Slot state;
+    while (openNext(state)) {
+        readBlocking(state, buffer(0), onChunk, onDone);
+    }
+}
+
+} // namespace core
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "FileReader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace core {
+
+struct UringReaderOptions {
+    unsigned queueDepth = 32;           // reads in flight, one per open file
+    std::size_t chunkSize = 256 * 1024; // bytes per read; one buffer per queue slot
+    CachePolicy cachePolicy = CachePolicy::Keep;
+};
+
+// Reads many files at once through one io_uring owned by the calling thread.
+// Up to queueDepth files are open concurrently, each with one read in flight,
+// so every file's chunks still arrive in order while the device sees a deep
+// queue. The buffers are registered with the ring when RLIMIT_MEMLOCK allows
+// (IORING_OP_READ_FIXED) and used as plain buffers otherwise. The buffers and
+// offsets are page aligned, so CachePolicy::Direct reads need no bounce.
+//
+// Without io_uring (old kernel, seccomp, non-Linux) the same interface is
+// served with blocking reads, one file at a time.
+//
+// Not thread-safe: use one reader per thread.
+class UringReader {
+public:
+    // Gets each chunk of file number fileIndex, in file order. The data is
+    // only valid during the call.
+    using ChunkSink = std::function<void(std::size_t fileIndex, const unsigned char *data, std::size_t size)>;
+    // Called once per file after its last chunk; error is an errno value, 0
+    // when the whole file was read.
+    using DoneSink = std::function<void(std::size_t fileIndex, int error)>;
+
+    explicit UringReader(UringReaderOptions options = {});
+    ~UringReader();
+
+    UringReader(const UringReader &) = delete;
+    UringReader &operator=(const UringReader &) = delete;
+
+    bool usesUring() const { return m_ringFd >= 0; }
+    const UringReaderOptions &options() const { return m_options; }
+
+    void readFiles(const std::vector<std::string> &paths, const ChunkSink &onChunk, const DoneSink &onDone);
+
+private:
+    struct Slot {
+        int fd = -1;
+        std::size_t fileIndex = 0;
+        std::uint64_t offset = 0;
+        std::uint64_t size = 0;
+    };
+
+    bool setupRing();
+    void teardownRing();
+    unsigned char *buffer(unsigned slot) const { return m_buffers + static_cast<std::size_t>(slot) * m_options.chunkSize; }
+    void queueRead(unsigned slot, const Slot &state);
+    int submitAndWait(unsigned toSubmit);
+    void readBlocking(Slot &state, unsigned char *buffer, const ChunkSink &onChunk, const DoneSink &onDone);
+
+    UringReaderOptions m_options;
+    unsigned char *m_buffers = nullptr;
+    int m_ringFd = -1;
+    bool m_fixedBuffers = false;
+
+    void *m_sqRing = nullptr;
+    void *m_cqRing = nullptr;
+    void *m_sqes = nullptr;
+    std::size_t m_sqRingSize = 0;
+    std::size_t m_cqRingSize = 0;
+    std::size_t m_sqesSize = 0;
+    unsigned *m_sqTail = nullptr;
+    unsigned *m_sqMask = nullptr;
+    unsigned *m_sqArray = nullptr;
+    unsigned *m_cqHead = nullptr;
+    unsigned *m_cqTail = nullptr;
+    unsigned *m_cqMask = nullptr;
+    void *m_cqes = nullptr;
+};
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace core {
+
+// Fixed-size thread pool with one task deque per worker. A worker pops from
+// the back of its own deque and, when that runs dry, steals from the front of
+// the others. Tasks submitted from inside a worker land on that worker's deque,
+// so recursive work (e.g. subdirectories) stays local until someone is idle.
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    // threadCount == 0 sizes the pool with availableCpuCount().
+    explicit WorkStealingPool(unsigned threadCount = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    void submit(Task task);
+    // Blocks until every submitted task, including ones spawned by tasks, has
+    // finished. Rethrows the first exception thrown by a task.
+    void wait();
+    // True when no task is queued or running; a snapshot for polling callers.
+    bool isIdle() const { return m_pending.load() == 0; }
+    unsigned threadCount() const { return static_cast<unsigned>(m_threads.size()); }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void run(unsigned index);
+    bool popLocal(unsigned index, Task &task);
+    bool steal(unsigned index, Task &task);
+    void finishTask();
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    std::condition_variable m_idle;
+    std::atomic<std::size_t> m_queued{0};
+    std::atomic<std::size_t> m_pending{0};
+    std::atomic<unsigned> m_nextQueue{0};
+    std::exception_ptr m_error;
+    bool m_stopping = false;
+};
+
+}
@@ -0,0 +1,58 @@
+#include "BaselineIndex.h"
+
+#include <algorithm>
+#include <utility>
+
+BaselineIndex::BaselineIndex(QVector<FileRecordEntry> records)
+    : m_records(std::move(records)), m_present(new std::atomic<bool>[static_cast<std::size_t>(m_records.size())]) {
+    m_byPath.reserve(m_records.size());
+    m_sorted.reserve(m_records.size());
+    for (int slot = 0; slot < m_records.size(); ++slot) {
+        const FileMetadata &metadata = m_records[slot].metadata;
+        m_byPath.insert(metadata.path, slot);
+        if (metadata.inode != 0 && m_records[slot].status != QLatin1String("Deleted")) {
+            m_byInode.insert(qMakePair(metadata.device, metadata.inode), slot);
+        }
+        m_sorted.append(slot);
+        m_present[static_cast<std::size_t>(slot)] = false;
+    }
+    // Sorted here rather than taken in SQL order: SQLite compares UTF-8 bytes,
+    // QString UTF-16 units, and withPrefix() relies on the latter.
+    std::sort(m_sorted.begin(), m_sorted.end(),
+              [this](int a, int b) { return m_records[a].metadata.path < m_records[b].metadata.path; });
+}
+
+const FileRecordEntry *BaselineIndex::find(const QString &path) const {
+    const auto it = m_byPath.constFind(path);
+    return it == m_byPath.constEnd() ? nullptr : &m_records[it.value()];
+}
+
+QVector<const FileRecordEntry *> BaselineIndex::findByInode(quint64 device, quint64 inode) const {
+    QVector<const FileRecordEntry *> rows;
+    for (const int slot : m_byInode.values(qMakePair(device, inode))) {
+        rows.append(&m_records[slot]);
+    }
+    return rows;
+}
+
+QVector<const FileRecordEntry *> BaselineIndex::withPrefix(const QString &prefix) const {
+    QVector<const FileRecordEntry *> rows;
+    auto it = std::lower_bound(m_sorted.cbegin(), m_sorted.cend(), prefix,
+                               [this](int slot, const QString &key) { return m_records[slot].metadata.path < key; });
+    for (; it != m_sorted.cend() && m_records[*it].metadata.path.startsWith(prefix); ++it) {
+        rows.append(&m_records[*it]);
+    }
+    return rows;
+}
+
+void BaselineIndex::markPresent(const QString &path) {
+    const auto it = m_byPath.constFind(path);
+    if (it != m_byPath.constEnd()) {
+        m_present[static_cast<std::size_t>(it.value())].store(true, std::memory_order_relaxed);
+    }
+}
+
+bool BaselineIndex::isPresent(const FileRecordEntry &record) const {
+    const auto slot = static_cast<std::size_t>(&record - m_records.constData());
+    return slot < static_cast<std::size_t>(m_records.size()) && m_present[slot].load(std::memory_order_relaxed);
+}
@@ -0,0 +1,45 @@
+#ifndef BASELINEINDEX_H
+#define BASELINEINDEX_H
+
+#include "DatabaseManager.h"
+
+#include <QHash>
+#include <QMultiHash>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+#include <memory>
+
+// The stored rows a scan compares against, loaded once and looked up by path
+// or by (device, inode) with no further database queries. Once built, it is
+// only read, apart from the presence flags, so walker threads may use it
+// concurrently.
+class BaselineIndex {
+public:
+    BaselineIndex() = default;
+    explicit BaselineIndex(QVector<FileRecordEntry> records);
+
+    const QVector<FileRecordEntry> &records() const { return m_records; }
+    // The row stored under path, or null.
+    const FileRecordEntry *find(const QString &path) const;
+    // Rows not marked deleted whose file had this device and inode when they
+    // were written; hard links share one.
+    QVector<const FileRecordEntry *> findByInode(quint64 device, quint64 inode) const;
+    // Rows whose path starts with prefix, in path order.
+    QVector<const FileRecordEntry *> withPrefix(const QString &prefix) const;
+
+    // Records that a directory listing contained path. Thread-safe.
+    void markPresent(const QString &path);
+    bool isPresent(const FileRecordEntry &record) const;
+
+private:
+    QVector<FileRecordEntry> m_records;
+    QHash<QString, int> m_byPath;
+    QMultiHash<QPair<quint64, quint64>, int> m_byInode;
+    QVector<int> m_sorted; // slots in path order
+    std::unique_ptr<std::atomic<bool>[]> m_present;
+};
+
+#endif // BASELINEINDEX_H
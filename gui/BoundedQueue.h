@@ -0,0 +1,77 @@
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <QDeadlineTimer>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QQueue>
+#include <QWaitCondition>
+#include <QtGlobal>
+
+#include <utility>
+
+// Multi-producer queue with a fixed capacity: push() blocks while the queue is
+// full so fast producers cannot run ahead of a slow consumer. close() wakes
+// everyone up; pushes after that are rejected.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(int capacity) : m_capacity(qMax(1, capacity)) {}
+
+    bool push(T value) {
+        QMutexLocker locker(&m_mutex);
+        while (!m_closed && m_items.size() >= m_capacity) {
+            m_notFull.wait(&m_mutex);
+        }
+        if (m_closed) {
+            return false;
+        }
+        m_items.enqueue(std::move(value));
+        m_notEmpty.wakeOne();
+        return true;
+    }
+
+    // Waits up to timeoutMs for an item; returns false on timeout or when the
+    // queue is closed and empty.
+    bool pop(T &value, int timeoutMs) {
+        QMutexLocker locker(&m_mutex);
+        QDeadlineTimer deadline(qMax(0, timeoutMs));
+        while (m_items.isEmpty() && !m_closed) {
+            if (!m_notEmpty.wait(&m_mutex, deadline)) {
+                break;
+            }
+        }
+        return takeLocked(value);
+    }
+
+    bool tryPop(T &value) {
+        QMutexLocker locker(&m_mutex);
+        return takeLocked(value);
+    }
+
+    void close() {
+        QMutexLocker locker(&m_mutex);
+        m_closed = true;
+        m_notFull.wakeAll();
+        m_notEmpty.wakeAll();
+    }
+
+private:
+    bool takeLocked(T &value) {
+        if (m_items.isEmpty()) {
+            return false;
+        }
+        value = m_items.dequeue();
+        m_notFull.wakeOne();
+        return true;
+    }
+
+    QMutex m_mutex;
+    QWaitCondition m_notEmpty;
+    QWaitCondition m_notFull;
+    QQueue<T> m_items;
+    int m_capacity;
+    bool m_closed = false;
+};
+
+#endif // BOUNDEDQUEUE_H
@@ -0,0 +1,69 @@
+#include "ChangeWatcher.h"
+
+#include <QFileInfo>
+#include <QTimer>
+
+ChangeWatcher::ChangeWatcher(QObject *parent) : QObject(parent) {}
+
+void ChangeWatcher::setDebounce(int debounceMs, int maxDelayMs) {
+    m_debounceMs = qMax(0, debounceMs);
+    m_maxDelayMs = qMax(m_debounceMs, maxDelayMs);
+}
+
+// Hidden entries are skipped like in the directory walk, which does not list
+// them; this also keeps editor swap and temp files out of the batches.
+bool ChangeWatcher::isExcluded(const QString &path) const {
+    return QFileInfo(path).fileName().startsWith(QLatin1Char('.')) || m_excludeRules.matches(path);
+}
+
+void ChangeWatcher::queuePath(const QString &path) {
+    if (isExcluded(path)) {
+        return;
+    }
+    if (m_pending.isEmpty()) {
+        m_batchAge.start();
+    }
+    m_pending.insert(path);
+}
+
+void ChangeWatcher::scheduleFlush() {
+    if (m_pending.isEmpty()) {
+        return;
+    }
+    // Created on first use so that it belongs to the watcher's thread.
+    if (!m_debounceTimer) {
+        m_debounceTimer = new QTimer(this);
+        m_debounceTimer->setSingleShot(true);
+        connect(m_debounceTimer, &QTimer::timeout, this, &ChangeWatcher::flush);
+    }
+    const qint64 untilDeadline = qMax<qint64>(0, m_maxDelayMs - m_batchAge.elapsed());
+    m_debounceTimer->start(static_cast<int>(qMin<qint64>(m_debounceMs, untilDeadline)));
+}
+
+void ChangeWatcher::discardPending() {
+    m_pending.clear();
+    if (m_debounceTimer) {
+        m_debounceTimer->stop();
+    }
+}
+
+// Paths below another pending path are dropped: the ancestor is rescanned
+// (or marked deleted) as a whole subtree anyway.
+void ChangeWatcher::flush() {
+    QStringList paths;
+    paths.reserve(m_pending.size());
+    for (const QString &path : std::as_const(m_pending)) {
+        bool covered = false;
+        for (int slash = path.lastIndexOf(QLatin1Char('/')); slash > 0 && !covered;
+             slash = path.lastIndexOf(QLatin1Char('/'), slash - 1)) {
+            covered = m_pending.contains(path.left(slash));
+        }
+        if (!covered) {
+            paths << path;
+        }
+    }
+    m_pending.clear();
+    if (!paths.isEmpty()) {
+        emit pathsChanged(paths);
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef CHANGEWATCHER_H
+#define CHANGEWATCHER_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+
+#include "FileMonitor.h"
+
+class QTimer;
+
+// Common part of the change notification backends: it collects the paths a
+// backend reports and emits them in coalesced batches. A batch goes out once
+// the trees have been quiet for debounceMs, or at the latest maxDelayMs after
+// its first path, so a file that is written continuously is still reported.
+//
+// A watcher lives on its own thread; start()/stop() are invoked through
+// queued calls.
+class ChangeWatcher : public QObject {
+    Q_OBJECT
+public:
+    explicit ChangeWatcher(QObject *parent = nullptr);
+
+    // Excluded paths are never reported; must be set before start().
+    void setExcludeRules(const QVector<ExcludeRule> &rules) { m_excludeRules = CompiledExcludeRules(rules); }
+    void setDebounce(int debounceMs, int maxDelayMs);
+
+public slots:
+    virtual void start(const QStringList &roots, bool recursive, bool followSymlinks, int maxDepth) = 0;
+    virtual void stop() = 0;
+
+signals:
+    void started();
+    void pathsChanged(const QStringList &paths);
+    // Events were lost (e.g. the kernel queue overflowed); only a full
+    // rescan is safe.
+    void overflowed();
+    void failed(const QString &message);
+
+protected:
+    bool isExcluded(const QString &path) const;
+    void queuePath(const QString &path);
+    // Arms the debounce timer for what queuePath() collected; call once per
+    // drained batch of kernel events.
+    void scheduleFlush();
+    void discardPending();
+
+private:
+    void flush();
+
+    CompiledExcludeRules m_excludeRules;
+    QTimer *m_debounceTimer = nullptr;
+    QElapsedTimer m_batchAge;
+    QSet<QString> m_pending;
+    int m_debounceMs = 2000;
+    int m_maxDelayMs = 10000;
+};
+
+#endif // CHANGEWATCHER_H
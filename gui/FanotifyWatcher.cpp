@@ -0,0 +1,220 @@
+#include "FanotifyWatcher.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSocketNotifier>
+
+#ifdef Q_OS_LINUX
+#include <sys/fanotify.h>
+#include <sys/statfs.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#endif
+
+namespace {
+
+#ifdef Q_OS_LINUX
+// No *_SELF events: a moved or deleted directory is reported by its parent,
+// and a handle to a deleted directory cannot be resolved anyway.
+constexpr quint64 kMarkMask = FAN_CLOSE_WRITE | FAN_MODIFY | FAN_ATTRIB | FAN_CREATE | FAN_DELETE | FAN_MOVED_FROM
+    | FAN_MOVED_TO | FAN_ONDIR;
+constexpr quint64 kDirectoryEntryEvents = FAN_CREATE | FAN_DELETE | FAN_MOVED_FROM | FAN_MOVED_TO;
+constexpr std::size_t kEventBufferSize = 64 * 1024;
+
+template <typename Fsid>
+quint64 fsidKey(const Fsid &fsid) {
+    static_assert(sizeof(Fsid) == sizeof(quint64), "unexpected fsid size");
+    quint64 key = 0;
+    std::memcpy(&key, &fsid, sizeof(key));
+    return key;
+}
+
+QString errnoString() { return QString::fromLocal8Bit(std::strerror(errno)); }
+#endif
+
+}
+
+FanotifyWatcher::FanotifyWatcher(QObject *parent) : ChangeWatcher(parent) {}
+
+FanotifyWatcher::~FanotifyWatcher() { stop(); }
+
+void FanotifyWatcher::start(const QStringList &roots, bool recursive, bool followSymlinks, int maxDepth) {
+    Q_UNUSED(followSymlinks)
+    stop();
+#ifdef Q_OS_LINUX
+    m_recursive = recursive;
+    m_maxDepth = maxDepth;
+
+    m_fd = ::fanotify_init(FAN_CLASS_NOTIF | FAN_CLOEXEC | FAN_NONBLOCK | FAN_REPORT_DFID_NAME, O_RDONLY | O_LARGEFILE);
+    if (m_fd < 0) {
+        emit failed(tr("Не удалось инициализировать fanotify: %1").arg(errnoString()));
+        return;
+    }
+
+    for (const QString &root : roots) {
+        const QString canonical = QFileInfo(root).canonicalFilePath();
+        if (canonical.isEmpty() || isExcluded(canonical)) {
+            continue;
+        }
+        const QByteArray encoded = QFile::encodeName(canonical);
+        struct statfs fs {};
+        if (::statfs(encoded.constData(), &fs) != 0) {
+            continue;
+        }
+        const quint64 fsid = fsidKey(fs.f_fsid);
+        if (!m_mountFds.contains(fsid)) {
+            if (::fanotify_mark(m_fd, FAN_MARK_ADD | FAN_MARK_FILESYSTEM, kMarkMask, AT_FDCWD, encoded.constData()) != 0) {
+                emit failed(tr("Не удалось подписаться на события файловой системы %1: %2").arg(canonical, errnoString()));
+                stop();
+                return;
+            }
+            const int mountFd = ::open(encoded.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (mountFd < 0) {
+                emit failed(tr("Не удалось открыть %1: %2").arg(canonical, errnoString()));
+                stop();
+                return;
+            }
+            m_mountFds.insert(fsid, mountFd);
+        }
+        m_roots.append(Root{canonical, QDir(root).absolutePath()});
+    }
+
+    m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &FanotifyWatcher::readEvents);
+    emit started();
+#else
+    Q_UNUSED(roots)
+    Q_UNUSED(recursive)
+    Q_UNUSED(maxDepth)
+    emit failed(tr("Мониторинг по событиям поддерживается только в Linux"));
+#endif
+}
+
+// May run from inside readEvents(), so the notifier is disabled and deleted
+// later rather than destroyed under its own signal.
+void FanotifyWatcher::stop() {
+    if (m_notifier) {
+        m_notifier->setEnabled(false);
+        m_notifier->deleteLater();
+        m_notifier = nullptr;
+    }
+#ifdef Q_OS_LINUX
+    for (const int mountFd : std::as_const(m_mountFds)) {
+        ::close(mountFd);
+    }
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+#endif
+    m_mountFds.clear();
+    m_roots.clear();
+    discardPending();
+}
+
+// Returns the current path of the directory behind a file handle, or an
+// empty string when it is gone (ESTALE) or on an unknown filesystem.
+QString FanotifyWatcher::resolveDirectory(quint64 fsid, void *handle) const {
+#ifdef Q_OS_LINUX
+    const auto mount = m_mountFds.constFind(fsid);
+    if (mount == m_mountFds.constEnd()) {
+        return {};
+    }
+    const int dirFd = ::open_by_handle_at(mount.value(), static_cast<struct file_handle *>(handle), O_PATH | O_CLOEXEC);
+    if (dirFd < 0) {
+        return {};
+    }
+    char target[PATH_MAX];
+    const QByteArray link = "/proc/self/fd/" + QByteArray::number(dirFd);
+    const ssize_t length = ::readlink(link.constData(), target, sizeof(target));
+    ::close(dirFd);
+    if (length <= 0 || length >= static_cast<ssize_t>(sizeof(target))) {
+        return {};
+    }
+    return QFile::decodeName(QByteArray(target, static_cast<int>(length)));
+#else
+    Q_UNUSED(fsid)
+    Q_UNUSED(handle)
+    return {};
+#endif
+}
+
+// Maps a kernel path onto the configured root it belongs to, or returns an
+// empty string when it is outside every monitored tree or below the depth
+// limit. A file counts at the depth of its directory.
+QString FanotifyWatcher::monitoredPath(const QString &path, bool isDirectory) const {
+    for (const Root &root : m_roots) {
+        if (path != root.canonicalPath && !path.startsWith(root.canonicalPath + QLatin1Char('/'))) {
+            continue;
+        }
+        const QString relative = path.mid(root.canonicalPath.size());
+        const int depth = relative.count(QLatin1Char('/')) - (isDirectory ? 0 : 1);
+        const bool withinDepth = m_recursive ? (m_maxDepth < 0 || depth <= m_maxDepth) : depth <= 0;
+        if (withinDepth) {
+            return root.configuredPath + relative;
+        }
+    }
+    return {};
+}
+
+void FanotifyWatcher::readEvents() {
+#ifdef Q_OS_LINUX
+    alignas(struct fanotify_event_metadata) char buffer[kEventBufferSize];
+    while (true) {
+        ssize_t length = ::read(m_fd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;
+        }
+        const auto *event = reinterpret_cast<const struct fanotify_event_metadata *>(buffer);
+        for (; FAN_EVENT_OK(event, length); event = FAN_EVENT_NEXT(event, length)) {
+            if (event->vers != FANOTIFY_METADATA_VERSION) {
+                emit failed(tr("Несовместимая версия fanotify"));
+                stop();
+                return;
+            }
+            if (event->mask & FAN_Q_OVERFLOW) {
+                discardPending();
+                emit overflowed();
+                continue;
+            }
+            const bool isDirectory = event->mask & FAN_ONDIR;
+            // Attribute changes on a directory would only trigger a useless
+            // subtree rescan.
+            if (isDirectory && !(event->mask & kDirectoryEntryEvents)) {
+                continue;
+            }
+
+            const char *const end = reinterpret_cast<const char *>(event) + event->event_len;
+            for (const char *info = reinterpret_cast<const char *>(event) + event->metadata_len; info < end;) {
+                const auto *header = reinterpret_cast<const struct fanotify_event_info_header *>(info);
+                if (header->len == 0) {
+                    break;
+                }
+                info += header->len;
+                if (header->info_type != FAN_EVENT_INFO_TYPE_DFID_NAME) {
+                    continue;
+                }
+                const auto *fid = reinterpret_cast<const struct fanotify_event_info_fid *>(header);
+                auto *handle = reinterpret_cast<struct file_handle *>(const_cast<unsigned char *>(fid->handle));
+                const QString directory = resolveDirectory(fsidKey(fid->fsid), handle);
+                if (directory.isEmpty()) {
+                    continue;
+                }
+                const char *name = reinterpret_cast<const char *>(handle->f_handle + handle->handle_bytes);
+                const QString path = std::strcmp(name, ".") == 0
+                    ? directory
+                    : QDir(directory).filePath(QFile::decodeName(name));
+                const QString mapped = monitoredPath(path, isDirectory);
+                if (!mapped.isEmpty()) {
+                    queuePath(mapped);
+                }
+            }
+        }
+    }
+    scheduleFlush();
+#endif
+}
@@ -0,0 +1,48 @@
+#ifndef FANOTIFYWATCHER_H
+#define FANOTIFYWATCHER_H
+
+#include <QHash>
+#include <QVector>
+
+#include "ChangeWatcher.h"
+
+class QSocketNotifier;
+
+// fanotify backend: one FAN_MARK_FILESYSTEM mark per filesystem holding a
+// monitored directory, so the cost does not grow with the number of
+// directories. Events carry the parent directory's file handle and the entry
+// name (FAN_REPORT_DFID_NAME); the handle is resolved to a path and events
+// outside the monitored trees are dropped.
+//
+// Needs CAP_SYS_ADMIN for the mark and CAP_DAC_READ_SEARCH to resolve handles;
+// start() fails otherwise. Symlinked directories are not followed: the kernel
+// reports real paths, which are matched against the canonical roots.
+class FanotifyWatcher : public ChangeWatcher {
+    Q_OBJECT
+public:
+    explicit FanotifyWatcher(QObject *parent = nullptr);
+    ~FanotifyWatcher() override;
+
+public slots:
+    void start(const QStringList &roots, bool recursive, bool followSymlinks, int maxDepth) override;
+    void stop() override;
+
+private:
+    struct Root {
+        QString canonicalPath;
+        QString configuredPath; // the form stored in the database
+    };
+
+    void readEvents();
+    QString resolveDirectory(quint64 fsid, void *handle) const;
+    QString monitoredPath(const QString &path, bool isDirectory) const;
+
+    int m_fd = -1;
+    QSocketNotifier *m_notifier = nullptr;
+    QHash<quint64, int> m_mountFds; // fsid -> directory descriptor on that filesystem
+    QVector<Root> m_roots;
+    bool m_recursive = true;
+    int m_maxDepth = 20;
+};
+
+#endif // FANOTIFYWATCHER_H
@@ -1,291 +1,1280 @@
 #include "FileMonitor.h"
 
-#include <QCryptographicHash>
+#include "BaselineIndex.h"
+#include "BoundedQueue.h"
+#include "MerkleHash.h"
+#include "core/Blake3.h"
+#include "core/Blake3Hasher.h"
+#include "core/DeviceScheduler.h"
+#include "core/FileReader.h"
+#include "core/ReadOrder.h"
+#include "core/SampledDigest.h"
+#include "core/Sha256.h"
+#include "core/Sha256Hasher.h"
+#include "core/SystemInfo.h"
+#include "core/UringReader.h"
+#include "core/WorkStealingPool.h"
+
 #include <QDateTime>
 #include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QFileInfo>
-#include <QByteArrayView>
 #include <QSet>
 #include <QPair>
 #include <QObject>
 #include <QStringList>
 #include <QDebug>
+#include <QHash>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <utility>
 #ifdef Q_OS_UNIX
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 FileMonitor::FileMonitor(DatabaseManager &databaseManager, QString scannerVersion)
     : m_databaseManager(databaseManager), m_scannerVersion(std::move(scannerVersion)) {}
 
-QString FileMonitor::calculateHash(const QString &filePath, QString *errorReason) const {
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly)) {
+void FileMonitor::setScanTuning(const ScanTuning &tuning) {
+    m_tuning = tuning;
+    m_quickVerifyInclude = CompiledExcludeRules(tuning.quickVerifyInclude);
+    m_quickVerifyExclude = CompiledExcludeRules(tuning.quickVerifyExclude);
+}
+
+namespace {
+
+QString readErrorText(int error) {
+    if (error == EACCES || error == EPERM) {
+        return QObject::tr("Недостаточно прав (Permission denied)");
+    }
+    return QString::fromLocal8Bit(std::strerror(error));
+}
+
+void setExtraDigests(FileMetadata &metadata, const core::DigestSet &digests) {
+    metadata.sha512 = QString::fromStdString(digests.sha512);
+    metadata.md5 = QString::fromStdString(digests.md5);
+}
+
+const quint64 kUserPermissions = QFile::ReadUser | QFile::WriteUser | QFile::ExeUser;
+
+HistoryRecord historyEntry(const QString &path,
+                           int oldStatus,
+                           int newStatus,
+                           const QString &oldHash,
+                           const QString &newHash,
+                           const QString &comment) {
+    HistoryRecord entry;
+    entry.scanTime = QDateTime::currentDateTimeUtc();
+    entry.filePath = path;
+    entry.oldStatus = oldStatus;
+    entry.newStatus = newStatus;
+    entry.oldHash = oldHash;
+    entry.newHash = newHash;
+    entry.comment = comment;
+    return entry;
+}
+
+// A row under another path with the same inode and content whose file was
+// not listed by this scan: most likely where a new file was moved from.
+const FileRecordEntry *movedFrom(const FileRecordEntry &record, const BaselineIndex &storedRows) {
+    for (const FileRecordEntry *row : storedRows.findByInode(record.metadata.device, record.metadata.inode)) {
+        if (row->metadata.path != record.metadata.path && row->metadata.hash == record.metadata.hash
+            && !storedRows.isPresent(*row)) {
+            return row;
+        }
+    }
+    return nullptr;
+}
+
+#ifdef Q_OS_UNIX
+// QFile::Permissions from a mode, without the access() calls QFileInfo makes
+// for the *User flags: those take the owner, group or other bits, whichever
+// class the scanning account falls in, and everything for root.
+quint64 qtPermissions(const core::FileStat &stat) {
+    const quint64 owner = (stat.mode >> 6) & 7;
+    const quint64 group = (stat.mode >> 3) & 7;
+    const quint64 other = stat.mode & 7;
+    quint64 user = other;
+    if (::geteuid() == 0) {
+        user = 6 | ((owner | group | other) & 1);
+    } else if (stat.uid == ::geteuid()) {
+        user = owner;
+    } else if (stat.gid == ::getegid()) {
+        user = group;
+    }
+    return (owner << 12) | (user << 8) | (group << 4) | other;
+}
+#endif
+
+}
+
+QString FileMonitor::calculateHash(const QString &filePath, QString *errorReason, FileMetadata *extraDigests) const {
+    const std::string path = QFile::encodeName(filePath).toStdString();
+    int error = 0;
+    QString hash;
+    if (extraDigests && m_tuning.extraDigests != 0) {
+        core::FileReaderOptions options;
+        options.cachePolicy = m_cachePolicy;
+        core::DigestSet digests;
+        error = core::MultiDigest::hashFile(path, core::DigestSha256 | m_tuning.extraDigests, options, m_readThrottle, digests);
+        if (error == 0) {
+            hash = QString::fromStdString(digests.sha256);
+            setExtraDigests(*extraDigests, digests);
+        }
+    } else {
+        core::Sha256HasherOptions options;
+        options.cachePolicy = m_cachePolicy;
+        options.throttle = m_readThrottle;
+        core::Sha256::Digest digest;
+        error = core::Sha256Hasher::hashFile(path, options, digest);
+        hash = QByteArray(reinterpret_cast<const char *>(digest.data()), static_cast<qsizetype>(digest.size())).toHex();
+    }
+    if (errorReason) {
+        errorReason->clear();
+    }
+    if (error != 0) {
         if (errorReason) {
-            errorReason->clear();
-            if (file.error() == QFileDevice::PermissionsError) {
-                *errorReason = QObject::tr("Недостаточно прав (Permission denied)");
-            } else {
-                *errorReason = file.errorString();
-            }
+            *errorReason = readErrorText(error);
+        }
+        return {};
+    }
+    return hash;
+}
+
+namespace {
+
+// Commits the writer's open transaction every maxRows written rows or every
+// intervalMs milliseconds, so a long scan is persisted in bounded groups
+// instead of one giant transaction. The file and history rows queued in
+// writes go to the database as multi-row statements just before a commit.
+class GroupCommitter {
+public:
+    GroupCommitter(DatabaseManager &databaseManager, int maxRows, int intervalMs, PendingWrites &writes)
+        : m_databaseManager(databaseManager),
+          m_maxRows(qMax(1, maxRows)),
+          m_intervalMs(qMax(1, intervalMs)),
+          m_writes(writes) {}
+
+    bool begin() {
+        if (!m_databaseManager.beginTransaction()) {
+            return false;
+        }
+        m_open = true;
+        m_rows = 0;
+        m_timer.start();
+        return true;
+    }
+
+    bool rowWritten() {
+        ++m_rows;
+        return commitIfDue();
+    }
+
+    bool commitIfDue() {
+        if (m_rows < m_maxRows && m_timer.elapsed() < m_intervalMs) {
+            return true;
+        }
+        if (m_rows == 0) {
+            m_timer.restart();
+            return true;
+        }
+        return commit() && begin();
+    }
+
+    int msUntilDue() const {
+        return static_cast<int>(qMax<qint64>(0, m_intervalMs - m_timer.elapsed()));
+    }
+
+    bool commit() {
+        m_open = false;
+        const bool flushed = m_databaseManager.upsertFileRecords(m_writes.files)
+            && m_databaseManager.insertHistoryRecords(m_writes.history)
+            && m_databaseManager.removeFileState(m_writes.removedPaths);
+        m_writes.clear();
+        if (!flushed || !m_databaseManager.commitTransaction()) {
+            m_databaseManager.rollbackTransaction();
+            return false;
+        }
+        return true;
+    }
+
+    void rollback() {
+        m_writes.clear();
+        if (m_open) {
+            m_databaseManager.rollbackTransaction();
+            m_open = false;
+        }
+    }
+
+private:
+    DatabaseManager &m_databaseManager;
+    int m_maxRows;
+    int m_intervalMs;
+    PendingWrites &m_writes;
+    int m_rows = 0;
+    bool m_open = false;
+    QElapsedTimer m_timer;
+};
+
+constexpr int kIdlePollMs = 50;
+constexpr std::size_t kPrefetchBatch = 4;
+constexpr std::size_t kOrderedBatch = 256;
+// Files below core::kSmallFileBytes handed to one hashing task, so that
+// Sha256::hashMany() has several messages to interleave.
+constexpr std::size_t kSmallFileBatch = 16;
+// A stored midstate is checked against this many bytes before its length.
+constexpr qint64 kMidstateTailBytes = 4096;
+// Smaller files are cheap to reread, so they get no midstate row.
+constexpr qint64 kMinMidstateBytes = 64 * 1024;
+
+// Pool threads live for one scan, so each gets its own ring and buffers.
+core::UringReader &threadUringReader(unsigned queueDepth, core::CachePolicy cachePolicy) {
+    thread_local std::unique_ptr<core::UringReader> reader;
+    if (!reader || reader->options().queueDepth != queueDepth || reader->options().cachePolicy != cachePolicy) {
+        core::UringReaderOptions options;
+        options.queueDepth = queueDepth;
+        options.cachePolicy = cachePolicy;
+        reader = std::make_unique<core::UringReader>(options);
+    }
+    return *reader;
+}
+
+// Stable across runs, unlike qHash, which is seeded per process.
+int rotationBucket(const QString &path, int buckets) {
+    quint32 hash = 2166136261u;
+    for (const QChar ch : path) {
+        hash = (hash ^ ch.unicode()) * 16777619u;
+    }
+    return static_cast<int>(hash % static_cast<quint32>(buckets));
+}
+
+// SHA-256 of the kMidstateTailBytes (or fewer) bytes before length; empty
+// when they cannot be read in full.
+QByteArray tailDigest(const std::string &path, qint64 length) {
+    const qint64 offset = qMax<qint64>(0, length - kMidstateTailBytes);
+    core::Sha256 sha;
+    const int error = core::readFileRange(path,
+                                          static_cast<std::uint64_t>(offset),
+                                          static_cast<std::uint64_t>(length - offset),
+                                          [&sha](const unsigned char *data, std::size_t size) { sha.update(data, size); });
+    if (error != 0 || sha.length() != static_cast<std::uint64_t>(length - offset)) {
+        return {};
+    }
+    const core::Sha256::Digest digest = sha.digest();
+    return QByteArray(reinterpret_cast<const char *>(digest.data()), static_cast<qsizetype>(digest.size()));
+}
+
+bool grewSince(const FileMetadata &metadata, const HashMidstate *midstate) {
+    return midstate && midstate->device == metadata.device && midstate->inode == metadata.inode
+        && midstate->length < metadata.size && !midstate->tailDigest.isEmpty();
+}
+
+// Sha256::Digest and Blake3::Digest are the same 32-byte array.
+QString hexDigest(const core::Sha256::Digest &digest) {
+    return QByteArray(reinterpret_cast<const char *>(digest.data()), static_cast<qsizetype>(digest.size())).toHex();
+}
+
+QString algorithmName(HashAlgorithm algorithm) {
+    return algorithm == HashAlgorithm::Blake3 ? QStringLiteral("BLAKE3") : QStringLiteral("SHA-256");
+}
+
+// Feeds one file to the hash its row is written with, to the configured
+// extra digests and, while the row moves to another algorithm, to a hash in
+// the stored one as well.
+class RowHasher {
+public:
+    RowHasher(HashAlgorithm algorithm, HashAlgorithm storedAlgorithm, unsigned extraDigests)
+        : m_algorithm(algorithm), m_storedAlgorithm(storedAlgorithm), m_extra(extraDigests) {}
+
+    void update(const unsigned char *data, std::size_t size) {
+        if (uses(HashAlgorithm::Sha256)) {
+            m_sha.update(data, size);
+        }
+        if (uses(HashAlgorithm::Blake3)) {
+            m_blake3.update(data, size);
+        }
+        m_extra.update(data, size);
+    }
+
+    QString hash() const { return hexIn(m_algorithm); }
+    // Empty unless the algorithms differ.
+    QString storedHash() const { return m_storedAlgorithm == m_algorithm ? QString() : hexIn(m_storedAlgorithm); }
+    // Only fed when one of the algorithms is SHA-256.
+    const core::Sha256 &sha256() const { return m_sha; }
+    core::DigestSet extraDigests() const { return m_extra.result(); }
+
+private:
+    bool uses(HashAlgorithm algorithm) const { return m_algorithm == algorithm || m_storedAlgorithm == algorithm; }
+    QString hexIn(HashAlgorithm algorithm) const {
+        return hexDigest(algorithm == HashAlgorithm::Blake3 ? m_blake3.digest() : m_sha.digest());
+    }
+
+    HashAlgorithm m_algorithm;
+    HashAlgorithm m_storedAlgorithm;
+    core::Sha256 m_sha;
+    core::Blake3 m_blake3;
+    core::MultiDigest m_extra;
+};
+
+FileRecordEntry databaseFailure(const QString &error) {
+    FileRecordEntry failure;
+    failure.status = QStringLiteral("Error");
+    failure.errorReason = error;
+    return failure;
+}
+
+}
+
+// Only rows whose signature (which covers the fingerprint) verifies are
+// trusted to skip hashing.
+QHash<QString, FileMonitor::BaselineFingerprint> FileMonitor::loadBaseline(const QVector<FileRecordEntry> &records) const {
+    QHash<QString, BaselineFingerprint> baseline;
+    if (!m_tuning.fastIncremental && m_tuning.quickVerifyThresholdBytes <= 0) {
+        return baseline;
+    }
+    baseline.reserve(records.size());
+    for (const auto &record : records) {
+        if (!record.signatureValid || record.metadata.hash.isEmpty()
+            || (record.metadata.mtimeNs == 0 && record.metadata.ctimeNs == 0)
+            || record.status == QLatin1String("Deleted") || record.status == QLatin1String("Error")) {
+            continue;
+        }
+        // Without fastIncremental only a quick-verify sample can settle a file.
+        if (!m_tuning.fastIncremental && record.metadata.sampleHash.isEmpty()) {
+            continue;
+        }
+        BaselineFingerprint fingerprint;
+        fingerprint.device = record.metadata.device;
+        fingerprint.inode = record.metadata.inode;
+        fingerprint.size = record.metadata.size;
+        fingerprint.mtimeNs = record.metadata.mtimeNs;
+        fingerprint.ctimeNs = record.metadata.ctimeNs;
+        fingerprint.hash = record.metadata.hash;
+        fingerprint.sampleHash = record.metadata.sampleHash;
+        fingerprint.verifyTier = record.verifyTier;
+        fingerprint.hashAlgorithm = record.metadata.hashAlgorithm;
+        fingerprint.sha512 = record.metadata.sha512;
+        fingerprint.md5 = record.metadata.md5;
+        baseline.insert(record.metadata.path, fingerprint);
+    }
+    return baseline;
+}
+
+// Rows whose hash is not in hashAlgorithm. Kept apart from the baseline,
+// which files due for a full rehash do not get.
+QHash<QString, HashAlgorithm> FileMonitor::loadOtherAlgorithms(const QVector<FileRecordEntry> &records) const {
+    QHash<QString, HashAlgorithm> algorithms;
+    for (const auto &record : records) {
+        if (!record.metadata.hash.isEmpty() && record.metadata.hashAlgorithm != m_tuning.hashAlgorithm) {
+            algorithms.insert(record.metadata.path, record.metadata.hashAlgorithm);
+        }
+    }
+    return algorithms;
+}
+
+// Rows in another algorithm than hashAlgorithm move over at most
+// hashMigrationFilesPerScan per scan: such a file is read once and hashed
+// both ways, and the hash in the old algorithm is what gets compared with
+// the row. The others stay in their algorithm until a later scan has room.
+HashAlgorithm FileMonitor::jobAlgorithm(HashAlgorithm storedAlgorithm, std::atomic<int> &migrations) const {
+    if (storedAlgorithm == m_tuning.hashAlgorithm) {
+        return storedAlgorithm;
+    }
+    if (m_tuning.hashMigrationFilesPerScan > 0 && migrations.fetch_add(1) >= m_tuning.hashMigrationFilesPerScan) {
+        return storedAlgorithm;
+    }
+    return m_tuning.hashAlgorithm;
+}
+
+// Files whose rotationBucket() equals the returned slot are fully rehashed by
+// this scan. The counter is kept per configured root: only scanDirectory(),
+// the full scan of a root, calls this, so every bucket comes round once per
+// fullRehashCycle scans of that root. Targeted rescans (scanPaths()) take no
+// slot and write no meta key. Returns -1 when rotation is off.
+int FileMonitor::nextRotationSlot(const QString &basePath) {
+    const bool shortcuts =
+        m_tuning.fastIncremental || m_tuning.appendOnlyResume || m_tuning.quickVerifyThresholdBytes > 0;
+    if (!shortcuts || m_tuning.fullRehashCycle <= 0) {
+        return -1;
+    }
+    const QString key = QStringLiteral("scan_cycle:%1").arg(basePath);
+    const qint64 cycle = m_databaseManager.metaValue(key).toLongLong();
+    m_databaseManager.setMetaValue(key, QString::number(cycle + 1));
+    return static_cast<int>(cycle % m_tuning.fullRehashCycle);
+}
+
+int FileMonitor::threadCount() const {
+    return m_tuning.scanThreads > 0 ? m_tuning.scanThreads : static_cast<int>(core::availableCpuCount());
+}
+
+// Hashes a record whose metadata is already built and that the baseline
+// did not settle.
+void FileMonitor::hashRecord(FileRecordEntry &record, const HashJob &job) const {
+    const bool migrating = job.algorithm != job.storedAlgorithm;
+    if (hashesInChunks(record.metadata)) {
+        hashChunked(record);
+    } else if (migrating) {
+        hashRow(record, job);
+    } else if (job.algorithm == HashAlgorithm::Blake3) {
+        // Extra digests cannot be split across threads: one in-order read
+        // gives them and the BLAKE3 hash together.
+        if (m_tuning.extraDigests != 0) {
+            hashRow(record, job);
+        } else {
+            hashBlake3(record);
+        }
+    } else if (m_tuning.appendOnlyResume) {
+        hashResumable(record, job.midstate);
+    } else {
+        QString errorReason;
+        record.metadata.hash = calculateHash(job.path, &errorReason, &record.metadata);
+        if (!errorReason.isEmpty()) {
+            record.metadata.errorReason = errorReason;
         }
+    }
+    attachSample(record);
+    stampRecord(record);
+}
+
+// Small plain SHA-256 rows: nothing to resume, chunk, migrate or add, so they can
+// be hashed together by hashSmallFiles().
+bool FileMonitor::hashesAsSmallFile(const FileMetadata &metadata, const HashJob &job) const {
+    return job.algorithm == HashAlgorithm::Sha256 && job.storedAlgorithm == HashAlgorithm::Sha256
+        && m_tuning.extraDigests == 0 && metadata.size < static_cast<qint64>(core::kSmallFileBytes)
+        && !hashesInChunks(metadata);
+}
+
+// Reads the records at owners whole into one buffer and hashes them side by
+// side, instead of one read loop and one digest per file.
+void FileMonitor::hashSmallFiles(std::vector<FileRecordEntry> &records, const std::vector<std::size_t> &owners) const {
+    if (owners.empty()) {
+        return;
+    }
+    std::vector<std::string> paths;
+    paths.reserve(owners.size());
+    for (const std::size_t owner : owners) {
+        paths.push_back(QFile::encodeName(records[owner].metadata.path).toStdString());
+    }
+    core::Sha256HasherOptions options;
+    options.cachePolicy = m_cachePolicy;
+    options.throttle = m_readThrottle;
+    std::vector<core::Sha256::Digest> digests;
+    std::vector<int> errors;
+    core::Sha256Hasher::hashSmallFiles(paths, options, digests, errors);
+    for (std::size_t i = 0; i < owners.size(); ++i) {
+        FileRecordEntry &record = records[owners[i]];
+        if (errors[i] != 0) {
+            record.metadata.errorReason = readErrorText(errors[i]);
+        } else {
+            record.metadata.hash = hexDigest(digests[i]);
+        }
+        attachSample(record);
+        stampRecord(record);
+    }
+}
+
+// Takes the hash from the baseline row without reading the whole file: with
+// fastIncremental when the stat fingerprint matches, and for quick-verify
+// files when the size, the inode and the sampled blocks all match. Returns
+// false when the file has to be hashed.
+bool FileMonitor::settledByBaseline(FileRecordEntry &record, const BaselineFingerprint *baseline) const {
+    // A row without one of the configured extra digests is hashed to get it.
+    if (!baseline || !baseline->hasDigests(m_tuning.extraDigests)) {
+        return false;
+    }
+    auto takeDigests = [&]() {
+        record.metadata.hash = baseline->hash;
+        record.metadata.hashAlgorithm = baseline->hashAlgorithm;
+        record.metadata.sha512 = (m_tuning.extraDigests & core::DigestSha512) ? baseline->sha512 : QString();
+        record.metadata.md5 = (m_tuning.extraDigests & core::DigestMd5) ? baseline->md5 : QString();
+    };
+    if (m_tuning.fastIncremental && baseline->matches(record.metadata)) {
+        takeDigests();
+        record.metadata.sampleHash = baseline->sampleHash;
+        record.verifyTier = baseline->verifyTier;
+        return true;
+    }
+    if (baseline->sampleHash.isEmpty() || baseline->size != record.metadata.size
+        || baseline->device != record.metadata.device || baseline->inode != record.metadata.inode
+        || !quickVerifies(record.metadata)) {
+        return false;
+    }
+    const QString sample = sampleHash(record.metadata);
+    if (sample.isEmpty() || sample != baseline->sampleHash) {
+        return false;
+    }
+    takeDigests();
+    record.metadata.sampleHash = sample;
+    record.verifyTier = VerifyTier::Sampled;
+    return true;
+}
+
+bool FileMonitor::quickVerifies(const FileMetadata &metadata) const {
+    if (m_tuning.quickVerifyThresholdBytes <= 0 || metadata.size < m_tuning.quickVerifyThresholdBytes) {
+        return false;
+    }
+    if (!m_quickVerifyInclude.isEmpty() && !m_quickVerifyInclude.matches(metadata.path)) {
+        return false;
+    }
+    return !m_quickVerifyExclude.matches(metadata.path);
+}
+
+// "sample-<block KiB>k-<blocks>:<hex>", so that samples taken with other
+// parameters never compare equal. The blocks are seeded with a digest of the
+// path keyed like the row signatures, so they cannot be told in advance.
+QString FileMonitor::sampleHash(const FileMetadata &metadata) const {
+    core::SampleOptions options;
+    options.blockSize = static_cast<std::uint64_t>(qMax<qint64>(4096, m_tuning.quickVerifyBlockBytes));
+    options.interiorBlocks = static_cast<unsigned>(qMax(0, m_tuning.quickVerifySamples));
+    const QByteArray seedBytes = m_databaseManager.keyedDigest("sample|" + metadata.path.toUtf8());
+    std::uint64_t seed = 0;
+    std::memcpy(&seed, seedBytes.constData(), qMin<std::size_t>(sizeof(seed), static_cast<std::size_t>(seedBytes.size())));
+
+    const auto size = static_cast<std::uint64_t>(metadata.size);
+    const std::vector<std::uint64_t> offsets = core::sampleOffsets(size, seed, options);
+    if (m_readThrottle) {
+        m_readThrottle->acquire(offsets.size() * options.blockSize);
+    }
+    core::Sha256::Digest digest;
+    const int error = core::sampledDigest(QFile::encodeName(metadata.path).toStdString(), size, offsets,
+                                          options.blockSize, m_cachePolicy, digest);
+    if (error != 0) {
         return {};
     }
+    const QByteArray hex = QByteArray(reinterpret_cast<const char *>(digest.data()),
+                                      static_cast<qsizetype>(digest.size())).toHex();
+    return QStringLiteral("sample-%1k-%2:%3")
+        .arg(options.blockSize / 1024)
+        .arg(options.interiorBlocks)
+        .arg(QString::fromLatin1(hex));
+}
+
+// Gives a fully hashed quick-verify file the sample later scans compare with.
+void FileMonitor::attachSample(FileRecordEntry &record) const {
+    if (!record.metadata.hash.isEmpty() && quickVerifies(record.metadata)) {
+        record.metadata.sampleHash = sampleHash(record.metadata);
+    }
+}
+
+// A file that only grew since its midstate was stored (same inode, larger
+// size) is hashed on from that state, so only the appended bytes are read.
+// The bytes just before the old end are compared with the stored tail digest
+// first, which catches truncate-and-rewrite; an edit further back in the
+// prefix is only found when the file's full-rehash turn comes round. The
+// extra digests have no midstate, so with any configured the whole file is
+// read.
+void FileMonitor::hashResumable(FileRecordEntry &record, const HashMidstate *midstate) const {
+    const std::string path = QFile::encodeName(record.metadata.path).toStdString();
+    core::Sha256 sha;
+    core::MultiDigest extra(m_tuning.extraDigests);
+    const bool resumable = m_tuning.extraDigests == 0 && grewSince(record.metadata, midstate)
+        && tailDigest(path, midstate->length) == midstate->tailDigest;
+    if (resumable && (!sha.restoreState(midstate->state.toStdString())
+                      || sha.length() != static_cast<std::uint64_t>(midstate->length))) {
+        sha = core::Sha256();
+    }
+
+    core::FileReaderOptions options;
+    options.cachePolicy = m_cachePolicy;
+    options.throttled = m_readThrottle != nullptr;
+    const int error = core::readFileRange(path,
+                                          sha.length(),
+                                          std::numeric_limits<std::uint64_t>::max(),
+                                          [this, &sha, &extra](const unsigned char *data, std::size_t size) {
+                                              if (m_readThrottle) {
+                                                  m_readThrottle->acquire(size);
+                                              }
+                                              sha.update(data, size);
+                                              extra.update(data, size);
+                                          },
+                                          options);
+    if (error != 0) {
+        record.metadata.errorReason = readErrorText(error);
+        return;
+    }
+    record.metadata.hash = hexDigest(sha.digest());
+    setExtraDigests(record.metadata, extra.result());
+    keepMidstate(record, sha, midstate);
+}
+
+// Attaches the state at the file's current end to the record unless the
+// stored one already is that state.
+void FileMonitor::keepMidstate(FileRecordEntry &record, const core::Sha256 &sha, const HashMidstate *previous) const {
+    const auto length = static_cast<qint64>(sha.length());
+    if (length < kMinMidstateBytes) {
+        return;
+    }
+    if (previous && previous->length == length && previous->device == record.metadata.device
+        && previous->inode == record.metadata.inode) {
+        return;
+    }
+    HashMidstate midstate;
+    midstate.device = record.metadata.device;
+    midstate.inode = record.metadata.inode;
+    midstate.length = length;
+    const std::string state = sha.saveState();
+    midstate.state = QByteArray(state.data(), static_cast<qsizetype>(state.size()));
+    midstate.tailDigest = tailDigest(QFile::encodeName(record.metadata.path).toStdString(), length);
+    if (!midstate.tailDigest.isEmpty()) {
+        record.midstate = midstate;
+    }
+}
+
+bool FileMonitor::hashesInChunks(const FileMetadata &metadata) const {
+    return m_tuning.merkleThresholdBytes > 0 && metadata.size >= m_tuning.merkleThresholdBytes;
+}
+
+// Page aligned so every chunk can be mapped, and at least 1 MiB.
+qint64 FileMonitor::chunkSize() const {
+    constexpr qint64 kPage = 4096;
+    return qMax<qint64>(1024 * 1024, (m_tuning.merkleChunkBytes + kPage - 1) / kPage * kPage);
+}
+
+// Threads one large file may split across. It is hashed on one of its
+// device's DeviceScheduler workers, so it only gets the share of threadCount()
+// the other workers of that device leave, and a spinning disk keeps reading
+// one range at a time.
+int FileMonitor::fileThreads(const FileMetadata &metadata) const {
+    if (core::isRotationalDevice(metadata.device)) {
+        return 1;
+    }
+    const int workers = m_tuning.solidStateDeviceThreads > 0 ? m_tuning.solidStateDeviceThreads : threadCount();
+    return qMax(1, threadCount() / workers);
+}
+
+// Hashes the chunks of one large file, on a pool of its own when
+// fileThreads() allows more than one thread for it. The extra digests cannot
+// be split, so a file that needs them is hashed a chunk at a time in file
+// order, feeding them from the same read.
+//
+// Every chunk is read even after one differs from the stored digests: the
+// new Merkle root becomes the row's hash, the new leaves are stored for the
+// next scan, and hashChangeNote() lists every changed byte range. Stopping
+// at the first mismatch would leave the file flagged with no new baseline.
+void FileMonitor::hashChunked(FileRecordEntry &record) const {
+    const qint64 size = chunkSize();
+    const qint64 count = qMax<qint64>(1, (record.metadata.size + size - 1) / size);
+    const std::string path = QFile::encodeName(record.metadata.path).toStdString();
+    core::FileReaderOptions options;
+    options.cachePolicy = m_cachePolicy;
+    options.throttled = m_readThrottle != nullptr;
+
+    QByteArray leaves(count * kMerkleDigestSize, Qt::Uninitialized);
+    char *out = leaves.data();
+    std::atomic<int> firstError{0};
+    std::unique_ptr<core::MultiDigest> extra;
+    if (m_tuning.extraDigests != 0) {
+        extra = std::make_unique<core::MultiDigest>(m_tuning.extraDigests);
+    }
+    auto hashLeaf = [this, &path, &options, &firstError, &extra, out, size](qint64 i) {
+        if (firstError != 0) {
+            return;
+        }
+        const unsigned char leafTag = 0;
+        core::Sha256 leaf;
+        leaf.update(&leafTag, 1);
+        const int error = core::readFileRange(
+            path,
+            static_cast<std::uint64_t>(i * size),
+            static_cast<std::uint64_t>(size),
+            [this, &leaf, &extra](const unsigned char *data, std::size_t length) {
+                if (m_readThrottle) {
+                    m_readThrottle->acquire(length);
+                }
+                leaf.update(data, length);
+                if (extra) {
+                    extra->update(data, length);
+                }
+            },
+            options);
+        if (error != 0) {
+            int expected = 0;
+            firstError.compare_exchange_strong(expected, error);
+            return;
+        }
+        const core::Sha256::Digest digest = leaf.digest();
+        std::memcpy(out + i * kMerkleDigestSize, digest.data(), kMerkleDigestSize);
+    };
+    const int threads = extra ? 1 : static_cast<int>(qMin<qint64>(fileThreads(record.metadata), count));
+    if (threads > 1) {
+        core::WorkStealingPool pool(static_cast<unsigned>(threads));
+        for (qint64 i = 0; i < count; ++i) {
+            pool.submit([&hashLeaf, i]() { hashLeaf(i); });
+        }
+        pool.wait();
+    } else {
+        for (qint64 i = 0; i < count && firstError == 0; ++i) {
+            hashLeaf(i);
+        }
+    }
+
+    if (firstError != 0) {
+        record.metadata.errorReason = readErrorText(firstError);
+        return;
+    }
+    record.metadata.hash = merkleHash(size, leaves);
+    record.chunkDigests = leaves;
+    record.chunkSize = size;
+    if (extra) {
+        setExtraDigests(record.metadata, extra->result());
+    }
+}
+
+// BLAKE3 is a tree itself, so a large file is hashed in subtrees, on as many
+// threads as fileThreads() allows, without changing the digest (unlike
+// hashChunked()).
+void FileMonitor::hashBlake3(FileRecordEntry &record) const {
+    core::Blake3HasherOptions options;
+    options.threads = static_cast<unsigned>(fileThreads(record.metadata));
+    options.cachePolicy = m_cachePolicy;
+    options.throttle = m_readThrottle;
+    core::Blake3::Digest digest;
+    const int error = core::Blake3Hasher::hashFile(QFile::encodeName(record.metadata.path).toStdString(), options, digest);
+    if (error != 0) {
+        record.metadata.errorReason = readErrorText(error);
+        return;
+    }
+    record.metadata.hash = hexDigest(digest);
+    record.metadata.hashAlgorithm = HashAlgorithm::Blake3;
+}
+
+// One read for the row's algorithm, the extra digests and, while the row
+// migrates, the stored algorithm; persistRecord() then compares the hash in
+// the stored algorithm and writes the row in the new one.
+void FileMonitor::hashRow(FileRecordEntry &record, const HashJob &job) const {
+    RowHasher hasher(job.algorithm, job.storedAlgorithm, m_tuning.extraDigests);
+    core::FileReaderOptions options;
+    options.cachePolicy = m_cachePolicy;
+    options.throttled = m_readThrottle != nullptr;
+    const int error = core::readFile(QFile::encodeName(record.metadata.path).toStdString(),
+                                     [this, &hasher](const unsigned char *data, std::size_t size) {
+                                         if (m_readThrottle) {
+                                             m_readThrottle->acquire(size);
+                                         }
+                                         hasher.update(data, size);
+                                     },
+                                     options);
+    if (error != 0) {
+        record.metadata.errorReason = readErrorText(error);
+        return;
+    }
+    record.metadata.hash = hasher.hash();
+    record.metadata.hashAlgorithm = job.algorithm;
+    record.storedAlgorithmHash = hasher.storedHash();
+    setExtraDigests(record.metadata, hasher.extraDigests());
+    if (m_tuning.appendOnlyResume && job.algorithm == HashAlgorithm::Sha256) {
+        keepMidstate(record, hasher.sha256(), job.midstate);
+    }
+}
 
-    QCryptographicHash hasher(QCryptographicHash::Sha256);
-    constexpr qint64 bufferSize = 1024 * 1024; // 1 MB
-    QByteArray buffer;
-    buffer.resize(bufferSize);
+void FileMonitor::stampRecord(FileRecordEntry &record) const {
+    record.updatedAt = QDateTime::currentDateTimeUtc();
+    record.lastChecked = record.updatedAt;
+    record.scannerVersion = m_scannerVersion;
+}
 
-    while (!file.atEnd()) {
-        const qint64 bytesRead = file.read(buffer.data(), bufferSize);
-        if (bytesRead > 0) {
-            hasher.addData(QByteArrayView(buffer.constData(), bytesRead));
+// With ioQueueDepth set, hash tasks carry a batch of files so that one
+// io_uring per thread has enough files to keep that many reads in flight.
+// Drop-behind reads batch a few files so the next one can be prefetched, and
+// a read order needs a whole directory's worth of files to sort. Runs of
+// small files are batched up to smallFileBatchSize() regardless.
+std::size_t FileMonitor::hashBatchSize() const {
+    std::size_t size = 1;
+    if (m_tuning.ioQueueDepth > 0) {
+        size = 2 * static_cast<std::size_t>(m_tuning.ioQueueDepth);
+    } else if (m_cachePolicy == core::CachePolicy::DropBehind) {
+        size = kPrefetchBatch;
+    }
+    if (m_tuning.readOrder != core::ReadOrder::Discovery) {
+        size = qMax(size, kOrderedBatch);
+    }
+    return size;
+}
+
+std::size_t FileMonitor::smallFileBatchSize() const {
+    return qMax(hashBatchSize(), kSmallFileBatch);
+}
+
+// Jobs with a baseline go first in discovery order: they are most likely
+// settled by a stat. The rest follow in the configured on-disk order.
+std::vector<FileMonitor::HashJob> FileMonitor::inReadingOrder(const std::vector<HashJob> &jobs) const {
+    if (m_tuning.readOrder == core::ReadOrder::Discovery || jobs.size() < 2) {
+        return jobs;
+    }
+    std::vector<HashJob> ordered;
+    std::vector<HashJob> toOrder;
+    std::vector<std::string> paths;
+    ordered.reserve(jobs.size());
+    for (const HashJob &job : jobs) {
+        if (job.baseline) {
+            ordered.push_back(job);
+        } else {
+            toOrder.push_back(job);
+            paths.push_back(QFile::encodeName(job.path).toStdString());
         }
     }
+    for (const std::size_t index : core::readingOrder(paths, m_tuning.readOrder)) {
+        ordered.push_back(toOrder[index]);
+    }
+    return ordered;
+}
 
-    return hasher.result().toHex();
+std::vector<FileRecordEntry> FileMonitor::hashBatch(const std::vector<HashJob> &batch) const {
+    const std::vector<HashJob> jobs = inReadingOrder(batch);
+    std::vector<FileRecordEntry> records;
+    records.reserve(jobs.size());
+    if (m_tuning.ioQueueDepth <= 0) {
+        std::vector<std::size_t> smallFiles;
+        for (std::size_t i = 0; i < jobs.size(); ++i) {
+            const HashJob &job = jobs[i];
+            FileRecordEntry record;
+            record.metadata = buildMetadata(job);
+            if (job.algorithm == job.storedAlgorithm && settledByBaseline(record, job.baseline)) {
+                stampRecord(record);
+            } else if (hashesAsSmallFile(record.metadata, job)) {
+                smallFiles.push_back(records.size());
+            } else {
+                // A file with a baseline will probably not be read at all.
+                if (m_cachePolicy == core::CachePolicy::DropBehind && i + 1 < jobs.size() && !jobs[i + 1].baseline) {
+                    core::prefetchFile(QFile::encodeName(jobs[i + 1].path).toStdString());
+                }
+                hashRecord(record, job);
+            }
+            records.push_back(std::move(record));
+        }
+        hashSmallFiles(records, smallFiles);
+        return records;
+    }
+
+    std::vector<std::string> toRead;
+    std::vector<std::size_t> owners;
+    std::vector<const HashJob *> readJobs;
+    const std::uint64_t parallelThreshold = core::Blake3HasherOptions().parallelThreshold;
+    for (const HashJob &job : jobs) {
+        FileRecordEntry record;
+        record.metadata = buildMetadata(job);
+        const bool migrating = job.algorithm != job.storedAlgorithm;
+        if (!migrating && settledByBaseline(record, job.baseline)) {
+            stampRecord(record);
+            records.push_back(std::move(record));
+            continue;
+        }
+        if (hashesInChunks(record.metadata)) {
+            hashChunked(record);
+            attachSample(record);
+        } else if (!migrating && job.algorithm == HashAlgorithm::Blake3 && m_tuning.extraDigests == 0
+                   && static_cast<std::uint64_t>(record.metadata.size) >= parallelThreshold) {
+            // Split across threads, which one ring per thread cannot do.
+            hashBlake3(record);
+            attachSample(record);
+        } else if (!migrating && job.algorithm == HashAlgorithm::Sha256 && m_tuning.appendOnlyResume
+                   && m_tuning.extraDigests == 0 && grewSince(record.metadata, job.midstate)) {
+            // Just the appended tail to read, hardly worth the ring.
+            hashResumable(record, job.midstate);
+            attachSample(record);
+        } else {
+            toRead.push_back(QFile::encodeName(job.path).toStdString());
+            owners.push_back(records.size());
+            readJobs.push_back(&job);
+        }
+        stampRecord(record);
+        records.push_back(std::move(record));
+    }
+    if (toRead.empty()) {
+        return records;
+    }
+
+    std::vector<std::unique_ptr<RowHasher>> hashers(toRead.size());
+    threadUringReader(static_cast<unsigned>(m_tuning.ioQueueDepth), m_cachePolicy)
+        .readFiles(
+            toRead,
+            [this, &hashers, &readJobs](std::size_t index, const unsigned char *data, std::size_t size) {
+                if (m_readThrottle) {
+                    m_readThrottle->acquire(size);
+                }
+                if (!hashers[index]) {
+                    hashers[index] = std::make_unique<RowHasher>(readJobs[index]->algorithm,
+                                                                 readJobs[index]->storedAlgorithm,
+                                                                 m_tuning.extraDigests);
+                }
+                hashers[index]->update(data, size);
+            },
+            [&](std::size_t index, int error) {
+                FileRecordEntry &record = records[owners[index]];
+                if (error != 0) {
+                    record.metadata.errorReason = readErrorText(error);
+                    return;
+                }
+                const HashJob &job = *readJobs[index];
+                if (!hashers[index]) { // empty file
+                    hashers[index] = std::make_unique<RowHasher>(job.algorithm, job.storedAlgorithm, m_tuning.extraDigests);
+                }
+                record.metadata.hash = hashers[index]->hash();
+                record.metadata.hashAlgorithm = job.algorithm;
+                record.storedAlgorithmHash = hashers[index]->storedHash();
+                setExtraDigests(record.metadata, hashers[index]->extraDigests());
+                if (m_tuning.appendOnlyResume && job.algorithm == HashAlgorithm::Sha256) {
+                    keepMidstate(record, hashers[index]->sha256(), job.midstate);
+                }
+                attachSample(record);
+                hashers[index].reset();
+            });
+    return records;
 }
 
 QVector<FileRecordEntry> FileMonitor::scanDirectory(const QString &directoryPath,
                                                    bool recursive,
                                                    bool followSymlinks,
                                                    int maxDepth) {
+    if (!QFileInfo(directoryPath).isDir()) {
+        return {};
+    }
+    return scanTree(directoryPath, recursive, followSymlinks, maxDepth,
+                    nextRotationSlot(QDir(directoryPath).absolutePath()));
+}
+
+// Pool threads walk, stat and hash; every database access happens here, on
+// the thread that owns the connection (QSqlDatabase is thread-affine), which
+// makes the calling thread the single writer of the pipeline.
+QVector<FileRecordEntry> FileMonitor::scanTree(const QString &directoryPath,
+                                              bool recursive,
+                                              bool followSymlinks,
+                                              int maxDepth,
+                                              int rotationSlot) {
     QVector<FileRecordEntry> results;
     QFileInfo info(directoryPath);
+    m_ownerNames.clear();
 
     if (!info.exists() || !info.isDir()) {
         return results;
     }
 
-    m_seenInodes.clear();
-    QSet<QString> seenPaths;
-    QSet<QString> visitedDirs;
     int permissionDeniedCount = 0;
 
-    const auto existingRecords = m_databaseManager.fetchAllRecords();
+    // Every stored row, loaded once: records are compared and deletions found
+    // against it, without a query per file.
+    BaselineIndex storedRows(m_databaseManager.fetchAllRecords());
     const QString basePath = QDir(directoryPath).absolutePath();
     const QString baseWithSep = basePath.endsWith(QDir::separator()) ? basePath : basePath + QDir::separator();
+    const QHash<QString, BaselineFingerprint> baseline = loadBaseline(storedRows.records());
+    const QHash<QString, HashAlgorithm> otherAlgorithms = loadOtherAlgorithms(storedRows.records());
+    const QHash<QString, HashMidstate> midstates =
+        m_tuning.appendOnlyResume ? m_databaseManager.fetchAllMidstates() : QHash<QString, HashMidstate>();
 
-    if (!m_databaseManager.beginTransaction()) {
-        FileRecordEntry failure;
-        failure.status = QObject::tr("Error");
-        failure.errorReason = m_databaseManager.lastError();
-        results.append(failure);
+    PendingWrites writes;
+    GroupCommitter committer(m_databaseManager, m_tuning.commitBatchRows, m_tuning.commitIntervalMs, writes);
+    if (!committer.begin()) {
+        results.append(databaseFailure(m_databaseManager.lastError()));
         return results;
     }
 
-    QList<QPair<QFileInfo, int>> stack;
-    stack.append({QFileInfo(directoryPath), 0});
+    // Everything the pool tasks touch is declared before the pool so that its
+    // destructor, which drains outstanding tasks, runs while it is still alive.
+    BoundedQueue<FileRecordEntry> hashed(m_tuning.queueCapacity);
+    std::atomic<bool> cancelled{false};
+    std::atomic<int> migrations{0};
+    std::mutex walkMutex;
+    QSet<QString> visitedDirs;
+    QSet<QString> listedDirs; // directories whose listing was readable
+    struct HardLink {
+        QString path; // the smallest one seen
+        core::FileStat stat;
+    };
+    QHash<QString, HardLink> hardLinks; // "dev:ino" -> its links
+    std::function<void(const QString &, int)> walkDirectory;
+    core::DeviceConcurrency concurrency;
+    concurrency.rotational = static_cast<unsigned>(qMax(1, m_tuning.rotationalDeviceThreads));
+    concurrency.solidState = static_cast<unsigned>(
+        m_tuning.solidStateDeviceThreads > 0 ? m_tuning.solidStateDeviceThreads : threadCount());
+    core::DeviceScheduler hashers(concurrency);
+    core::WorkStealingPool pool(static_cast<unsigned>(threadCount()));
 
-    while (!stack.isEmpty()) {
-        const auto current = stack.takeLast();
-        const QFileInfo currentInfo = current.first;
-        const int depth = current.second;
-        if (!currentInfo.isDir()) {
-            continue;
+    auto abortScan = [&](FileRecordEntry failure) {
+        cancelled = true;
+        hashed.close();
+        pool.wait();
+        hashers.wait();
+        committer.rollback();
+        results.append(failure);
+        return results;
+    };
+
+    auto writeHashed = [&](FileRecordEntry &record) {
+        if (!persistRecord(record, storedRows, writes, results, permissionDeniedCount)) {
+            return false;
+        }
+        if (record.metadata.hash.isEmpty()) {
+            return true;
         }
+        if (!committer.rowWritten()) {
+            record = databaseFailure(m_databaseManager.lastError());
+            return false;
+        }
+        return true;
+    };
 
-        const QString currentPath = currentInfo.absoluteFilePath();
-        if (visitedDirs.contains(currentPath)) {
-            continue;
+    const std::size_t batchSize = hashBatchSize();
+    const std::size_t smallBatchSize = smallFileBatchSize();
+    // A streaming walk holds its directory listing only one entry at a time,
+    // so the batches it queues ahead of the hashers are what bounds memory.
+    const std::size_t maxQueuedBatches = 4 * static_cast<std::size_t>(threadCount());
+    // Hashing runs on per-device queues, apart from the walk, so a slow disk
+    // only holds up its own files.
+    auto submitBatch = [&](PendingBatch &batch) {
+        if (batch.jobs.empty()) {
+            return;
+        }
+        if (m_tuning.streamingWalk) {
+            hashers.waitForRoom(maxQueuedBatches);
+        }
+        hashers.submit(batch.device, [this, &hashed, &cancelled, jobs = std::move(batch.jobs)]() {
+            if (cancelled) {
+                return;
+            }
+            for (auto &record : hashBatch(jobs)) {
+                hashed.push(std::move(record));
+            }
+        });
+        batch.jobs.clear();
+        batch.smallFilesOnly = true;
+    };
+
+    // stat is what the walk found, or null when the file could not be stat'ed
+    // (or not cheaply, off Unix); buildMetadata() then looks it up itself.
+    auto queueHash = [&](PendingBatch &batch, const QString &filePath, const core::FileStat *stat, qint64 size) {
+        const quint64 device = stat ? stat->device : 0;
+        if (device != batch.device) {
+            submitBatch(batch);
+            batch.device = device;
+        }
+        const BaselineFingerprint *fingerprint = nullptr;
+        const HashMidstate *midstate = nullptr;
+        if (rotationSlot < 0 || rotationBucket(filePath, m_tuning.fullRehashCycle) != rotationSlot) {
+            const auto it = baseline.constFind(filePath);
+            fingerprint = it == baseline.constEnd() ? nullptr : &it.value();
+            const auto stored = midstates.constFind(filePath);
+            midstate = stored == midstates.constEnd() ? nullptr : &stored.value();
         }
-        visitedDirs.insert(currentPath);
+        const auto other = otherAlgorithms.constFind(filePath);
+        const HashAlgorithm stored = other == otherAlgorithms.constEnd() ? m_tuning.hashAlgorithm : other.value();
+        HashJob job{filePath, fingerprint, midstate, jobAlgorithm(stored, migrations), stored};
+        if (stat) {
+            job.stat = *stat;
+            job.hasStat = true;
+        }
+        batch.jobs.push_back(std::move(job));
+        batch.smallFilesOnly = batch.smallFilesOnly && size < static_cast<qint64>(core::kSmallFileBytes);
+        if (batch.jobs.size() >= (batch.smallFilesOnly ? smallBatchSize : batchSize)) {
+            submitBatch(batch);
+        }
+    };
 
-        const QFileInfoList entries = QDir(currentPath).entryInfoList(QDir::NoDotAndDotDot | QDir::AllEntries,
-                                                                     QDir::Name | QDir::DirsFirst);
-        for (const QFileInfo &entry : entries) {
+    auto markVisited = [&](const QString &path) {
+        std::lock_guard<std::mutex> lock(walkMutex);
+        if (visitedDirs.contains(path)) {
+            return false;
+        }
+        visitedDirs.insert(path);
+        return true;
+    };
+
+    // Every directory is one pool task; subdirectories are queued on the
+    // worker that found them, so idle workers steal whole subtrees.
+    walkDirectory = [&](const QString &currentPath, int depth) {
+        if (cancelled) {
+            return;
+        }
+        PendingBatch batch;
+        auto descendInto = [&](const QString &dirPath) {
+            if (!recursive || (maxDepth >= 0 && depth + 1 > maxDepth)) {
+                return;
+            }
+            if (markVisited(dirPath)) {
+                pool.submit([&walkDirectory, dirPath, depth]() { walkDirectory(dirPath, depth + 1); });
+            }
+        };
+        auto visit = [&](const QFileInfo &entry) {
             const QString filePath = entry.absoluteFilePath();
+            storedRows.markPresent(filePath);
 
             if (isExcluded(filePath)) {
-                continue;
+                return;
             }
 
+#ifdef Q_OS_UNIX
+            // One lstat-like statx decides what the entry is and is handed on
+            // to buildMetadata(); only symlinks cost a second call.
+            const std::string nativePath = QFile::encodeName(filePath).toStdString();
+            core::FileStat st;
+            if (core::statFile(nativePath, st) != 0) {
+                queueHash(batch, filePath, nullptr, 0);
+                return;
+            }
+            if (S_ISLNK(st.mode)) {
+                core::FileStat target;
+                if (!followSymlinks || core::statFileAt(AT_FDCWD, nativePath.c_str(), true, target) != 0
+                    || !S_ISDIR(target.mode)) {
+                    return;
+                }
+                const QString targetPath = QFileInfo(entry.symLinkTarget()).absoluteFilePath();
+                {
+                    std::lock_guard<std::mutex> lock(walkMutex);
+                    if (visitedDirs.contains(targetPath)) {
+                        return;
+                    }
+                }
+                descendInto(filePath);
+                return;
+            }
+            if (S_ISDIR(st.mode)) {
+                descendInto(filePath);
+                return;
+            }
+            if (!S_ISREG(st.mode)) {
+                return;
+            }
+            // Hard links are hashed once, under their smallest path, after
+            // the walk: picking by walk order would differ between runs.
+            if (st.hardlinkCount > 1 && st.inode != 0) {
+                const QString inodeKey = QStringLiteral("%1:%2").arg(st.device).arg(st.inode);
+                std::lock_guard<std::mutex> lock(walkMutex);
+                auto it = hardLinks.find(inodeKey);
+                if (it == hardLinks.end()) {
+                    hardLinks.insert(inodeKey, HardLink{filePath, st});
+                } else if (filePath < it.value().path) {
+                    it.value() = HardLink{filePath, st};
+                }
+                return;
+            }
+            queueHash(batch, filePath, &st, static_cast<qint64>(st.size));
+#else
             if (entry.isSymLink() && entry.isDir()) {
                 if (!followSymlinks) {
-                    continue;
+                    return;
                 }
                 const QString target = QFileInfo(entry.symLinkTarget()).absoluteFilePath();
+                std::lock_guard<std::mutex> lock(walkMutex);
                 if (visitedDirs.contains(target)) {
-                    continue;
+                    return;
                 }
             }
 
             if (entry.isDir()) {
-                if (!recursive) {
-                    continue;
-                }
-                if (maxDepth >= 0 && depth + 1 > maxDepth) {
-                    continue;
-                }
-                stack.append({entry, depth + 1});
-                continue;
+                descendInto(filePath);
+                return;
             }
 
-#ifdef Q_OS_UNIX
-            struct stat st { };
-            if (::lstat(filePath.toUtf8().constData(), &st) == 0) {
-                if (!S_ISREG(st.st_mode)) {
-                    continue;
-                }
-            }
-#else
             if (!entry.isFile() || entry.isSymLink()) {
-                continue;
+                return;
             }
+            queueHash(batch, filePath, nullptr, entry.size());
 #endif
+        };
 
+        // An unreadable directory lists as empty, which must not make its
+        // rows look deleted.
+        if (QFileInfo(currentPath).isReadable()) {
+            std::lock_guard<std::mutex> lock(walkMutex);
+            listedDirs.insert(currentPath);
+        }
+        if (m_tuning.streamingWalk) {
+            // Readdir order, one entry at a time: memory stays flat however
+            // large the directory, and full batches go to the hashers before
+            // the listing is done.
+            QDirIterator it(currentPath, QDir::NoDotAndDotDot | QDir::AllEntries);
+            while (it.hasNext() && !cancelled) {
+                it.next();
+                visit(it.fileInfo());
+            }
+        } else {
+            const QFileInfoList entries = QDir(currentPath).entryInfoList(QDir::NoDotAndDotDot | QDir::AllEntries,
+                                                                         QDir::Name | QDir::DirsFirst);
+            for (const QFileInfo &entry : entries) {
+                visit(entry);
+            }
+        }
+        submitBatch(batch);
+    };
+
+    // Writes hashed records as they arrive until the walk and the hashing
+    // have run out of work. Idleness is sampled before popping, and the pool
+    // before the hashers because only walk tasks submit hashing: once both
+    // were idle and the queue is empty, nothing can be pushed any more.
+    auto drainUntilIdle = [&](FileRecordEntry &failure) {
+        while (true) {
+            const bool idle = pool.isIdle() && hashers.isIdle();
             FileRecordEntry record;
-            record.metadata = buildMetadata(filePath);
-            record.updatedAt = QDateTime::currentDateTimeUtc();
-            record.lastChecked = record.updatedAt;
-            record.scannerVersion = m_scannerVersion;
-
-            if (record.metadata.hash.isEmpty()) {
-                record.status = QStringLiteral("Error");
-                if (record.metadata.errorReason.isEmpty()) {
-                    record.errorReason = QObject::tr("Не удалось прочитать файл");
-                } else {
-                    record.errorReason = record.metadata.errorReason;
-                    if (record.errorReason.contains(QStringLiteral("Permission denied"), Qt::CaseInsensitive)) {
-                        record.errorReason = QObject::tr("Недостаточно прав (Permission denied)");
-                        ++permissionDeniedCount;
-                    }
+            if (hashed.pop(record, idle ? 0 : qMin(committer.msUntilDue(), kIdlePollMs))) {
+                if (!writeHashed(record)) {
+                    failure = record;
+                    return false;
                 }
-                record.scannerVersion += " (error_read)";
-                results.append(record);
                 continue;
             }
-
-            const QString inodeKey = QStringLiteral("%1:%2").arg(record.metadata.device).arg(record.metadata.inode);
-            if (record.metadata.inode != 0 && m_seenInodes.contains(inodeKey)) {
-                continue;
+            if (idle) {
+                return true;
             }
-            m_seenInodes.insert(inodeKey);
-
-            const FileRecordEntry oldRecord = m_databaseManager.fetchRecord(filePath);
-            const QString oldHash = oldRecord.metadata.hash;
-            record.previousHash = oldHash;
-            const QString oldStatus = oldRecord.status.isEmpty() ? QStringLiteral("Ok") : oldRecord.status;
-            const bool hasOldRecord = !oldRecord.metadata.path.isEmpty();
-#ifdef QT_DEBUG
-            qDebug() << "[DEBUG]" << filePath
-                     << "file_mtime=" << record.metadata.mtimeSeconds
-                     << "db_mtime=" << (hasOldRecord ? oldRecord.metadata.mtimeSeconds : static_cast<qint64>(-1));
-#endif
-            const bool signatureMismatch = hasOldRecord && !oldRecord.signatureValid && !oldRecord.signature.isEmpty();
-            record.permissionsChanged = hasOldRecord && (oldRecord.metadata.permissions != record.metadata.permissions
-                                                         || oldRecord.metadata.mode != record.metadata.mode);
-            record.ownerChanged = hasOldRecord && (oldRecord.metadata.owner != record.metadata.owner
-                                                   || oldRecord.metadata.groupName != record.metadata.groupName
-                                                   || oldRecord.metadata.uid != record.metadata.uid
-                                                   || oldRecord.metadata.gid != record.metadata.gid);
-            record.mtimeChanged = hasOldRecord && oldRecord.metadata.mtimeSeconds != record.metadata.mtimeSeconds;
-            record.inodeChanged = hasOldRecord && oldRecord.metadata.inode != record.metadata.inode;
-            record.metadataChanged = record.permissionsChanged || record.ownerChanged || record.mtimeChanged || record.inodeChanged;
-
-            if (!hasOldRecord) {
-                record.status = QStringLiteral("New");
-            } else if (signatureMismatch) {
-                record.status = QStringLiteral("Changed");
-            } else if (oldHash == record.metadata.hash && !record.metadataChanged) {
-                record.status = QStringLiteral("Ok");
-            } else {
-                record.status = QStringLiteral("Changed");
+            if (!committer.commitIfDue()) {
+                failure = databaseFailure(m_databaseManager.lastError());
+                return false;
             }
+        }
+    };
 
-            const bool statusChanged = oldStatus != record.status;
-            const bool hashChanged = oldHash != record.metadata.hash;
-
-            if (!hasOldRecord) {
-                if (!m_databaseManager.insertHistoryRecord(record.metadata.path,
-                                                           -1,
-                                                           statusCode(record.status),
-                                                           oldRecord.metadata.hash,
-                                                           record.metadata.hash,
-                                                           QObject::tr("Новый файл обнаружен"))) {
-                    m_databaseManager.rollbackTransaction();
-                    record.status = QStringLiteral("Error");
-                    record.errorReason = m_databaseManager.lastError();
-                    results.append(record);
-                    return results;
-                }
-            } else if (statusChanged || hashChanged) {
-                if (!m_databaseManager.insertHistoryRecord(record.metadata.path,
-                                                           statusCode(oldStatus),
-                                                           statusCode(record.status),
-                                                           oldRecord.metadata.hash,
-                                                           record.metadata.hash,
-                                                           QString())) {
-                    m_databaseManager.rollbackTransaction();
-                    record.status = QStringLiteral("Error");
-                    record.errorReason = m_databaseManager.lastError();
-                    results.append(record);
-                    return results;
-                }
-            }
+    const QString rootPath = info.absoluteFilePath();
+    markVisited(rootPath);
+    pool.submit([&walkDirectory, rootPath]() { walkDirectory(rootPath, 0); });
 
-            if (!hasOldRecord || statusChanged || hashChanged || record.metadataChanged) {
-                if (!m_databaseManager.upsertFileRecord(record)) {
-                    m_databaseManager.rollbackTransaction();
-                    record.status = QStringLiteral("Error");
-                    record.errorReason = m_databaseManager.lastError();
-                    results.append(record);
-                    return results;
-                }
-            }
-            results.append(record);
-            seenPaths.insert(QFileInfo(record.metadata.path).absoluteFilePath());
-        }
+    FileRecordEntry failure;
+    if (!drainUntilIdle(failure)) {
+        return abortScan(failure);
+    }
+    PendingBatch hardLinkBatch;
+    for (auto it = hardLinks.cbegin(); it != hardLinks.cend(); ++it) {
+        queueHash(hardLinkBatch, it.value().path, &it.value().stat, static_cast<qint64>(it.value().stat.size));
     }
+    submitBatch(hardLinkBatch);
+    if (!drainUntilIdle(failure)) {
+        return abortScan(failure);
+    }
+    pool.wait();
+    hashers.wait();
 
+    // A row is gone when the listing of its directory did not contain it.
+    // Only rows below directories the walk did not list (excluded, too deep,
+    // unreadable) still need a look at the file system.
     const QDateTime now = QDateTime::currentDateTimeUtc();
-    for (const auto &existing : existingRecords) {
-        const QString absolutePath = QFileInfo(existing.metadata.path).absoluteFilePath();
-        if (seenPaths.contains(absolutePath)) {
-            continue;
-        }
-        if (!isPathInDirectory(absolutePath, baseWithSep)) {
+    for (const FileRecordEntry *row : storedRows.withPrefix(baseWithSep)) {
+        const FileRecordEntry &existing = *row;
+        if (storedRows.isPresent(existing)) {
             continue;
         }
-        if (QFileInfo::exists(absolutePath)) {
+        const QString &path = existing.metadata.path;
+        const int slash = path.lastIndexOf(QLatin1Char('/'));
+        const QString parent = slash > 0 ? path.left(slash) : QStringLiteral("/");
+        if (!listedDirs.contains(parent) && QFileInfo::exists(path)) {
             continue;
         }
 
-        FileRecordEntry deleted = buildDeletedRecord(existing, now);
-        const QString oldStatus = existing.status.isEmpty() ? QStringLiteral("Ok") : existing.status;
-        const bool statusTransition = statusCode(oldStatus) != statusCode(deleted.status);
-        if (statusTransition) {
-            if (!m_databaseManager.insertHistoryRecord(deleted.metadata.path,
-                                                       statusCode(oldStatus),
-                                                       statusCode(deleted.status),
-                                                       existing.metadata.hash,
-                                                       deleted.metadata.hash,
-                                                       QObject::tr("Файл удалён"))) {
-                m_databaseManager.rollbackTransaction();
-                deleted.status = QStringLiteral("Error");
-                deleted.errorReason = m_databaseManager.lastError();
-                results.append(deleted);
-                return results;
-            }
-        }
-        if (!m_databaseManager.upsertFileRecord(deleted)) {
-            m_databaseManager.rollbackTransaction();
-            deleted.status = QStringLiteral("Error");
-            deleted.errorReason = m_databaseManager.lastError();
-            results.append(deleted);
+        persistDeletion(existing, now, writes, results);
+        if (!committer.rowWritten()) {
+            results.append(databaseFailure(m_databaseManager.lastError()));
             return results;
         }
-        results.append(deleted);
     }
 
-    if (!m_databaseManager.commitTransaction()) {
-        m_databaseManager.rollbackTransaction();
-        FileRecordEntry failure;
-        failure.status = QStringLiteral("Error");
-        failure.errorReason = m_databaseManager.lastError();
-        results.append(failure);
+    if (!committer.commit()) {
+        results.append(databaseFailure(m_databaseManager.lastError()));
     }
 
 #ifdef QT_DEBUG
@@ -297,35 +1286,396 @@ QVector<FileRecordEntry> FileMonitor::scanDirectory(const QString &directoryPath
     return results;
 }
 
-FileMetadata FileMonitor::buildMetadata(const QString &filePath) const {
+QVector<FileRecordEntry> FileMonitor::scanPaths(const QStringList &paths,
+                                                bool recursive,
+                                                bool followSymlinks,
+                                                int maxDepth) {
+    QVector<FileRecordEntry> results;
+    std::vector<HashJob> files;
+    m_ownerNames.clear();
+    QStringList missing;
+    QSet<QString> queued;
+
+    for (const QString &path : paths) {
+        const QFileInfo info(path);
+        const QString absolutePath = info.absoluteFilePath();
+        if (isExcluded(absolutePath) || queued.contains(absolutePath)) {
+            continue;
+        }
+        queued.insert(absolutePath);
+        if (!info.exists() && !info.isSymLink()) {
+            missing << absolutePath;
+            continue;
+        }
+        if (info.isDir()) {
+            // No rotation slot: the rehash rotation belongs to the full scans
+            // of the configured roots, not to every directory a watcher reports.
+            if (!info.isSymLink() || followSymlinks) {
+                results << scanTree(absolutePath, recursive, followSymlinks, maxDepth, -1);
+            }
+            continue;
+        }
+        // Same filter as the directory walk: only regular files, no symlinks.
+        HashJob job{absolutePath, nullptr, nullptr, m_tuning.hashAlgorithm, m_tuning.hashAlgorithm};
+#ifdef Q_OS_UNIX
+        if (core::statFile(QFile::encodeName(absolutePath).toStdString(), job.stat) != 0 || !S_ISREG(job.stat.mode)) {
+            continue;
+        }
+        job.hasStat = true;
+#else
+        if (!info.isFile() || info.isSymLink()) {
+            continue;
+        }
+#endif
+        files.push_back(std::move(job));
+    }
+
+    // Rows in another algorithm migrate under the same per-scan budget as in
+    // scanDirectory().
+    QStringList filePaths;
+    for (const HashJob &job : files) {
+        filePaths << job.path;
+    }
+    const BaselineIndex storedRows(m_databaseManager.fetchRecords(filePaths));
+    std::atomic<int> migrations{0};
+    for (HashJob &job : files) {
+        const FileRecordEntry *stored = storedRows.find(job.path);
+        if (stored && !stored->metadata.hash.isEmpty()) {
+            job.storedAlgorithm = stored->metadata.hashAlgorithm;
+            job.algorithm = jobAlgorithm(job.storedAlgorithm, migrations);
+        }
+    }
+
+    // Reported paths changed by definition, so they are always rehashed,
+    // though a file that was only appended to is hashed on from its midstate.
+    QHash<QString, HashMidstate> midstates;
+    if (m_tuning.appendOnlyResume) {
+        for (const HashJob &job : files) {
+            HashMidstate midstate;
+            if (m_databaseManager.fetchMidstate(job.path, midstate)) {
+                midstates.insert(job.path, midstate);
+            }
+        }
+        for (HashJob &job : files) {
+            const auto stored = midstates.constFind(job.path);
+            job.midstate = stored == midstates.constEnd() ? nullptr : &stored.value();
+        }
+    }
+    const std::size_t batchSize = hashBatchSize();
+    std::vector<std::vector<FileRecordEntry>> hashedBatches((files.size() + batchSize - 1) / batchSize);
+    if (!files.empty()) {
+        core::WorkStealingPool pool(static_cast<unsigned>(qMin<std::size_t>(threadCount(), hashedBatches.size())));
+        for (std::size_t i = 0; i < hashedBatches.size(); ++i) {
+            pool.submit([this, &files, &hashedBatches, batchSize, i]() {
+                const auto first = files.cbegin() + static_cast<std::ptrdiff_t>(i * batchSize);
+                const auto last = files.cbegin() + static_cast<std::ptrdiff_t>(qMin(files.size(), (i + 1) * batchSize));
+                hashedBatches[i] = hashBatch(std::vector<HashJob>(first, last));
+            });
+        }
+        pool.wait();
+    }
+
+    PendingWrites writes;
+    GroupCommitter committer(m_databaseManager, m_tuning.commitBatchRows, m_tuning.commitIntervalMs, writes);
+    if (!committer.begin()) {
+        results.append(databaseFailure(m_databaseManager.lastError()));
+        return results;
+    }
+
+    int permissionDeniedCount = 0;
+    for (auto &batch : hashedBatches) {
+        for (auto &record : batch) {
+            if (!persistRecord(record, storedRows, writes, results, permissionDeniedCount)) {
+                committer.rollback();
+                results.append(record);
+                return results;
+            }
+            if (!record.metadata.hash.isEmpty() && !committer.rowWritten()) {
+                results.append(databaseFailure(m_databaseManager.lastError()));
+                return results;
+            }
+        }
+    }
+
+    if (!missing.isEmpty()) {
+        const QDateTime now = QDateTime::currentDateTimeUtc();
+        const BaselineIndex allRows(m_databaseManager.fetchAllRecords());
+        QVector<const FileRecordEntry *> affected;
+        QSet<const FileRecordEntry *> queuedRows;
+        for (const QString &gone : missing) {
+            QVector<const FileRecordEntry *> rows = allRows.withPrefix(gone + QDir::separator());
+            if (const FileRecordEntry *row = allRows.find(gone)) {
+                rows.prepend(row);
+            }
+            for (const FileRecordEntry *row : rows) {
+                if (!queuedRows.contains(row)) {
+                    queuedRows.insert(row);
+                    affected.append(row);
+                }
+            }
+        }
+        for (const FileRecordEntry *row : affected) {
+            const FileRecordEntry &existing = *row;
+            if (QFileInfo::exists(existing.metadata.path)) {
+                continue;
+            }
+            persistDeletion(existing, now, writes, results);
+            if (!committer.rowWritten()) {
+                results.append(databaseFailure(m_databaseManager.lastError()));
+                return results;
+            }
+        }
+    }
+
+    if (!committer.commit()) {
+        results.append(databaseFailure(m_databaseManager.lastError()));
+    }
+    return results;
+}
+
+// Marks a record whose file has disappeared as deleted and queues its file
+// row, a history row for the transition and the removal of its chunk digests
+// and midstate in writes. Nothing reaches the database before the next
+// GroupCommitter::commit().
+void FileMonitor::persistDeletion(const FileRecordEntry &existing,
+                                  const QDateTime &timestamp,
+                                  PendingWrites &writes,
+                                  QVector<FileRecordEntry> &results) {
+    FileRecordEntry deleted = buildDeletedRecord(existing, timestamp);
+    const QString oldStatus = existing.status.isEmpty() ? QStringLiteral("Ok") : existing.status;
+    const bool statusTransition = statusCode(oldStatus) != statusCode(deleted.status);
+    if (statusTransition) {
+        writes.history.append(historyEntry(deleted.metadata.path,
+                                           statusCode(oldStatus),
+                                           statusCode(deleted.status),
+                                           existing.metadata.hash,
+                                           deleted.metadata.hash,
+                                           QObject::tr("Файл удалён")));
+    }
+    writes.files.append(deleted);
+    writes.removedPaths.append(existing.metadata.path);
+    results.append(deleted);
+}
+
+// Compares a freshly hashed record against its baseline and queues the
+// history row and file row in writes; those are only written, and can only
+// fail, at the next GroupCommitter::commit(). Chunk digests and midstates are
+// written right away: returns false (with record turned into an error entry)
+// when the database rejects one of them.
+bool FileMonitor::persistRecord(FileRecordEntry &record,
+                                const BaselineIndex &storedRows,
+                                PendingWrites &writes,
+                                QVector<FileRecordEntry> &results,
+                                int &permissionDeniedCount) {
+    const QString &filePath = record.metadata.path;
+
+    if (record.metadata.hash.isEmpty()) {
+        record.status = QStringLiteral("Error");
+        if (record.metadata.errorReason.isEmpty()) {
+            record.errorReason = QObject::tr("Не удалось прочитать файл");
+        } else {
+            record.errorReason = record.metadata.errorReason;
+            if (record.errorReason.contains(QStringLiteral("Permission denied"), Qt::CaseInsensitive)) {
+                record.errorReason = QObject::tr("Недостаточно прав (Permission denied)");
+                ++permissionDeniedCount;
+            }
+        }
+        record.scannerVersion += " (error_read)";
+        results.append(record);
+        return true;
+    }
+
+    const FileRecordEntry *stored = storedRows.find(filePath);
+    const FileRecordEntry noRecord;
+    const FileRecordEntry &oldRecord = stored ? *stored : noRecord;
+    const QString oldHash = oldRecord.metadata.hash;
+    record.previousHash = oldHash;
+    const QString oldStatus = oldRecord.status.isEmpty() ? QStringLiteral("Ok") : oldRecord.status;
+    const bool hasOldRecord = !oldRecord.metadata.path.isEmpty();
+#ifdef QT_DEBUG
+    qDebug() << "[DEBUG]" << filePath
+             << "file_mtime=" << record.metadata.mtimeSeconds
+             << "db_mtime=" << (hasOldRecord ? oldRecord.metadata.mtimeSeconds : static_cast<qint64>(-1));
+#endif
+    resolveOwnerNames(record.metadata, hasOldRecord ? &oldRecord.metadata : nullptr);
+    const bool signatureMismatch = hasOldRecord && !oldRecord.signatureValid && !oldRecord.signature.isEmpty();
+    // The *User flags say what the scanning account may do, not what the file
+    // allows; the mode covers the rest.
+    const quint64 oldPermissions = oldRecord.metadata.permissions & ~kUserPermissions;
+    record.permissionsChanged = hasOldRecord && (oldPermissions != (record.metadata.permissions & ~kUserPermissions)
+                                                 || oldRecord.metadata.mode != record.metadata.mode);
+    record.ownerChanged = hasOldRecord && (oldRecord.metadata.owner != record.metadata.owner
+                                           || oldRecord.metadata.groupName != record.metadata.groupName
+                                           || oldRecord.metadata.uid != record.metadata.uid
+                                           || oldRecord.metadata.gid != record.metadata.gid);
+    record.mtimeChanged = hasOldRecord && oldRecord.metadata.mtimeSeconds != record.metadata.mtimeSeconds;
+    record.inodeChanged = hasOldRecord && oldRecord.metadata.inode != record.metadata.inode;
+    record.metadataChanged = record.permissionsChanged || record.ownerChanged || record.mtimeChanged || record.inodeChanged;
+    // Fingerprint-only drift (e.g. rows from before the ns columns, or a
+    // ctime bump) is stored silently so incremental scans can rely on it.
+    const bool fingerprintChanged = hasOldRecord && (oldRecord.metadata.mtimeNs != record.metadata.mtimeNs
+                                                     || oldRecord.metadata.ctimeNs != record.metadata.ctimeNs
+                                                     || oldRecord.metadata.device != record.metadata.device);
+    // A hash in another format (plain vs. chunked, or another chunk size) or
+    // algorithm says nothing about the content. A file migrating to another
+    // algorithm was also hashed in the stored one, which is compared instead;
+    // otherwise the stat fingerprint decides, as for fast incremental scans.
+    auto comparable = [&](const QString &hash, HashAlgorithm algorithm) {
+        return oldHash.isEmpty()
+            || (oldRecord.metadata.hashAlgorithm == algorithm && hashFormat(oldHash) == hashFormat(hash));
+    };
+    bool sameContent = false;
+    if (comparable(record.metadata.hash, record.metadata.hashAlgorithm)) {
+        sameContent = oldHash == record.metadata.hash;
+    } else if (!record.storedAlgorithmHash.isEmpty()
+               && comparable(record.storedAlgorithmHash, oldRecord.metadata.hashAlgorithm)) {
+        sameContent = oldHash == record.storedAlgorithmHash;
+    } else {
+        sameContent = oldRecord.metadata.mtimeNs != 0 && !fingerprintChanged
+            && oldRecord.metadata.size == record.metadata.size;
+    }
+
+    if (!hasOldRecord) {
+        record.status = QStringLiteral("New");
+    } else if (signatureMismatch) {
+        record.status = QStringLiteral("Changed");
+    } else if (sameContent && !record.metadataChanged) {
+        record.status = QStringLiteral("Ok");
+    } else {
+        record.status = QStringLiteral("Changed");
+    }
+
+    const bool statusChanged = oldStatus != record.status;
+    const bool hashChanged = oldHash != record.metadata.hash;
+
+    auto fail = [this, &record]() {
+        record.status = QStringLiteral("Error");
+        record.errorReason = m_databaseManager.lastError();
+        return false;
+    };
+
+    if (!hasOldRecord) {
+        const FileRecordEntry *origin = movedFrom(record, storedRows);
+        writes.history.append(historyEntry(record.metadata.path,
+                                           -1,
+                                           statusCode(record.status),
+                                           oldRecord.metadata.hash,
+                                           record.metadata.hash,
+                                           origin ? QObject::tr("Файл перемещён из %1").arg(origin->metadata.path)
+                                                  : QObject::tr("Новый файл обнаружен")));
+    } else if (statusChanged || hashChanged) {
+        writes.history.append(historyEntry(record.metadata.path,
+                                           statusCode(oldStatus),
+                                           statusCode(record.status),
+                                           oldRecord.metadata.hash,
+                                           record.metadata.hash,
+                                           hashChanged ? hashChangeNote(oldRecord, record) : QString()));
+    }
+
+    const bool verificationChanged = hasOldRecord && (oldRecord.metadata.sampleHash != record.metadata.sampleHash
+                                                      || oldRecord.verifyTier != record.verifyTier);
+    // Digests added to or dropped from extraDigests since the row was written.
+    const bool digestsChanged = hasOldRecord && (oldRecord.metadata.sha512 != record.metadata.sha512
+                                                 || oldRecord.metadata.md5 != record.metadata.md5);
+    if (!hasOldRecord || statusChanged || hashChanged || record.metadataChanged || fingerprintChanged
+        || verificationChanged || digestsChanged) {
+        writes.files.append(record);
+    }
+    if (hashChanged) {
+        const bool written = record.chunkDigests.isEmpty()
+            ? hashFormat(oldHash).isEmpty() || m_databaseManager.removeChunkDigests(filePath)
+            : m_databaseManager.upsertChunkDigests(filePath, record.chunkSize, record.chunkDigests);
+        if (!written) {
+            return fail();
+        }
+    }
+    if (record.midstate.length > 0 && !m_databaseManager.upsertMidstate(filePath, record.midstate)) {
+        return fail();
+    }
+    results.append(record);
+    return true;
+}
+
+// Says when the hash only changed algorithm or format, and for chunk-hashed
+// files with a trusted tree from the last scan which byte ranges changed,
+// e.g. "Изменены байты: 0–67108864".
+QString FileMonitor::hashChangeNote(const FileRecordEntry &oldRecord, const FileRecordEntry &record) const {
+    if (!oldRecord.metadata.hash.isEmpty() && oldRecord.metadata.hashAlgorithm != record.metadata.hashAlgorithm) {
+        return QObject::tr("Хеш пересчитан в формате %1").arg(algorithmName(record.metadata.hashAlgorithm));
+    }
+    const QString format = hashFormat(record.metadata.hash);
+    if (!oldRecord.metadata.hash.isEmpty() && hashFormat(oldRecord.metadata.hash) != format) {
+        return QObject::tr("Хеш пересчитан в формате %1").arg(format.isEmpty() ? QStringLiteral("SHA-256") : format);
+    }
+    if (record.chunkDigests.isEmpty()) {
+        return {};
+    }
+    qint64 oldChunkSize = 0;
+    QByteArray oldLeaves;
+    if (!m_databaseManager.fetchChunkDigests(record.metadata.path, oldChunkSize, oldLeaves)
+        || oldChunkSize != record.chunkSize || merkleHash(oldChunkSize, oldLeaves) != oldRecord.metadata.hash) {
+        return {};
+    }
+    QStringList ranges;
+    for (const auto &range : changedByteRanges(oldLeaves, record.chunkDigests, record.chunkSize, record.metadata.size)) {
+        ranges << QStringLiteral("%1–%2").arg(range.first).arg(range.second);
+    }
+    if (ranges.isEmpty()) {
+        return {};
+    }
+    return QObject::tr("Изменены байты: %1").arg(ranges.join(QStringLiteral(", ")));
+}
+
+FileMetadata FileMonitor::buildMetadata(const HashJob &job) const {
     FileMetadata metadata;
-    metadata.path = filePath;
+    metadata.path = job.path;
 
-    QFileInfo info(filePath);
+#ifdef Q_OS_UNIX
+    // Owner and group names are left to resolveOwnerNames(), which runs only
+    // for rows that are compared and written.
+    core::FileStat st = job.stat;
+    if (!job.hasStat && core::statFile(QFile::encodeName(job.path).toStdString(), st) != 0) {
+        return metadata;
+    }
+    metadata.size = static_cast<qint64>(st.size);
+    metadata.uid = st.uid;
+    metadata.gid = st.gid;
+    metadata.mode = st.mode;
+    metadata.device = st.device;
+    metadata.inode = st.inode;
+    metadata.hardlinkCount = st.hardlinkCount;
+    metadata.permissions = qtPermissions(st);
+    metadata.mtimeSeconds = st.mtimeNs / 1000000000; // truncated like QDateTime::toSecsSinceEpoch()
+    // A symlink's own times say nothing about its target's content, so it
+    // gets no fingerprint and is always rehashed.
+    if (!S_ISLNK(st.mode)) {
+        metadata.mtimeNs = st.mtimeNs;
+        metadata.ctimeNs = st.ctimeNs;
+    }
+#else
+    QFileInfo info(job.path);
     metadata.size = info.size();
     metadata.mtimeSeconds = info.lastModified().toSecsSinceEpoch();
     metadata.owner = info.owner();
     metadata.groupName = info.group();
     metadata.permissions = static_cast<quint64>(info.permissions());
-#ifdef Q_OS_UNIX
-    struct stat st;
-    if (::lstat(filePath.toUtf8().constData(), &st) == 0) {
-        metadata.uid = st.st_uid;
-        metadata.gid = st.st_gid;
-        metadata.mode = st.st_mode;
-        metadata.device = st.st_dev;
-        metadata.inode = st.st_ino;
-        metadata.hardlinkCount = st.st_nlink;
-    }
 #endif
-    QString errorReason;
-    metadata.hash = calculateHash(filePath, &errorReason);
-    if (!errorReason.isEmpty()) {
-        metadata.errorReason = errorReason;
-    }
     return metadata;
 }
 
+void FileMonitor::resolveOwnerNames(FileMetadata &metadata, const FileMetadata *stored) {
+    if (!metadata.owner.isEmpty()) {
+        return;
+    }
+    if (stored && stored->uid == metadata.uid && stored->gid == metadata.gid && !stored->owner.isEmpty()) {
+        metadata.owner = stored->owner;
+        metadata.groupName = stored->groupName;
+        return;
+    }
+    metadata.owner = QString::fromStdString(m_ownerNames.userName(metadata.uid));
+    metadata.groupName = QString::fromStdString(m_ownerNames.groupName(metadata.gid));
+}
+
 FileRecordEntry FileMonitor::buildDeletedRecord(const FileRecordEntry &existing, const QDateTime &timestamp) const {
     FileRecordEntry deleted = existing;
     deleted.status = QStringLiteral("Deleted");
@@ -334,44 +1684,38 @@ FileRecordEntry FileMonitor::buildDeletedRecord(const FileRecordEntry &existing,
     return deleted;
 }
 
-bool FileMonitor::isPathInDirectory(const QString &filePath, const QString &directoryPath) const {
-    if (filePath == directoryPath || filePath.startsWith(directoryPath)) {
-        return true;
-    }
-
-    QString normalizedDirectory = directoryPath;
-    if (!normalizedDirectory.endsWith(QDir::separator())) {
-        normalizedDirectory += QDir::separator();
-    }
-    return filePath.startsWith(normalizedDirectory);
-}
-
 bool FileMonitor::isExcluded(const QString &filePath) const {
-    const QString normalized = QDir::cleanPath(filePath);
-    const QString fileName = QFileInfo(normalized).fileName();
+    return m_excludeRules.matches(filePath);
+}
 
-    for (const auto &rule : m_excludeRules) {
+CompiledExcludeRules::CompiledExcludeRules(const QVector<ExcludeRule> &rules) {
+    std::vector<core::ExcludeRule> compiled;
+    for (const auto &rule : rules) {
         if (rule.pattern.isEmpty()) {
             continue;
         }
-
-        switch (rule.type) {
-        case ExcludeType::Path: {
-            const QString normalizedRule = QDir::cleanPath(rule.pattern);
-            if (normalized == normalizedRule || normalized.startsWith(normalizedRule + QDir::separator())) {
-                return true;
-            }
-            break;
+        if (rule.type == ExcludeType::Path) {
+            compiled.push_back({core::ExcludeType::Path, QFile::encodeName(QDir::cleanPath(rule.pattern)).toStdString()});
+            continue;
         }
-        case ExcludeType::Glob:
-            if (QDir::match(rule.pattern, fileName)) {
-                return true;
+        for (const QString &pattern : QDir::nameFiltersFromString(rule.pattern)) {
+            if (!pattern.isEmpty()) {
+                compiled.push_back({core::ExcludeType::Glob, QFile::encodeName(pattern).toStdString()});
             }
-            break;
         }
     }
+    m_matcher = core::ExcludeMatcher(compiled, true);
+}
 
-    return false;
+// Walk paths are already clean; only the ones that might not be go through
+// QDir::cleanPath().
+bool CompiledExcludeRules::matches(const QString &filePath) const {
+    if (m_matcher.empty()) {
+        return false;
+    }
+    const bool clean = !filePath.contains(QLatin1String("/.")) && !filePath.contains(QLatin1String("//"))
+        && !filePath.endsWith(QLatin1Char('/'));
+    return m_matcher.excludes(QFile::encodeName(clean ? filePath : QDir::cleanPath(filePath)).toStdString());
 }
 
 int FileMonitor::statusCode(const QString &status) const {
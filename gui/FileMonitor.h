@@ -1,13 +1,27 @@
 #ifndef FILEMONITOR_H
 #define FILEMONITOR_H
 
+#include "BaselineIndex.h"
 #include "DatabaseManager.h"
+#include "core/ExcludeMatcher.h"
+#include "core/FileReader.h"
+#include "core/FileStat.h"
+#include "core/MultiDigest.h"
+#include "core/OwnerNameCache.h"
+#include "core/ReadOrder.h"
+#include "core/ResourceGovernor.h"
+#include "core/Sha256.h"
 
 #include <QVector>
 #include <QString>
 #include <QDateTime>
 #include <QSet>
 #include <QDir>
+#include <QHash>
+#include <QStringList>
+
+#include <atomic>
+#include <vector>
 
 enum class ExcludeType {
     Path,
@@ -19,28 +33,172 @@ struct ExcludeRule {
     QString pattern;
 };
 
+// ExcludeRules compiled into a core::ExcludeMatcher, so a rule set is parsed
+// once rather than for every path it is checked against. Globs ignore case
+// and may list several patterns separated by ';' or spaces, as QDir::match()
+// does.
+class CompiledExcludeRules {
+public:
+    CompiledExcludeRules() = default;
+    explicit CompiledExcludeRules(const QVector<ExcludeRule> &rules);
+
+    bool matches(const QString &filePath) const;
+    bool isEmpty() const { return m_matcher.empty(); }
+
+private:
+    core::ExcludeMatcher m_matcher;
+};
+
+// Knobs for the hashing/writing pipeline behind scanDirectory().
+struct ScanTuning {
+    int scanThreads = 0;        // walker/hasher threads, 0 = core::availableCpuCount()
+    int queueCapacity = 256;    // hashed records waiting for the database writer
+    int commitBatchRows = 500;  // commit after this many written rows...
+    int commitIntervalMs = 1000; // ...or after this much time, whichever comes first
+    int ioQueueDepth = 0;         // io_uring reads in flight per hashing thread, 0 = blocking reads
+    int rotationalDeviceThreads = 2; // hashing threads per spinning disk
+    int solidStateDeviceThreads = 0; // hashing threads per other device, 0 = scanThreads
+    core::ReadOrder readOrder = core::ReadOrder::Discovery; // cached files first, then by inode/extent
+    bool streamingWalk = false; // list directories unsorted, one entry at a time, with a bounded hashing backlog
+    qint64 merkleThresholdBytes = 0;             // files this big are hashed in parallel chunks, 0 = never
+    qint64 merkleChunkBytes = 64 * 1024 * 1024; // chunk size of those files
+    bool fastIncremental = false; // reuse the stored hash while (dev, ino, size, mtime, ctime) match
+    bool appendOnlyResume = false; // hash grown files on from the SHA-256 state stored at their old end
+    qint64 quickVerifyThresholdBytes = 0;    // files this big are checked by sampled blocks, 0 = never
+    int quickVerifySamples = 64;             // blocks sampled between the first and the last one
+    qint64 quickVerifyBlockBytes = 64 * 1024; // size of a sampled block
+    QVector<ExcludeRule> quickVerifyInclude; // only matching files are quick-verified; empty = all
+    QVector<ExcludeRule> quickVerifyExclude; // matching files are always hashed in full
+    int fullRehashCycle = 288;    // these shortcuts still rehash every file once per N scans, 0 = never
+    HashAlgorithm hashAlgorithm = HashAlgorithm::Sha256; // for new rows; Merkle-chunked files stay SHA-256
+    int hashMigrationFilesPerScan = 2000; // rows of another algorithm rehashed into hashAlgorithm per scan, 0 = all
+    unsigned extraDigests = 0; // core::DigestSha512 | core::DigestMd5, kept in their own columns
+};
+
 class FileMonitor {
 public:
     explicit FileMonitor(DatabaseManager &databaseManager, QString scannerVersion = QStringLiteral("1.0.0"));
 
+    // Full scan of a configured root; advances the root's rehash rotation.
     QVector<FileRecordEntry> scanDirectory(const QString &directoryPath,
                                            bool recursive = true,
                                            bool followSymlinks = false,
                                            int maxDepth = 20);
-    QString calculateHash(const QString &filePath, QString *errorReason = nullptr) const;
-    void setExcludeRules(const QVector<ExcludeRule> &rules) { m_excludeRules = rules; }
+    // Rechecks only the given paths, e.g. the ones a change watcher reported.
+    // Existing directories are rescanned as subtrees; paths that no longer
+    // exist mark their record, or every record below them, as deleted.
+    QVector<FileRecordEntry> scanPaths(const QStringList &paths,
+                                       bool recursive = true,
+                                       bool followSymlinks = false,
+                                       int maxDepth = 20);
+    // SHA-256 of the file. With extraDigests given, the digests in
+    // ScanTuning::extraDigests are taken from the same read and stored there.
+    QString calculateHash(const QString &filePath,
+                          QString *errorReason = nullptr,
+                          FileMetadata *extraDigests = nullptr) const;
+    void setExcludeRules(const QVector<ExcludeRule> &rules) { m_excludeRules = CompiledExcludeRules(rules); }
+    void setScanTuning(const ScanTuning &tuning);
+    void setCachePolicy(core::CachePolicy cachePolicy) { m_cachePolicy = cachePolicy; }
+    // Not owned; nullptr reads unthrottled.
+    void setReadThrottle(core::ReadThrottle *throttle) { m_readThrottle = throttle; }
     bool isExcluded(const QString &filePath) const;
 
 private:
-    FileMetadata buildMetadata(const QString &filePath) const;
+    // Baseline row as seen by a fast incremental scan.
+    struct BaselineFingerprint {
+        quint64 device = 0;
+        quint64 inode = 0;
+        qint64 size = 0;
+        qint64 mtimeNs = 0;
+        qint64 ctimeNs = 0;
+        QString hash;
+        QString sampleHash;
+        VerifyTier verifyTier = VerifyTier::Full;
+        HashAlgorithm hashAlgorithm = HashAlgorithm::Sha256;
+        QString sha512;
+        QString md5;
+
+        bool matches(const FileMetadata &metadata) const {
+            return device == metadata.device && inode == metadata.inode && size == metadata.size
+                && mtimeNs == metadata.mtimeNs && ctimeNs == metadata.ctimeNs;
+        }
+        bool hasDigests(unsigned digests) const {
+            return (!(digests & core::DigestSha512) || !sha512.isEmpty()) && (!(digests & core::DigestMd5) || !md5.isEmpty());
+        }
+    };
+
+    struct HashJob {
+        QString path;
+        const BaselineFingerprint *baseline = nullptr;
+        const HashMidstate *midstate = nullptr;
+        HashAlgorithm algorithm = HashAlgorithm::Sha256;       // what the row is written with
+        HashAlgorithm storedAlgorithm = HashAlgorithm::Sha256; // what the stored row uses, if there is one
+        core::FileStat stat; // taken by the walk, so the file is not stat'ed again; valid with hasStat
+        bool hasStat = false;
+    };
+
+    // Files waiting to be handed to a hashing thread; all on one device.
+    struct PendingBatch {
+        quint64 device = 0;
+        bool smallFilesOnly = true; // such batches fill up to smallFileBatchSize()
+        std::vector<HashJob> jobs;
+    };
+
+    FileMetadata buildMetadata(const HashJob &job) const;
+    void resolveOwnerNames(FileMetadata &metadata, const FileMetadata *stored);
+    void hashRecord(FileRecordEntry &record, const HashJob &job) const;
+    bool hashesAsSmallFile(const FileMetadata &metadata, const HashJob &job) const;
+    void hashSmallFiles(std::vector<FileRecordEntry> &records, const std::vector<std::size_t> &owners) const;
+    bool settledByBaseline(FileRecordEntry &record, const BaselineFingerprint *baseline) const;
+    bool quickVerifies(const FileMetadata &metadata) const;
+    QString sampleHash(const FileMetadata &metadata) const;
+    void attachSample(FileRecordEntry &record) const;
+    void hashResumable(FileRecordEntry &record, const HashMidstate *midstate) const;
+    void keepMidstate(FileRecordEntry &record, const core::Sha256 &sha, const HashMidstate *previous) const;
+    bool hashesInChunks(const FileMetadata &metadata) const;
+    qint64 chunkSize() const;
+    int fileThreads(const FileMetadata &metadata) const;
+    void hashChunked(FileRecordEntry &record) const;
+    void hashBlake3(FileRecordEntry &record) const;
+    void hashRow(FileRecordEntry &record, const HashJob &job) const;
+    HashAlgorithm jobAlgorithm(HashAlgorithm storedAlgorithm, std::atomic<int> &migrations) const;
+    std::vector<HashJob> inReadingOrder(const std::vector<HashJob> &jobs) const;
+    std::vector<FileRecordEntry> hashBatch(const std::vector<HashJob> &batch) const;
+    std::size_t hashBatchSize() const;
+    std::size_t smallFileBatchSize() const;
+    void stampRecord(FileRecordEntry &record) const;
+    QHash<QString, BaselineFingerprint> loadBaseline(const QVector<FileRecordEntry> &records) const;
+    QHash<QString, HashAlgorithm> loadOtherAlgorithms(const QVector<FileRecordEntry> &records) const;
+    int nextRotationSlot(const QString &basePath);
+    // scanDirectory() with the rotation slot given; -1 rehashes no bucket.
+    QVector<FileRecordEntry> scanTree(const QString &directoryPath,
+                                      bool recursive,
+                                      bool followSymlinks,
+                                      int maxDepth,
+                                      int rotationSlot);
+    bool persistRecord(FileRecordEntry &record,
+                       const BaselineIndex &storedRows,
+                       PendingWrites &writes,
+                       QVector<FileRecordEntry> &results,
+                       int &permissionDeniedCount);
+    void persistDeletion(const FileRecordEntry &existing,
+                         const QDateTime &timestamp,
+                         PendingWrites &writes,
+                         QVector<FileRecordEntry> &results);
+    int threadCount() const;
     FileRecordEntry buildDeletedRecord(const FileRecordEntry &existing, const QDateTime &timestamp) const;
-    bool isPathInDirectory(const QString &filePath, const QString &directoryPath) const;
     int statusCode(const QString &status) const;
+    QString hashChangeNote(const FileRecordEntry &oldRecord, const FileRecordEntry &record) const;
 
     DatabaseManager &m_databaseManager;
     QString m_scannerVersion;
-    mutable QSet<QString> m_seenInodes;
-    QVector<ExcludeRule> m_excludeRules;
+    CompiledExcludeRules m_excludeRules;
+    ScanTuning m_tuning;
+    CompiledExcludeRules m_quickVerifyInclude;
+    CompiledExcludeRules m_quickVerifyExclude;
+    core::CachePolicy m_cachePolicy = core::CachePolicy::Keep;
+    core::ReadThrottle *m_readThrottle = nullptr;
+    core::OwnerNameCache m_ownerNames; // emptied when a scan starts
 };
 
 #endif // FILEMONITOR_H
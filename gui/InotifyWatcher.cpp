@@ -0,0 +1,206 @@
+#include "InotifyWatcher.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSocketNotifier>
+#include <QVector>
+
+#ifdef Q_OS_LINUX
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace {
+
+#ifdef Q_OS_LINUX
+// IN_MODIFY catches files that are written but kept open (logs, databases);
+// the debounce keeps their event storm down to one batch per maxDelayMs.
+constexpr quint32 kWatchMask = IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MOVED_FROM
+    | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR | IN_EXCL_UNLINK;
+constexpr std::size_t kEventBufferSize = 64 * 1024;
+#endif
+
+QString joinPath(const QString &directory, const QString &name) {
+    return directory.endsWith(QLatin1Char('/')) ? directory + name : directory + QLatin1Char('/') + name;
+}
+
+}
+
+InotifyWatcher::InotifyWatcher(QObject *parent) : ChangeWatcher(parent) {}
+
+InotifyWatcher::~InotifyWatcher() { stop(); }
+
+void InotifyWatcher::start(const QStringList &roots, bool recursive, bool followSymlinks, int maxDepth) {
+    stop();
+#ifdef Q_OS_LINUX
+    m_recursive = recursive;
+    m_followSymlinks = followSymlinks;
+    m_maxDepth = maxDepth;
+
+    m_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd < 0) {
+        emit failed(tr("Не удалось инициализировать inotify: %1").arg(QString::fromLocal8Bit(std::strerror(errno))));
+        return;
+    }
+
+    for (const QString &root : roots) {
+        if (!addWatches(QDir(root).absolutePath(), 0)) {
+            stop();
+            return;
+        }
+    }
+
+    m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &InotifyWatcher::readEvents);
+    emit started();
+#else
+    Q_UNUSED(roots)
+    Q_UNUSED(recursive)
+    Q_UNUSED(followSymlinks)
+    Q_UNUSED(maxDepth)
+    emit failed(tr("Мониторинг по событиям поддерживается только в Linux"));
+#endif
+}
+
+// May run from inside readEvents(), so the notifier is disabled and deleted
+// later rather than destroyed under its own signal.
+void InotifyWatcher::stop() {
+    if (m_notifier) {
+        m_notifier->setEnabled(false);
+        m_notifier->deleteLater();
+        m_notifier = nullptr;
+    }
+#ifdef Q_OS_LINUX
+    if (m_fd >= 0) {
+        // Closing the descriptor drops every watch at once.
+        ::close(m_fd);
+        m_fd = -1;
+    }
+#endif
+    m_watches.clear();
+    discardPending();
+}
+
+// Watches directory and, within the depth limit, everything below it.
+// Returns false only when the kernel watch limit is hit; directories that
+// vanish or cannot be read while being walked are skipped.
+bool InotifyWatcher::addWatches(const QString &directory, int depth) {
+#ifdef Q_OS_LINUX
+    QVector<WatchedDir> stack{WatchedDir{directory, depth}};
+    while (!stack.isEmpty()) {
+        const WatchedDir dir = stack.takeLast();
+        if (isExcluded(dir.path)) {
+            continue;
+        }
+        const quint32 mask = kWatchMask | (m_followSymlinks ? 0 : IN_DONT_FOLLOW);
+        const int wd = ::inotify_add_watch(m_fd, QFile::encodeName(dir.path).constData(), mask);
+        if (wd < 0) {
+            if (errno == ENOSPC || errno == ENOMEM) {
+                emit failed(tr("Исчерпан лимит inotify (fs.inotify.max_user_watches) на %1").arg(dir.path));
+                return false;
+            }
+            continue;
+        }
+        // The same directory reached twice (a symlink loop) yields the same
+        // descriptor; its subtree is already covered.
+        if (m_watches.contains(wd)) {
+            continue;
+        }
+        m_watches.insert(wd, dir);
+
+        if (!m_recursive || (m_maxDepth >= 0 && dir.depth + 1 > m_maxDepth)) {
+            continue;
+        }
+        QDir::Filters filters = QDir::Dirs | QDir::NoDotAndDotDot;
+        if (!m_followSymlinks) {
+            filters |= QDir::NoSymLinks;
+        }
+        const QFileInfoList children = QDir(dir.path).entryInfoList(filters);
+        for (const QFileInfo &child : children) {
+            stack.append(WatchedDir{child.absoluteFilePath(), dir.depth + 1});
+        }
+    }
+#else
+    Q_UNUSED(directory)
+    Q_UNUSED(depth)
+#endif
+    return true;
+}
+
+void InotifyWatcher::forgetWatches(const QString &directory) {
+    const QString prefix = joinPath(directory, QString());
+    for (auto it = m_watches.begin(); it != m_watches.end();) {
+        if (it->path == directory || it->path.startsWith(prefix)) {
+#ifdef Q_OS_LINUX
+            ::inotify_rm_watch(m_fd, it.key());
+#endif
+            it = m_watches.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void InotifyWatcher::readEvents() {
+#ifdef Q_OS_LINUX
+    alignas(struct inotify_event) char buffer[kEventBufferSize];
+    while (true) {
+        const ssize_t length = ::read(m_fd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;
+        }
+        for (ssize_t offset = 0; offset < length;) {
+            const auto *event = reinterpret_cast<const struct inotify_event *>(buffer + offset);
+            offset += static_cast<ssize_t>(sizeof(struct inotify_event) + event->len);
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                discardPending();
+                emit overflowed();
+                continue;
+            }
+            const auto it = m_watches.constFind(event->wd);
+            if (it == m_watches.constEnd()) {
+                continue;
+            }
+            const WatchedDir dir = it.value();
+            if (event->mask & IN_IGNORED) {
+                m_watches.remove(event->wd);
+                continue;
+            }
+            if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+                if (event->mask & IN_MOVE_SELF) {
+                    forgetWatches(dir.path);
+                }
+                queuePath(dir.path);
+                continue;
+            }
+            if (event->len == 0) {
+                continue;
+            }
+
+            const QString path = joinPath(dir.path, QFile::decodeName(event->name));
+            if (event->mask & IN_ISDIR) {
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    // Files created before the watch was in place are picked
+                    // up by rescanning the new directory as a whole.
+                    const bool descend = m_recursive && (m_maxDepth < 0 || dir.depth + 1 <= m_maxDepth);
+                    if (descend && !addWatches(path, dir.depth + 1)) {
+                        stop();
+                        return;
+                    }
+                    queuePath(path);
+                } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                    forgetWatches(path);
+                    queuePath(path);
+                }
+                continue;
+            }
+            queuePath(path);
+        }
+    }
+    scheduleFlush();
+#endif
+}
@@ -0,0 +1,40 @@
+#ifndef INOTIFYWATCHER_H
+#define INOTIFYWATCHER_H
+
+#include <QHash>
+
+#include "ChangeWatcher.h"
+
+class QSocketNotifier;
+
+// inotify backend: one watch per monitored directory, added recursively and
+// kept up to date as directories are created, moved and removed.
+class InotifyWatcher : public ChangeWatcher {
+    Q_OBJECT
+public:
+    explicit InotifyWatcher(QObject *parent = nullptr);
+    ~InotifyWatcher() override;
+
+public slots:
+    void start(const QStringList &roots, bool recursive, bool followSymlinks, int maxDepth) override;
+    void stop() override;
+
+private:
+    struct WatchedDir {
+        QString path;
+        int depth = 0;
+    };
+
+    void readEvents();
+    bool addWatches(const QString &directory, int depth);
+    void forgetWatches(const QString &directory);
+
+    int m_fd = -1;
+    QSocketNotifier *m_notifier = nullptr;
+    QHash<int, WatchedDir> m_watches;
+    bool m_recursive = true;
+    bool m_followSymlinks = false;
+    int m_maxDepth = 20;
+};
+
+#endif // INOTIFYWATCHER_H
@@ -48,6 +48,9 @@
 #include <QVBoxLayout>
 #include <algorithm>
 
+#include "FanotifyWatcher.h"
+#include "InotifyWatcher.h"
+
 namespace {
 class FileFilterProxyModel : public QSortFilterProxyModel {
 public:
@@ -155,6 +158,30 @@ QString resolveDatabasePath()
     QDir().mkpath(QFileInfo(path).dir().absolutePath());
     return path;
 }
+
+// Rule lists are stored as "path:<pattern>" / "glob:<pattern>" entries.
+QVector<ExcludeRule> rulesFromStrings(const QStringList &entries)
+{
+    QVector<ExcludeRule> rules;
+    for (const auto &entry : entries) {
+        if (entry.startsWith(QStringLiteral("path:"))) {
+            rules.append(ExcludeRule{ExcludeType::Path, entry.mid(5)});
+        } else if (entry.startsWith(QStringLiteral("glob:"))) {
+            rules.append(ExcludeRule{ExcludeType::Glob, entry.mid(5)});
+        }
+    }
+    return rules;
+}
+
+QStringList rulesToStrings(const QVector<ExcludeRule> &rules)
+{
+    QStringList entries;
+    for (const auto &rule : rules) {
+        const QString prefix = rule.type == ExcludeType::Path ? QStringLiteral("path:") : QStringLiteral("glob:");
+        entries << prefix + rule.pattern;
+    }
+    return entries;
+}
 } // namespace
 
 MainWindow::MainWindow(QWidget *parent)
@@ -171,6 +198,8 @@ MainWindow::MainWindow(QWidget *parent)
         m_monitoringEnabled = m_settings.value(QStringLiteral("monitoringEnabled"), false).toBool();
     }
     m_databaseManager.setHmacKey(m_hmacKey);
+    m_storageProfile = loadStorageProfile();
+    m_databaseManager.setStorageProfile(m_storageProfile);
     if (!m_databaseManager.initialize()) {
         QMessageBox::critical(this, tr("Database Error"), tr("Failed to initialize SQLite database."));
     }
@@ -181,6 +210,8 @@ MainWindow::MainWindow(QWidget *parent)
     loadExcludeRulesFromSettings();
     loadScanOptions();
     m_fileMonitor.setExcludeRules(m_excludeRules);
+    m_fileMonitor.setScanTuning(m_scanTuning);
+    m_fileMonitor.setCachePolicy(m_cachePolicyOption);
     populateCurrentRecords();
     reloadHistory();
 
@@ -191,10 +222,15 @@ MainWindow::MainWindow(QWidget *parent)
     m_scanTimer->setTimerType(Qt::VeryCoarseTimer);
     connect(m_scanTimer, &QTimer::timeout, this, &MainWindow::triggerMonitoringTick);
     updateMonitoringUi();
+    if (m_monitoringEnabled && m_monitoringMode != MonitoringMode::Polling) {
+        m_catchUpScanPending = true;
+        startChangeWatcher();
+    }
 }
 
 MainWindow::~MainWindow() {
     saveMonitoredDirsToSettings();
+    stopChangeWatcher();
     if (m_scanThread) {
         m_scanThread->quit();
         m_scanThread->wait();
@@ -433,6 +469,9 @@ void MainWindow::addDirectory() {
     m_dirList->addItem(path);
     saveMonitoredDirsToSettings();
     appendLogMessage(tr("Добавлена директория: %1").arg(path));
+    if (m_watcher) {
+        startChangeWatcher();
+    }
 }
 
 void MainWindow::removeSelectedDirectory() {
@@ -444,6 +483,9 @@ void MainWindow::removeSelectedDirectory() {
     appendLogMessage(tr("Удалена директория: %1").arg(removedPath));
     delete m_dirList->takeItem(m_dirList->row(item));
     saveMonitoredDirsToSettings();
+    if (m_watcher) {
+        startChangeWatcher();
+    }
 }
 
 void MainWindow::showExclusionsDialog() {
@@ -547,6 +589,9 @@ void MainWindow::showExclusionsDialog() {
     saveExcludeRulesToSettings();
     m_fileMonitor.setExcludeRules(m_excludeRules);
     appendLogMessage(tr("Обновлены исключения (%1 правил)").arg(m_excludeRules.size()));
+    if (m_watcher) {
+        startChangeWatcher();
+    }
 }
 
 void MainWindow::showFaqDialog() {
@@ -584,6 +629,32 @@ void MainWindow::beginScan(ScanTrigger trigger) {
         return;
     }
 
+    if (!startScanWorker(triggeredByTimer ? m_scheduledBudget : m_manualBudget)) {
+        return;
+    }
+    statusBar()->showMessage(triggeredByTimer ? tr("Фоновое сканирование...") : tr("Сканирование..."));
+
+    QStringList dirs;
+    for (int i = 0; i < m_dirList->count(); ++i) {
+        dirs << m_dirList->item(i)->text();
+    }
+
+    QMetaObject::invokeMethod(m_scanWorker, "startScan", Qt::QueuedConnection, Q_ARG(QStringList, dirs));
+}
+
+void MainWindow::beginTargetedScan(const QStringList &paths) {
+    if (m_scanInProgress || paths.isEmpty() || !startScanWorker(m_scheduledBudget)) {
+        return;
+    }
+    statusBar()->showMessage(tr("Проверка изменённых файлов (%1)...").arg(paths.size()));
+    QMetaObject::invokeMethod(m_scanWorker, "startTargetedScan", Qt::QueuedConnection, Q_ARG(QStringList, paths));
+}
+
+bool MainWindow::startScanWorker(const core::ResourceBudget &budget) {
+    if (m_scanInProgress) {
+        return false;
+    }
+
     if (m_scanThread) {
         m_scanThread->quit();
         m_scanThread->wait();
@@ -598,7 +669,11 @@ void MainWindow::beginScan(ScanTrigger trigger) {
                                   m_excludeRules,
                                   m_recursiveOption,
                                   m_followSymlinksOption,
-                                  m_maxDepthOption);
+                                  m_cachePolicyOption,
+                                  m_maxDepthOption,
+                                  m_scanTuning,
+                                  budget,
+                                  m_storageProfile);
     m_scanWorker->moveToThread(m_scanThread);
 
     connect(m_scanThread, &QThread::finished, m_scanWorker, &QObject::deleteLater);
@@ -612,15 +687,8 @@ void MainWindow::beginScan(ScanTrigger trigger) {
     m_scanInProgress = true;
     updateActionAvailability();
     updateProgressLabel(0, 0);
-    statusBar()->showMessage(triggeredByTimer ? tr("Фоновое сканирование...") : tr("Сканирование..."));
     m_lastScan = QDateTime::currentDateTime();
-
-    QStringList dirs;
-    for (int i = 0; i < m_dirList->count(); ++i) {
-        dirs << m_dirList->item(i)->text();
-    }
-
-    QMetaObject::invokeMethod(m_scanWorker, "startScan", Qt::QueuedConnection, Q_ARG(QStringList, dirs));
+    return true;
 }
 
 void MainWindow::clearHistory() {
@@ -832,6 +900,8 @@ void MainWindow::rebuildTable() {
         const QString detail = rec.errorReason.isEmpty() ? rec.metadata.errorReason : rec.errorReason;
         if (status == QLatin1String("Error") && detail.contains(QStringLiteral("Недостаточно прав"), Qt::CaseInsensitive)) {
             statusText = tr("Недостаточно прав");
+        } else if (status == QLatin1String("Ok") && rec.verifyTier == VerifyTier::Sampled) {
+            statusText = tr("Без изменений (выборочно)");
         }
 
         auto *statusItem = new QStandardItem(statusText);
@@ -957,35 +1027,81 @@ void MainWindow::saveMonitoredDirsToSettings() {
 }
 
 void MainWindow::loadExcludeRulesFromSettings() {
-    m_excludeRules.clear();
-    const QStringList rules = m_settings.value(QStringLiteral("excludeRules")).toStringList();
-
-    for (const auto &entry : rules) {
-        if (entry.startsWith(QStringLiteral("path:"))) {
-            ExcludeRule rule{ExcludeType::Path, entry.mid(5)};
-            m_excludeRules.append(rule);
-        } else if (entry.startsWith(QStringLiteral("glob:"))) {
-            ExcludeRule rule{ExcludeType::Glob, entry.mid(5)};
-            m_excludeRules.append(rule);
-        }
-    }
+    m_excludeRules = rulesFromStrings(m_settings.value(QStringLiteral("excludeRules")).toStringList());
 }
 
 void MainWindow::saveExcludeRulesToSettings() {
-    QStringList rules;
-    for (const auto &rule : m_excludeRules) {
-        const QString prefix = rule.type == ExcludeType::Path ? QStringLiteral("path:") : QStringLiteral("glob:");
-        rules << prefix + rule.pattern;
-    }
-
-    m_settings.setValue(QStringLiteral("excludeRules"), rules);
+    m_settings.setValue(QStringLiteral("excludeRules"), rulesToStrings(m_excludeRules));
 }
 
 void MainWindow::loadScanOptions() {
     m_intervalSpin->setValue(m_settings.value(QStringLiteral("intervalSeconds"), 300).toInt());
     m_recursiveOption = m_settings.value(QStringLiteral("recursive"), true).toBool();
     m_followSymlinksOption = m_settings.value(QStringLiteral("followSymlinks"), false).toBool();
+    m_cachePolicySetting = m_settings.value(QStringLiteral("cachePolicy"), QStringLiteral("keep")).toString();
+    if (m_cachePolicySetting == QLatin1String("dropbehind")) {
+        m_cachePolicyOption = core::CachePolicy::DropBehind;
+    } else if (m_cachePolicySetting == QLatin1String("direct")) {
+        m_cachePolicyOption = core::CachePolicy::Direct;
+    } else {
+        m_cachePolicyOption = core::CachePolicy::Keep;
+    }
     m_maxDepthOption = m_settings.value(QStringLiteral("maxDepth"), 20).toInt();
+    m_scanTuning.scanThreads = m_settings.value(QStringLiteral("scanThreads"), 0).toInt();
+    m_scanTuning.commitBatchRows = m_settings.value(QStringLiteral("commitBatchRows"), 500).toInt();
+    m_scanTuning.commitIntervalMs = m_settings.value(QStringLiteral("commitIntervalMs"), 1000).toInt();
+    m_scanTuning.ioQueueDepth = m_settings.value(QStringLiteral("ioQueueDepth"), 0).toInt();
+    m_scanTuning.rotationalDeviceThreads = m_settings.value(QStringLiteral("rotationalDeviceThreads"), 2).toInt();
+    m_scanTuning.solidStateDeviceThreads = m_settings.value(QStringLiteral("solidStateDeviceThreads"), 0).toInt();
+    m_readOrderSetting = m_settings.value(QStringLiteral("readOrder"), QStringLiteral("discovery")).toString();
+    if (m_readOrderSetting == QLatin1String("inode")) {
+        m_scanTuning.readOrder = core::ReadOrder::Inode;
+    } else if (m_readOrderSetting == QLatin1String("extent")) {
+        m_scanTuning.readOrder = core::ReadOrder::Extent;
+    } else {
+        m_scanTuning.readOrder = core::ReadOrder::Discovery;
+    }
+    m_scanTuning.merkleThresholdBytes =
+        m_settings.value(QStringLiteral("merkleThresholdMB"), 0).toLongLong() * 1024 * 1024;
+    m_scanTuning.merkleChunkBytes = m_settings.value(QStringLiteral("merkleChunkMB"), 64).toLongLong() * 1024 * 1024;
+    m_scanTuning.fastIncremental = m_settings.value(QStringLiteral("fastIncremental"), false).toBool();
+    m_scanTuning.streamingWalk = m_settings.value(QStringLiteral("streamingWalk"), false).toBool();
+    m_scanTuning.appendOnlyResume = m_settings.value(QStringLiteral("appendOnlyResume"), false).toBool();
+    m_scanTuning.quickVerifyThresholdBytes =
+        m_settings.value(QStringLiteral("quickVerifyThresholdMB"), 0).toLongLong() * 1024 * 1024;
+    m_scanTuning.quickVerifySamples = m_settings.value(QStringLiteral("quickVerifySamples"), 64).toInt();
+    m_scanTuning.quickVerifyBlockBytes = m_settings.value(QStringLiteral("quickVerifyBlockKB"), 64).toLongLong() * 1024;
+    m_scanTuning.quickVerifyInclude =
+        rulesFromStrings(m_settings.value(QStringLiteral("quickVerifyInclude")).toStringList());
+    m_scanTuning.quickVerifyExclude =
+        rulesFromStrings(m_settings.value(QStringLiteral("quickVerifyExclude")).toStringList());
+    m_scanTuning.fullRehashCycle = m_settings.value(QStringLiteral("fullRehashCycle"), 288).toInt();
+    m_scanTuning.hashAlgorithm =
+        m_settings.value(QStringLiteral("hashAlgorithm"), QStringLiteral("sha256")).toString() == QLatin1String("blake3")
+        ? HashAlgorithm::Blake3
+        : HashAlgorithm::Sha256;
+    m_scanTuning.hashMigrationFilesPerScan =
+        m_settings.value(QStringLiteral("hashMigrationFilesPerScan"), 2000).toInt();
+    m_scanTuning.extraDigests = 0;
+    for (const QString &digest : m_settings.value(QStringLiteral("extraDigests")).toStringList()) {
+        if (digest == QLatin1String("sha512")) {
+            m_scanTuning.extraDigests |= core::DigestSha512;
+        } else if (digest == QLatin1String("md5")) {
+            m_scanTuning.extraDigests |= core::DigestMd5;
+        }
+    }
+    m_monitoringModeSetting = m_settings.value(QStringLiteral("monitoringMode"), QStringLiteral("inotify")).toString();
+    if (m_monitoringModeSetting == QLatin1String("poll")) {
+        m_monitoringMode = MonitoringMode::Polling;
+    } else if (m_monitoringModeSetting == QLatin1String("fanotify")) {
+        m_monitoringMode = MonitoringMode::Fanotify;
+    } else {
+        m_monitoringMode = MonitoringMode::Inotify;
+    }
+    m_manualBudget = loadBudget(QStringLiteral("manual"));
+    m_scheduledBudget = loadBudget(QStringLiteral("scheduled"));
+    m_watchDebounceMs = m_settings.value(QStringLiteral("watchDebounceMs"), 2000).toInt();
+    m_watchMaxDelayMs = m_settings.value(QStringLiteral("watchMaxDelayMs"), 10000).toInt();
     if (m_settings.contains(QStringLiteral("monitoringEnabled"))) {
         m_monitoringEnabled = m_settings.value(QStringLiteral("monitoringEnabled"), false).toBool();
     }
@@ -996,11 +1112,103 @@ void MainWindow::saveScanOptions() {
     m_settings.setValue(QStringLiteral("intervalSeconds"), m_intervalSpin->value());
     m_settings.setValue(QStringLiteral("recursive"), m_recursiveOption);
     m_settings.setValue(QStringLiteral("followSymlinks"), m_followSymlinksOption);
+    m_settings.setValue(QStringLiteral("cachePolicy"), m_cachePolicySetting);
     m_settings.setValue(QStringLiteral("maxDepth"), m_maxDepthOption);
+    m_settings.setValue(QStringLiteral("scanThreads"), m_scanTuning.scanThreads);
+    m_settings.setValue(QStringLiteral("commitBatchRows"), m_scanTuning.commitBatchRows);
+    m_settings.setValue(QStringLiteral("commitIntervalMs"), m_scanTuning.commitIntervalMs);
+    m_settings.setValue(QStringLiteral("ioQueueDepth"), m_scanTuning.ioQueueDepth);
+    m_settings.setValue(QStringLiteral("rotationalDeviceThreads"), m_scanTuning.rotationalDeviceThreads);
+    m_settings.setValue(QStringLiteral("solidStateDeviceThreads"), m_scanTuning.solidStateDeviceThreads);
+    m_settings.setValue(QStringLiteral("readOrder"), m_readOrderSetting);
+    m_settings.setValue(QStringLiteral("merkleThresholdMB"), m_scanTuning.merkleThresholdBytes / (1024 * 1024));
+    m_settings.setValue(QStringLiteral("merkleChunkMB"), m_scanTuning.merkleChunkBytes / (1024 * 1024));
+    m_settings.setValue(QStringLiteral("fastIncremental"), m_scanTuning.fastIncremental);
+    m_settings.setValue(QStringLiteral("streamingWalk"), m_scanTuning.streamingWalk);
+    m_settings.setValue(QStringLiteral("appendOnlyResume"), m_scanTuning.appendOnlyResume);
+    m_settings.setValue(QStringLiteral("quickVerifyThresholdMB"), m_scanTuning.quickVerifyThresholdBytes / (1024 * 1024));
+    m_settings.setValue(QStringLiteral("quickVerifySamples"), m_scanTuning.quickVerifySamples);
+    m_settings.setValue(QStringLiteral("quickVerifyBlockKB"), m_scanTuning.quickVerifyBlockBytes / 1024);
+    m_settings.setValue(QStringLiteral("quickVerifyInclude"), rulesToStrings(m_scanTuning.quickVerifyInclude));
+    m_settings.setValue(QStringLiteral("quickVerifyExclude"), rulesToStrings(m_scanTuning.quickVerifyExclude));
+    m_settings.setValue(QStringLiteral("fullRehashCycle"), m_scanTuning.fullRehashCycle);
+    m_settings.setValue(QStringLiteral("hashAlgorithm"),
+                        m_scanTuning.hashAlgorithm == HashAlgorithm::Blake3 ? QStringLiteral("blake3")
+                                                                             : QStringLiteral("sha256"));
+    m_settings.setValue(QStringLiteral("hashMigrationFilesPerScan"), m_scanTuning.hashMigrationFilesPerScan);
+    QStringList extraDigests;
+    if (m_scanTuning.extraDigests & core::DigestSha512) {
+        extraDigests.append(QStringLiteral("sha512"));
+    }
+    if (m_scanTuning.extraDigests & core::DigestMd5) {
+        extraDigests.append(QStringLiteral("md5"));
+    }
+    m_settings.setValue(QStringLiteral("extraDigests"), extraDigests);
+    m_settings.setValue(QStringLiteral("monitoringMode"), m_monitoringModeSetting);
+    saveBudget(QStringLiteral("manual"), m_manualBudget);
+    saveBudget(QStringLiteral("scheduled"), m_scheduledBudget);
+    m_settings.setValue(QStringLiteral("watchDebounceMs"), m_watchDebounceMs);
+    m_settings.setValue(QStringLiteral("watchMaxDelayMs"), m_watchMaxDelayMs);
     m_settings.sync();
     scheduleNextScan();
 }
 
+// Budgets live under budget/<trigger>/; background scans default to idle
+// priority, manual ones to no limits at all.
+core::ResourceBudget MainWindow::loadBudget(const QString &trigger) const {
+    const QString prefix = QStringLiteral("budget/%1/").arg(trigger);
+    const bool background = trigger == QLatin1String("scheduled");
+    core::ResourceBudget budget;
+    budget.idlePriority = m_settings.value(prefix + QStringLiteral("idlePriority"), background).toBool();
+    budget.readBytesPerSecond =
+        m_settings.value(prefix + QStringLiteral("readMBps"), 0).toULongLong() * 1024 * 1024;
+    budget.memoryLimitBytes =
+        m_settings.value(prefix + QStringLiteral("memoryLimitMB"), 0).toULongLong() * 1024 * 1024;
+    budget.ownCgroup = m_settings.value(prefix + QStringLiteral("ownCgroup"), false).toBool();
+    budget.cpuPercent = m_settings.value(prefix + QStringLiteral("cpuPercent"), 0).toUInt();
+    budget.ioWeight = m_settings.value(prefix + QStringLiteral("ioWeight"), 0).toUInt();
+    return budget;
+}
+
+void MainWindow::saveBudget(const QString &trigger, const core::ResourceBudget &budget) {
+    const QString prefix = QStringLiteral("budget/%1/").arg(trigger);
+    m_settings.setValue(prefix + QStringLiteral("idlePriority"), budget.idlePriority);
+    m_settings.setValue(prefix + QStringLiteral("readMBps"), budget.readBytesPerSecond / (1024 * 1024));
+    m_settings.setValue(prefix + QStringLiteral("memoryLimitMB"), budget.memoryLimitBytes / (1024 * 1024));
+    m_settings.setValue(prefix + QStringLiteral("ownCgroup"), budget.ownCgroup);
+    m_settings.setValue(prefix + QStringLiteral("cpuPercent"), budget.cpuPercent);
+    m_settings.setValue(prefix + QStringLiteral("ioWeight"), budget.ioWeight);
+}
+
+StorageProfile MainWindow::loadStorageProfile() const {
+    const StorageProfile defaults;
+    StorageProfile profile;
+    profile.walJournal = m_settings.value(QStringLiteral("storage/walJournal"), defaults.walJournal).toBool();
+    profile.synchronousFull =
+        m_settings.value(QStringLiteral("storage/synchronous"), QStringLiteral("normal")).toString() == QLatin1String("full");
+    profile.mmapBytes =
+        m_settings.value(QStringLiteral("storage/mmapMB"), defaults.mmapBytes / (1024 * 1024)).toLongLong() * 1024 * 1024;
+    profile.cacheBytes =
+        m_settings.value(QStringLiteral("storage/cacheMB"), defaults.cacheBytes / (1024 * 1024)).toLongLong() * 1024 * 1024;
+    profile.tempStoreMemory =
+        m_settings.value(QStringLiteral("storage/tempStoreMemory"), defaults.tempStoreMemory).toBool();
+    profile.busyTimeoutMs = m_settings.value(QStringLiteral("storage/busyTimeoutMs"), defaults.busyTimeoutMs).toInt();
+    profile.vacuumPagesPerRun =
+        m_settings.value(QStringLiteral("storage/vacuumPagesPerRun"), defaults.vacuumPagesPerRun).toInt();
+    return profile;
+}
+
+void MainWindow::saveStorageProfile(const StorageProfile &profile) {
+    m_settings.setValue(QStringLiteral("storage/walJournal"), profile.walJournal);
+    m_settings.setValue(QStringLiteral("storage/synchronous"),
+                        profile.synchronousFull ? QStringLiteral("full") : QStringLiteral("normal"));
+    m_settings.setValue(QStringLiteral("storage/mmapMB"), profile.mmapBytes / (1024 * 1024));
+    m_settings.setValue(QStringLiteral("storage/cacheMB"), profile.cacheBytes / (1024 * 1024));
+    m_settings.setValue(QStringLiteral("storage/tempStoreMemory"), profile.tempStoreMemory);
+    m_settings.setValue(QStringLiteral("storage/busyTimeoutMs"), profile.busyTimeoutMs);
+    m_settings.setValue(QStringLiteral("storage/vacuumPagesPerRun"), profile.vacuumPagesPerRun);
+}
+
 void MainWindow::saveMonitoringState() {
     m_settings.setValue(QStringLiteral("monitoringEnabled"), m_monitoringEnabled);
     m_settings.sync();
@@ -1021,9 +1229,86 @@ void MainWindow::ensureDefaultSettings() {
     if (!m_settings.contains(QStringLiteral("followSymlinks"))) {
         m_settings.setValue(QStringLiteral("followSymlinks"), false);
     }
+    if (!m_settings.contains(QStringLiteral("cachePolicy"))) {
+        m_settings.setValue(QStringLiteral("cachePolicy"), QStringLiteral("keep"));
+    }
     if (!m_settings.contains(QStringLiteral("maxDepth"))) {
         m_settings.setValue(QStringLiteral("maxDepth"), 20);
     }
+    if (!m_settings.contains(QStringLiteral("scanThreads"))) {
+        m_settings.setValue(QStringLiteral("scanThreads"), 0);
+    }
+    if (!m_settings.contains(QStringLiteral("commitBatchRows"))) {
+        m_settings.setValue(QStringLiteral("commitBatchRows"), 500);
+    }
+    if (!m_settings.contains(QStringLiteral("commitIntervalMs"))) {
+        m_settings.setValue(QStringLiteral("commitIntervalMs"), 1000);
+    }
+    if (!m_settings.contains(QStringLiteral("ioQueueDepth"))) {
+        m_settings.setValue(QStringLiteral("ioQueueDepth"), 0);
+    }
+    if (!m_settings.contains(QStringLiteral("rotationalDeviceThreads"))) {
+        m_settings.setValue(QStringLiteral("rotationalDeviceThreads"), 2);
+    }
+    if (!m_settings.contains(QStringLiteral("solidStateDeviceThreads"))) {
+        m_settings.setValue(QStringLiteral("solidStateDeviceThreads"), 0);
+    }
+    if (!m_settings.contains(QStringLiteral("readOrder"))) {
+        m_settings.setValue(QStringLiteral("readOrder"), QStringLiteral("discovery"));
+    }
+    if (!m_settings.contains(QStringLiteral("merkleThresholdMB"))) {
+        m_settings.setValue(QStringLiteral("merkleThresholdMB"), 0);
+    }
+    if (!m_settings.contains(QStringLiteral("merkleChunkMB"))) {
+        m_settings.setValue(QStringLiteral("merkleChunkMB"), 64);
+    }
+    if (!m_settings.contains(QStringLiteral("fastIncremental"))) {
+        m_settings.setValue(QStringLiteral("fastIncremental"), false);
+    }
+    if (!m_settings.contains(QStringLiteral("streamingWalk"))) {
+        m_settings.setValue(QStringLiteral("streamingWalk"), false);
+    }
+    if (!m_settings.contains(QStringLiteral("appendOnlyResume"))) {
+        m_settings.setValue(QStringLiteral("appendOnlyResume"), false);
+    }
+    if (!m_settings.contains(QStringLiteral("quickVerifyThresholdMB"))) {
+        m_settings.setValue(QStringLiteral("quickVerifyThresholdMB"), 0);
+    }
+    if (!m_settings.contains(QStringLiteral("quickVerifySamples"))) {
+        m_settings.setValue(QStringLiteral("quickVerifySamples"), 64);
+    }
+    if (!m_settings.contains(QStringLiteral("quickVerifyBlockKB"))) {
+        m_settings.setValue(QStringLiteral("quickVerifyBlockKB"), 64);
+    }
+    if (!m_settings.contains(QStringLiteral("fullRehashCycle"))) {
+        m_settings.setValue(QStringLiteral("fullRehashCycle"), 288);
+    }
+    if (!m_settings.contains(QStringLiteral("hashAlgorithm"))) {
+        m_settings.setValue(QStringLiteral("hashAlgorithm"), QStringLiteral("sha256"));
+    }
+    if (!m_settings.contains(QStringLiteral("hashMigrationFilesPerScan"))) {
+        m_settings.setValue(QStringLiteral("hashMigrationFilesPerScan"), 2000);
+    }
+    if (!m_settings.contains(QStringLiteral("extraDigests"))) {
+        m_settings.setValue(QStringLiteral("extraDigests"), QStringList());
+    }
+    for (const QString &trigger : {QStringLiteral("manual"), QStringLiteral("scheduled")}) {
+        if (!m_settings.contains(QStringLiteral("budget/%1/idlePriority").arg(trigger))) {
+            saveBudget(trigger, loadBudget(trigger));
+        }
+    }
+    if (!m_settings.contains(QStringLiteral("storage/walJournal"))) {
+        saveStorageProfile(loadStorageProfile());
+    }
+    if (!m_settings.contains(QStringLiteral("monitoringMode"))) {
+        m_settings.setValue(QStringLiteral("monitoringMode"), QStringLiteral("inotify"));
+    }
+    if (!m_settings.contains(QStringLiteral("watchDebounceMs"))) {
+        m_settings.setValue(QStringLiteral("watchDebounceMs"), 2000);
+    }
+    if (!m_settings.contains(QStringLiteral("watchMaxDelayMs"))) {
+        m_settings.setValue(QStringLiteral("watchMaxDelayMs"), 10000);
+    }
     if (!m_settings.contains(QStringLiteral("monitoringEnabled"))) {
         m_settings.setValue(QStringLiteral("monitoringEnabled"), false);
     }
@@ -1041,7 +1326,8 @@ void MainWindow::scheduleNextScan() {
         return;
     }
     m_scanTimer->stop();
-    if (!m_monitoringEnabled || m_intervalSpin->value() <= 0 || m_scanInProgress) {
+    if (!m_monitoringEnabled || m_monitoringMode != MonitoringMode::Polling || m_intervalSpin->value() <= 0
+        || m_scanInProgress) {
         return;
     }
     m_scanTimer->start(m_intervalSpin->value() * 1000);
@@ -1081,7 +1367,9 @@ void MainWindow::rescanSingleFile(const QString &path) {
         return;
     }
 
-    const auto results = m_fileMonitor.scanDirectory(info.absolutePath(), false, false, 1);
+    // A targeted rescan of the one file: no directory walk and no step of the
+    // rehash rotation.
+    const auto results = m_fileMonitor.scanPaths({info.absoluteFilePath()}, false, false, 1);
     const int total = results.size();
     for (int index = 0; index < total; ++index) {
         updateProgressLabel(index + 1, total);
@@ -1183,6 +1471,7 @@ void MainWindow::handleScanFinished(const QVector<FileRecordEntry> &results) {
                          .arg(summary.errorCount));
     showSummaryNotification(summary);
     scheduleNextScan();
+    runPendingMonitoringWork();
 }
 
 void MainWindow::handleScanError(const QString &message) {
@@ -1202,6 +1491,7 @@ void MainWindow::handleScanError(const QString &message) {
         m_trayIcon->showMessage(tr("Ошибка сканирования"), message, QSystemTrayIcon::Warning);
     }
     scheduleNextScan();
+    runPendingMonitoringWork();
 }
 
 void MainWindow::handleScanProgress(int current, int total) {
@@ -1276,7 +1566,12 @@ void MainWindow::startMonitoring() {
     m_monitoringEnabled = true;
     saveMonitoringState();
     updateMonitoringUi();
-    scheduleNextScan();
+    if (m_monitoringMode != MonitoringMode::Polling) {
+        m_catchUpScanPending = true;
+        startChangeWatcher();
+    } else {
+        scheduleNextScan();
+    }
 }
 
 void MainWindow::stopMonitoring() {
@@ -1287,10 +1582,121 @@ void MainWindow::stopMonitoring() {
     if (m_scanTimer) {
         m_scanTimer->stop();
     }
+    stopChangeWatcher();
     saveMonitoringState();
     updateMonitoringUi();
 }
 
+// (Re)starts the watcher on the current directories and exclusions. It runs
+// on its own thread so setting up watches on a large tree does not block
+// the UI.
+void MainWindow::startChangeWatcher() {
+    stopChangeWatcher();
+
+    QStringList dirs;
+    for (int i = 0; i < m_dirList->count(); ++i) {
+        dirs << m_dirList->item(i)->text();
+    }
+
+    m_watcherThread = new QThread(this);
+    if (m_monitoringMode == MonitoringMode::Fanotify) {
+        m_watcher = new FanotifyWatcher;
+    } else {
+        m_watcher = new InotifyWatcher;
+    }
+    m_watcher->setExcludeRules(m_excludeRules);
+    m_watcher->setDebounce(m_watchDebounceMs, m_watchMaxDelayMs);
+    m_watcher->moveToThread(m_watcherThread);
+
+    connect(m_watcherThread, &QThread::finished, m_watcher, &QObject::deleteLater);
+    connect(m_watcher, &ChangeWatcher::pathsChanged, this, &MainWindow::handleWatchedPathsChanged);
+    connect(m_watcher, &ChangeWatcher::overflowed, this, &MainWindow::handleWatcherOverflow);
+    connect(m_watcher, &ChangeWatcher::failed, this, &MainWindow::handleWatcherFailed);
+    connect(m_watcher, &ChangeWatcher::started, this, [this]() {
+        appendLogMessage(tr("Мониторинг по событиям запущен"));
+        // Changes made while nothing was watching are only found by a full
+        // scan; the watches are already in place, so nothing slips between.
+        if (m_catchUpScanPending) {
+            m_catchUpScanPending = false;
+            m_fullRescanPending = true;
+            runPendingMonitoringWork();
+        }
+    });
+
+    m_watcherThread->start();
+    QMetaObject::invokeMethod(m_watcher,
+                              "start",
+                              Qt::QueuedConnection,
+                              Q_ARG(QStringList, dirs),
+                              Q_ARG(bool, m_recursiveOption),
+                              Q_ARG(bool, m_followSymlinksOption),
+                              Q_ARG(int, m_maxDepthOption));
+}
+
+void MainWindow::stopChangeWatcher() {
+    if (!m_watcherThread) {
+        return;
+    }
+    m_watcherThread->quit();
+    m_watcherThread->wait();
+    m_watcherThread->deleteLater();
+    m_watcherThread = nullptr;
+    m_watcher = nullptr;
+    m_pendingChangedPaths.clear();
+    m_fullRescanPending = false;
+}
+
+void MainWindow::handleWatchedPathsChanged(const QStringList &paths) {
+    if (!m_monitoringEnabled) {
+        return;
+    }
+    for (const QString &path : paths) {
+        m_pendingChangedPaths.insert(path);
+    }
+    runPendingMonitoringWork();
+}
+
+void MainWindow::handleWatcherOverflow() {
+    appendLogMessage(tr("Переполнение очереди событий inotify, выполняется полное сканирование"));
+    m_pendingChangedPaths.clear();
+    m_fullRescanPending = true;
+    runPendingMonitoringWork();
+}
+
+void MainWindow::handleWatcherFailed(const QString &message) {
+    appendLogMessage(tr("Мониторинг по событиям недоступен: %1").arg(message));
+    stopChangeWatcher();
+    // Not saved: the configured mode is retried on the next start. fanotify
+    // falls back to inotify (it needs CAP_SYS_ADMIN), inotify to polling.
+    if (m_monitoringMode == MonitoringMode::Fanotify) {
+        appendLogMessage(tr("Переключение на inotify"));
+        m_monitoringMode = MonitoringMode::Inotify;
+        startChangeWatcher();
+        return;
+    }
+    appendLogMessage(tr("Переключение на периодическое сканирование"));
+    m_monitoringMode = MonitoringMode::Polling;
+    scheduleNextScan();
+}
+
+// Events that arrive during a scan are collected and handled once it ends.
+void MainWindow::runPendingMonitoringWork() {
+    if (m_scanInProgress || !m_monitoringEnabled) {
+        return;
+    }
+    if (m_fullRescanPending) {
+        m_fullRescanPending = false;
+        m_pendingChangedPaths.clear();
+        beginScan(ScanTrigger::Scheduled);
+        return;
+    }
+    if (!m_pendingChangedPaths.isEmpty()) {
+        const QStringList paths(m_pendingChangedPaths.cbegin(), m_pendingChangedPaths.cend());
+        m_pendingChangedPaths.clear();
+        beginTargetedScan(paths);
+    }
+}
+
 void MainWindow::pauseOrResumeMonitoring() {
     if (m_monitoringEnabled) {
         stopMonitoring();
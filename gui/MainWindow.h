@@ -12,6 +12,7 @@
 #include <QMainWindow>
 #include <QMenu>
 #include <QPlainTextEdit>
+#include <QSet>
 #include <QSettings>
 #include <QSortFilterProxyModel>
 #include <QSplitter>
@@ -28,6 +29,7 @@
 #include "core/ScanSummary.h"
 #include "DatabaseManager.h"
 #include "FileMonitor.h"
+#include "ChangeWatcher.h"
 #include "ScanWorker.h"
 
 class MainWindow : public QMainWindow {
@@ -61,6 +63,9 @@ protected:
 
 private:
     enum class ScanTrigger { Manual, Scheduled };
+    // Polling rescans everything on a timer; the watcher modes rescan only
+    // the paths an inotify or fanotify watcher reports.
+    enum class MonitoringMode { Polling, Inotify, Fanotify };
 
     void setupUi();
     void setupTrayIcon();
@@ -82,6 +87,18 @@ private:
     void saveScanOptions();
     void saveMonitoringState();
     void beginScan(ScanTrigger trigger);
+    void beginTargetedScan(const QStringList &paths);
+    bool startScanWorker(const core::ResourceBudget &budget);
+    core::ResourceBudget loadBudget(const QString &trigger) const;
+    void saveBudget(const QString &trigger, const core::ResourceBudget &budget);
+    StorageProfile loadStorageProfile() const;
+    void saveStorageProfile(const StorageProfile &profile);
+    void startChangeWatcher();
+    void stopChangeWatcher();
+    void handleWatchedPathsChanged(const QStringList &paths);
+    void handleWatcherOverflow();
+    void handleWatcherFailed(const QString &message);
+    void runPendingMonitoringWork();
     void updateMonitoringUi();
     void updateActionAvailability();
     void ensureDefaultSettings();
@@ -114,6 +131,16 @@ private:
     QDateTime m_lastScan;
     QVector<ExcludeRule> m_excludeRules;
     QTimer *m_scanTimer = nullptr;
+    QString m_readOrderSetting;
+    QString m_monitoringModeSetting;
+    MonitoringMode m_monitoringMode = MonitoringMode::Inotify; // may fall back at runtime
+    int m_watchDebounceMs = 2000;
+    int m_watchMaxDelayMs = 10000;
+    QThread *m_watcherThread = nullptr;
+    ChangeWatcher *m_watcher = nullptr;
+    QSet<QString> m_pendingChangedPaths;
+    bool m_fullRescanPending = false;
+    bool m_catchUpScanPending = false;
     QSystemTrayIcon *m_trayIcon = nullptr;
     QAction *m_trayScanAction = nullptr;
     QAction *m_trayPauseAction = nullptr;
@@ -138,7 +165,13 @@ private:
     QAction *m_faqAction;
     bool m_recursiveOption{true};
     bool m_followSymlinksOption{false};
+    QString m_cachePolicySetting;
+    core::CachePolicy m_cachePolicyOption{core::CachePolicy::Keep};
     int m_maxDepthOption{20};
+    ScanTuning m_scanTuning;
+    core::ResourceBudget m_manualBudget;
+    core::ResourceBudget m_scheduledBudget; // timer ticks and change-watcher rescans
+    StorageProfile m_storageProfile; // read once at startup, used by every connection
     QSpinBox *m_intervalSpin;
     QStandardItemModel *m_tableModel;
     QSortFilterProxyModel *m_proxyModel;
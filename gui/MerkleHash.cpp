@@ -0,0 +1,66 @@
+#include "MerkleHash.h"
+
+#include <QCryptographicHash>
+
+namespace {
+
+QByteArray merkleRoot(QByteArray level) {
+    if (level.isEmpty()) {
+        const char leafTag = 0;
+        return QCryptographicHash::hash(QByteArray(&leafTag, 1), QCryptographicHash::Sha256);
+    }
+    const char nodeTag = 1;
+    while (level.size() > kMerkleDigestSize) {
+        QByteArray parent;
+        for (qsizetype i = 0; i < level.size(); i += 2 * kMerkleDigestSize) {
+            if (i + kMerkleDigestSize >= level.size()) {
+                parent += level.mid(i, kMerkleDigestSize);
+                continue;
+            }
+            QCryptographicHash node(QCryptographicHash::Sha256);
+            node.addData(QByteArrayView(&nodeTag, 1));
+            node.addData(QByteArrayView(level.constData() + i, 2 * kMerkleDigestSize));
+            parent += node.result();
+        }
+        level = parent;
+    }
+    return level;
+}
+
+}
+
+QString hashFormat(const QString &hash) {
+    const qsizetype colon = hash.indexOf(QLatin1Char(':'));
+    return colon < 0 ? QString() : hash.left(colon);
+}
+
+QString merkleHash(qint64 chunkSize, const QByteArray &leaves) {
+    return QStringLiteral("merkle-%1k:%2")
+        .arg(chunkSize / 1024)
+        .arg(QString::fromLatin1(merkleRoot(leaves).toHex()));
+}
+
+QVector<QPair<qint64, qint64>> changedByteRanges(const QByteArray &oldLeaves,
+                                                 const QByteArray &newLeaves,
+                                                 qint64 chunkSize,
+                                                 qint64 newSize) {
+    QVector<QPair<qint64, qint64>> ranges;
+    const qsizetype count = newLeaves.size() / kMerkleDigestSize;
+    for (qsizetype i = 0; i < count; ++i) {
+        const qsizetype offset = i * kMerkleDigestSize;
+        const bool same = offset + kMerkleDigestSize <= oldLeaves.size()
+            && QByteArrayView(oldLeaves).sliced(offset, kMerkleDigestSize)
+                == QByteArrayView(newLeaves).sliced(offset, kMerkleDigestSize);
+        if (same) {
+            continue;
+        }
+        const qint64 first = i * chunkSize;
+        const qint64 last = qMin(newSize, first + chunkSize);
+        if (!ranges.isEmpty() && ranges.last().second == first) {
+            ranges.last().second = last;
+        } else {
+            ranges.append({first, last});
+        }
+    }
+    return ranges;
+}
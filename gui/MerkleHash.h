@@ -0,0 +1,32 @@
+#ifndef MERKLEHASH_H
+#define MERKLEHASH_H
+
+#include <QByteArray>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+// Chunked file digests. A file is cut into chunkSize-byte chunks; each chunk
+// gives a leaf SHA-256(0x00 || chunk), and pairs of nodes are combined as
+// SHA-256(0x01 || left || right) up to a single root, an odd node moving up
+// unchanged. The leaves can be computed in parallel, and two sets of leaves
+// show which byte ranges differ.
+//
+// The file's hash is stored as "merkle-<chunk KiB>k:<root hex>", so it never
+// equals a plain SHA-256 or a root over another chunk size.
+
+constexpr int kMerkleDigestSize = 32;
+
+// Hash formats differ when one of the hashes is a Merkle root and the other
+// is not, or when the chunk sizes differ; such hashes cannot be compared.
+QString hashFormat(const QString &hash);
+QString merkleHash(qint64 chunkSize, const QByteArray &leaves);
+// Byte ranges [first, last) of the new file whose chunk differs from the old
+// one, adjacent chunks merged. Chunks past the end of either file count as
+// changed.
+QVector<QPair<qint64, qint64>> changedByteRanges(const QByteArray &oldLeaves,
+                                                 const QByteArray &newLeaves,
+                                                 qint64 chunkSize,
+                                                 qint64 newSize);
+
+#endif // MERKLEHASH_H
@@ -1,6 +1,7 @@
 #include "ScanWorker.h"
 
 #include <QCoreApplication>
+#include <QDebug>
 #include <QThread>
 #include <atomic>
 
@@ -13,21 +14,54 @@ ScanWorker::ScanWorker(const QString &databasePath,
                        const QVector<ExcludeRule> &rules,
                        bool recursive,
                        bool followSymlinks,
+                       core::CachePolicy cachePolicy,
                        int maxDepth,
+                       const ScanTuning &tuning,
+                       const core::ResourceBudget &budget,
+                       const StorageProfile &storageProfile,
                        QObject *parent)
     : QObject(parent),
       m_databaseManager(databasePath, QStringLiteral("integrity_worker_%1").arg(++g_workerCounter)),
       m_fileMonitor(m_databaseManager),
       m_recursive(recursive),
       m_followSymlinks(followSymlinks),
-      m_maxDepth(maxDepth) {
+      m_maxDepth(maxDepth),
+      m_budget(budget) {
     m_databaseManager.setHmacKey(hmacKey);
+    m_databaseManager.setStorageProfile(storageProfile);
     m_databaseManager.initialize();
     m_fileMonitor.setExcludeRules(rules);
+    m_fileMonitor.setScanTuning(tuning);
+    // Without a cgroup to cap it, a memory budget is kept by not letting the
+    // scan fill the page cache.
+    if (budget.memoryLimitBytes > 0 && !budget.ownCgroup && cachePolicy == core::CachePolicy::Keep) {
+        cachePolicy = core::CachePolicy::DropBehind;
+    }
+    m_fileMonitor.setCachePolicy(cachePolicy);
+    if (budget.readBytesPerSecond > 0) {
+        m_readThrottle = std::make_unique<core::ReadThrottle>(budget.readBytesPerSecond);
+        m_fileMonitor.setReadThrottle(m_readThrottle.get());
+    }
+}
+
+// Runs on the worker thread: the scan's pools are started from it and inherit
+// its CPU and I/O priority.
+void ScanWorker::applyBudget(core::ScanCgroup &cgroup) {
+    if (m_budget.idlePriority && !m_priorityLowered) {
+        m_priorityLowered = true;
+        if (!core::lowerCurrentThreadPriority()) {
+            qWarning() << "Failed to lower scan priority";
+        }
+    }
+    if (m_budget.ownCgroup && !cgroup.enter(m_budget, "filemonitor-scan")) {
+        qWarning() << "Failed to enter scan cgroup:" << QString::fromStdString(cgroup.errorString());
+    }
 }
 
 void ScanWorker::startScan(const QStringList &directories) {
     try {
+        core::ScanCgroup cgroup;
+        applyBudget(cgroup);
         QVector<FileRecordEntry> aggregated;
         int totalFiles = 0;
         int processedFiles = 0;
@@ -45,6 +79,8 @@ void ScanWorker::startScan(const QStringList &directories) {
         }
 
         emit progressChanged(processedFiles, totalFiles);
+        // Full scans are the periodic point for statistics and freed pages.
+        m_databaseManager.runMaintenance();
         emit scanFinished(aggregated);
     } catch (const std::exception &ex) {
         emit scanError(QString::fromUtf8(ex.what()));
@@ -52,3 +88,24 @@ void ScanWorker::startScan(const QStringList &directories) {
         emit scanError(tr("Неизвестная ошибка при сканировании"));
     }
 }
+
+void ScanWorker::startTargetedScan(const QStringList &paths) {
+    try {
+        core::ScanCgroup cgroup;
+        applyBudget(cgroup);
+        const auto results = m_fileMonitor.scanPaths(paths, m_recursive, m_followSymlinks, m_maxDepth);
+        const int totalFiles = results.size();
+        int processedFiles = 0;
+        emit progressChanged(processedFiles, totalFiles);
+        for (const auto &rec : results) {
+            ++processedFiles;
+            emit progressChanged(processedFiles, totalFiles);
+            emit fileProcessed(rec.metadata.path);
+        }
+        emit scanFinished(results);
+    } catch (const std::exception &ex) {
+        emit scanError(QString::fromUtf8(ex.what()));
+    } catch (...) {
+        emit scanError(tr("Неизвестная ошибка при сканировании"));
+    }
+}
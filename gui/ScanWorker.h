@@ -3,6 +3,7 @@
 
 #include <QObject>
 #include <QStringList>
+#include <memory>
 
 #include "FileMonitor.h"
 
@@ -14,11 +15,16 @@ public:
                const QVector<ExcludeRule> &rules,
                bool recursive,
                bool followSymlinks,
+               core::CachePolicy cachePolicy,
                int maxDepth,
+               const ScanTuning &tuning,
+               const core::ResourceBudget &budget,
+               const StorageProfile &storageProfile,
                QObject *parent = nullptr);
 
 public slots:
     void startScan(const QStringList &directories);
+    void startTargetedScan(const QStringList &paths);
 
 signals:
     void progressChanged(int current, int total);
@@ -27,11 +33,16 @@ signals:
     void scanError(const QString &message);
 
 private:
+    void applyBudget(core::ScanCgroup &cgroup);
+
     DatabaseManager m_databaseManager;
     FileMonitor m_fileMonitor;
     bool m_recursive;
     bool m_followSymlinks;
     int m_maxDepth;
+    core::ResourceBudget m_budget;
+    std::unique_ptr<core::ReadThrottle> m_readThrottle;
+    bool m_priorityLowered = false;
 };
 
 #endif // SCANWORKER_H
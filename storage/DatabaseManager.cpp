@@ -10,12 +10,98 @@
 #include <QList>
 #include <QPair>
 #include <QObject>
+#include <QStringList>
+
+#include <memory>
+#include <utility>
 
 namespace {
 bool isReadonlyError(const QSqlError &error) {
     const QString text = error.databaseText().isEmpty() ? error.text() : error.databaseText();
     return text.contains(QStringLiteral("readonly"), Qt::CaseInsensitive);
 }
+
+QString writeErrorText(const QSqlError &error) {
+    if (isReadonlyError(error)) {
+        return QObject::tr("База данных доступна только для чтения. Проверьте права на файл или путь к базе.");
+    }
+    return error.text();
+}
+
+// Multi-row statements stay under 999 parameters, SQLite's limit before 3.32.
+constexpr int kFileColumnCount = 25;
+constexpr int kFileRowsPerStatement = 32;
+constexpr int kHistoryColumnCount = 7;
+constexpr int kHistoryRowsPerStatement = 128;
+
+const char kFileColumns[] = "path, hash, size, mtime, uid, gid, mode, device, inode, hardlink_count, permissions, "
+                            "owner, group_name, status, signature, updated_at, last_checked, scanner_version, "
+                            "mtime_ns, ctime_ns, sample_hash, verify_tier, hash_algo, sha512, md5";
+
+const char kFileUpsertConflict[] = R"(
+    ON CONFLICT(path) DO UPDATE SET
+        hash = excluded.hash,
+        size = excluded.size,
+        mtime = excluded.mtime,
+        uid = excluded.uid,
+        gid = excluded.gid,
+        mode = excluded.mode,
+        device = excluded.device,
+        inode = excluded.inode,
+        hardlink_count = excluded.hardlink_count,
+        permissions = excluded.permissions,
+        owner = excluded.owner,
+        group_name = excluded.group_name,
+        status = excluded.status,
+        signature = excluded.signature,
+        updated_at = excluded.updated_at,
+        last_checked = excluded.last_checked,
+        scanner_version = excluded.scanner_version,
+        mtime_ns = excluded.mtime_ns,
+        ctime_ns = excluded.ctime_ns,
+        sample_hash = excluded.sample_hash,
+        verify_tier = excluded.verify_tier,
+        hash_algo = excluded.hash_algo,
+        sha512 = excluded.sha512,
+        md5 = excluded.md5;
+)";
+
+// "(?, ?), (?, ?)" for rows = 2, columns = 2.
+QString placeholderRows(int rows, int columns) {
+    QString row = QStringLiteral("(?");
+    for (int i = 1; i < columns; ++i) {
+        row += QStringLiteral(", ?");
+    }
+    row += QLatin1Char(')');
+    QStringList all;
+    for (int i = 0; i < rows; ++i) {
+        all << row;
+    }
+    return all.join(QStringLiteral(", "));
+}
+
+QString fileUpsertSql(int rows) {
+    return QStringLiteral("INSERT INTO files (%1) VALUES %2 %3")
+        .arg(QLatin1String(kFileColumns), placeholderRows(rows, kFileColumnCount), QLatin1String(kFileUpsertConflict));
+}
+
+QString historyInsertSql(int rows) {
+    return QStringLiteral(
+               "INSERT INTO scan_history (scan_time, file_path, old_status, new_status, old_hash, new_hash, comment) "
+               "VALUES %1;")
+        .arg(placeholderRows(rows, kHistoryColumnCount));
+}
+
+void bindHistory(QSqlQuery &query, const HistoryRecord &record) {
+    const QDateTime scanTime = record.scanTime.isValid() ? record.scanTime : QDateTime::currentDateTimeUtc();
+    query.addBindValue(scanTime.toString(Qt::ISODate));
+    query.addBindValue(record.filePath);
+    query.addBindValue(record.oldStatus < 0 ? QVariant(QMetaType::fromType<int>()) : QVariant(record.oldStatus));
+    query.addBindValue(record.newStatus);
+    query.addBindValue(record.oldHash);
+    query.addBindValue(record.newHash);
+    query.addBindValue(record.comment);
+}
 }
 
 DatabaseManager::DatabaseManager(const QString &databasePath, QString connectionName)
@@ -31,6 +117,8 @@ bool DatabaseManager::ensureConnection() const {
         return true;
     }
 
+    // Prepared statements belong to the connection that is being replaced.
+    m_statements.clear();
     if (QSqlDatabase::contains(m_connectionName)) {
         m_database = QSqlDatabase::database(m_connectionName);
     } else {
@@ -45,10 +133,74 @@ bool DatabaseManager::ensureConnection() const {
         return false;
     }
 
+    applyStorageProfile();
     m_lastError.clear();
     return true;
 }
 
+// A pragma that fails only costs speed, so failures are logged and the
+// connection is used with SQLite's defaults for that setting.
+void DatabaseManager::applyStorageProfile() const {
+    const StorageProfile &profile = m_storageProfile;
+    QSqlQuery query(m_database);
+    auto pragma = [&query](const QString &statement) {
+        if (!query.exec(statement)) {
+            qWarning() << "Failed to apply" << statement << ':' << query.lastError().text();
+            return false;
+        }
+        return true;
+    };
+
+    // Only takes effect before the first table is created; older databases
+    // keep auto_vacuum=NONE until a full VACUUM.
+    pragma(QStringLiteral("PRAGMA auto_vacuum = INCREMENTAL;"));
+    pragma(QStringLiteral("PRAGMA busy_timeout = %1;").arg(qMax(0, profile.busyTimeoutMs)));
+    const QString journalMode = profile.walJournal ? QStringLiteral("WAL") : QStringLiteral("DELETE");
+    if (pragma(QStringLiteral("PRAGMA journal_mode = %1;").arg(journalMode)) && query.next()
+        && query.value(0).toString().compare(journalMode, Qt::CaseInsensitive) != 0) {
+        // e.g. WAL on a file system without shared memory support.
+        qWarning() << "Database stays in journal mode" << query.value(0).toString();
+    }
+    query.finish();
+    // Without WAL, NORMAL can leave a corrupt file after a power loss.
+    const bool synchronousNormal = profile.walJournal && !profile.synchronousFull;
+    pragma(QStringLiteral("PRAGMA synchronous = %1;")
+               .arg(synchronousNormal ? QStringLiteral("NORMAL") : QStringLiteral("FULL")));
+    pragma(QStringLiteral("PRAGMA mmap_size = %1;").arg(qMax<qint64>(0, profile.mmapBytes)));
+    if (profile.cacheBytes > 0) {
+        // Negative values are KiB rather than pages.
+        pragma(QStringLiteral("PRAGMA cache_size = -%1;").arg(qMax<qint64>(1, profile.cacheBytes / 1024)));
+    }
+    pragma(QStringLiteral("PRAGMA temp_store = %1;")
+               .arg(profile.tempStoreMemory ? QStringLiteral("MEMORY") : QStringLiteral("DEFAULT")));
+}
+
+bool DatabaseManager::runMaintenance() {
+    if (!ensureConnection()) {
+        return false;
+    }
+
+    QSqlQuery query(m_database);
+    if (!query.exec(QStringLiteral("PRAGMA optimize;"))) {
+        m_lastError = query.lastError().text();
+        qWarning() << "Failed to optimize database:" << m_lastError;
+        return false;
+    }
+    if (m_storageProfile.vacuumPagesPerRun <= 0) {
+        return true;
+    }
+    // A no-op unless auto_vacuum is INCREMENTAL. Each step frees one page,
+    // so the statement is stepped to the end.
+    if (!query.exec(QStringLiteral("PRAGMA incremental_vacuum(%1);").arg(m_storageProfile.vacuumPagesPerRun))) {
+        m_lastError = query.lastError().text();
+        qWarning() << "Failed to vacuum database:" << m_lastError;
+        return false;
+    }
+    while (query.next()) {
+    }
+    return true;
+}
+
 bool DatabaseManager::createTables() const {
     QSqlQuery query(m_database);
     const QString createTableSql = R"(
@@ -70,7 +222,14 @@ bool DatabaseManager::createTables() const {
             signature TEXT NOT NULL,
             updated_at TEXT NOT NULL,
             last_checked TEXT NOT NULL,
-            scanner_version TEXT NOT NULL
+            scanner_version TEXT NOT NULL,
+            mtime_ns INTEGER NOT NULL DEFAULT 0,
+            ctime_ns INTEGER NOT NULL DEFAULT 0,
+            sample_hash TEXT,
+            verify_tier INTEGER NOT NULL DEFAULT 0,
+            hash_algo INTEGER NOT NULL DEFAULT 0,
+            sha512 TEXT,
+            md5 TEXT
         );
     )";
 
@@ -91,6 +250,13 @@ bool DatabaseManager::createTables() const {
     bool hasPermissions = false;
     bool hasOwner = false;
     bool hasGroupName = false;
+    bool hasMtimeNs = false;
+    bool hasCtimeNs = false;
+    bool hasSampleHash = false;
+    bool hasVerifyTier = false;
+    bool hasHashAlgo = false;
+    bool hasSha512 = false;
+    bool hasMd5 = false;
     while (query.next()) {
         if (query.value(1).toString() == QLatin1String("status")) {
             hasStatus = true;
@@ -100,6 +266,20 @@ bool DatabaseManager::createTables() const {
             hasOwner = true;
         } else if (query.value(1).toString() == QLatin1String("group_name")) {
             hasGroupName = true;
+        } else if (query.value(1).toString() == QLatin1String("mtime_ns")) {
+            hasMtimeNs = true;
+        } else if (query.value(1).toString() == QLatin1String("ctime_ns")) {
+            hasCtimeNs = true;
+        } else if (query.value(1).toString() == QLatin1String("sample_hash")) {
+            hasSampleHash = true;
+        } else if (query.value(1).toString() == QLatin1String("verify_tier")) {
+            hasVerifyTier = true;
+        } else if (query.value(1).toString() == QLatin1String("hash_algo")) {
+            hasHashAlgo = true;
+        } else if (query.value(1).toString() == QLatin1String("sha512")) {
+            hasSha512 = true;
+        } else if (query.value(1).toString() == QLatin1String("md5")) {
+            hasMd5 = true;
         }
     }
 
@@ -139,6 +319,69 @@ bool DatabaseManager::createTables() const {
         }
     }
 
+    if (!hasMtimeNs) {
+        QSqlQuery alter(m_database);
+        if (!alter.exec(QStringLiteral("ALTER TABLE files ADD COLUMN mtime_ns INTEGER NOT NULL DEFAULT 0;"))) {
+            m_lastError = alter.lastError().text();
+            qWarning() << "Failed to add mtime_ns column:" << m_lastError;
+            return false;
+        }
+    }
+
+    if (!hasCtimeNs) {
+        QSqlQuery alter(m_database);
+        if (!alter.exec(QStringLiteral("ALTER TABLE files ADD COLUMN ctime_ns INTEGER NOT NULL DEFAULT 0;"))) {
+            m_lastError = alter.lastError().text();
+            qWarning() << "Failed to add ctime_ns column:" << m_lastError;
+            return false;
+        }
+    }
+
+    if (!hasSampleHash) {
+        QSqlQuery alter(m_database);
+        if (!alter.exec(QStringLiteral("ALTER TABLE files ADD COLUMN sample_hash TEXT;"))) {
+            m_lastError = alter.lastError().text();
+            qWarning() << "Failed to add sample_hash column:" << m_lastError;
+            return false;
+        }
+    }
+
+    if (!hasVerifyTier) {
+        QSqlQuery alter(m_database);
+        if (!alter.exec(QStringLiteral("ALTER TABLE files ADD COLUMN verify_tier INTEGER NOT NULL DEFAULT 0;"))) {
+            m_lastError = alter.lastError().text();
+            qWarning() << "Failed to add verify_tier column:" << m_lastError;
+            return false;
+        }
+    }
+
+    if (!hasHashAlgo) {
+        QSqlQuery alter(m_database);
+        if (!alter.exec(QStringLiteral("ALTER TABLE files ADD COLUMN hash_algo INTEGER NOT NULL DEFAULT 0;"))) {
+            m_lastError = alter.lastError().text();
+            qWarning() << "Failed to add hash_algo column:" << m_lastError;
+            return false;
+        }
+    }
+
+    if (!hasSha512) {
+        QSqlQuery alter(m_database);
+        if (!alter.exec(QStringLiteral("ALTER TABLE files ADD COLUMN sha512 TEXT;"))) {
+            m_lastError = alter.lastError().text();
+            qWarning() << "Failed to add sha512 column:" << m_lastError;
+            return false;
+        }
+    }
+
+    if (!hasMd5) {
+        QSqlQuery alter(m_database);
+        if (!alter.exec(QStringLiteral("ALTER TABLE files ADD COLUMN md5 TEXT;"))) {
+            m_lastError = alter.lastError().text();
+            qWarning() << "Failed to add md5 column:" << m_lastError;
+            return false;
+        }
+    }
+
     const QList<QPair<QString, QString>> statusMigrations = {
         {QStringLiteral("Unchanged"), QStringLiteral("Ok")},
         {QStringLiteral("Modified"), QStringLiteral("Changed")},
@@ -158,7 +401,7 @@ bool DatabaseManager::createTables() const {
         }
     }
 
-    return createHistoryTable();
+    return createHistoryTable() && createChunkTable() && createMidstateTable();
 }
 
 bool DatabaseManager::createHistoryTable() const {
@@ -185,6 +428,52 @@ bool DatabaseManager::createHistoryTable() const {
     return true;
 }
 
+// Merkle leaves of files hashed in chunks. They are not signed: a row only
+// counts when its leaves hash to the root stored (and signed) in files.
+bool DatabaseManager::createChunkTable() const {
+    QSqlQuery query(m_database);
+    const QString createChunksSql = R"(
+        CREATE TABLE IF NOT EXISTS file_chunks (
+            path TEXT PRIMARY KEY,
+            chunk_size INTEGER NOT NULL,
+            digests BLOB NOT NULL
+        );
+    )";
+
+    if (!query.exec(createChunksSql)) {
+        m_lastError = query.lastError().text();
+        qWarning() << "Failed to create chunk table:" << m_lastError;
+        return false;
+    }
+
+    return true;
+}
+
+// Signed like file rows: a forged state would make a resumed hash agree with
+// whatever was appended.
+bool DatabaseManager::createMidstateTable() const {
+    QSqlQuery query(m_database);
+    const QString createMidstatesSql = R"(
+        CREATE TABLE IF NOT EXISTS file_midstates (
+            path TEXT PRIMARY KEY,
+            device INTEGER NOT NULL,
+            inode INTEGER NOT NULL,
+            length INTEGER NOT NULL,
+            state BLOB NOT NULL,
+            tail_digest BLOB NOT NULL,
+            signature TEXT
+        );
+    )";
+
+    if (!query.exec(createMidstatesSql)) {
+        m_lastError = query.lastError().text();
+        qWarning() << "Failed to create midstate table:" << m_lastError;
+        return false;
+    }
+
+    return true;
+}
+
 bool DatabaseManager::initialize() {
     if (!ensureConnection()) {
         return false;
@@ -197,63 +486,63 @@ bool DatabaseManager::initialize() {
     return ensureSchemaVersion();
 }
 
+QSqlQuery *DatabaseManager::preparedStatement(Statement id, const QString &sql) const {
+    auto &slot = m_statements[static_cast<int>(id)];
+    if (slot) {
+        return slot.get();
+    }
+    auto query = std::make_unique<QSqlQuery>(m_database);
+    if (!query->prepare(sql)) {
+        m_lastError = query->lastError().text();
+        qWarning() << "Failed to prepare statement:" << m_lastError;
+        m_statements.erase(static_cast<int>(id));
+        return nullptr;
+    }
+    slot = std::move(query);
+    return slot.get();
+}
+
+void DatabaseManager::bindFileRecord(QSqlQuery &query, const FileRecordEntry &record) const {
+    query.addBindValue(record.metadata.path);
+    query.addBindValue(record.metadata.hash);
+    query.addBindValue(record.metadata.size);
+    query.addBindValue(record.metadata.mtimeSeconds);
+    query.addBindValue(record.metadata.uid);
+    query.addBindValue(record.metadata.gid);
+    query.addBindValue(record.metadata.mode);
+    query.addBindValue(QVariant::fromValue(static_cast<qulonglong>(record.metadata.device)));
+    query.addBindValue(QVariant::fromValue(static_cast<qulonglong>(record.metadata.inode)));
+    query.addBindValue(QVariant::fromValue(static_cast<qulonglong>(record.metadata.hardlinkCount)));
+    query.addBindValue(QVariant::fromValue(static_cast<qulonglong>(record.metadata.permissions)));
+    query.addBindValue(record.metadata.owner);
+    query.addBindValue(record.metadata.groupName);
+    query.addBindValue(record.status);
+    query.addBindValue(computeSignature(record.metadata));
+    query.addBindValue(record.updatedAt.toString(Qt::ISODate));
+    query.addBindValue(record.lastChecked.toString(Qt::ISODate));
+    query.addBindValue(record.scannerVersion);
+    query.addBindValue(record.metadata.mtimeNs);
+    query.addBindValue(record.metadata.ctimeNs);
+    query.addBindValue(record.metadata.sampleHash);
+    query.addBindValue(static_cast<int>(record.verifyTier));
+    query.addBindValue(static_cast<int>(record.metadata.hashAlgorithm));
+    query.addBindValue(record.metadata.sha512);
+    query.addBindValue(record.metadata.md5);
+}
+
 bool DatabaseManager::upsertFileRecord(const FileRecordEntry &record) {
     if (!ensureConnection()) {
         return false;
     }
 
-    QSqlQuery query(m_database);
-    query.prepare(R"(
-        INSERT INTO files (path, hash, size, mtime, uid, gid, mode, device, inode, hardlink_count, permissions, owner, group_name, status, signature, updated_at, last_checked, scanner_version)
-        VALUES (:path, :hash, :size, :mtime, :uid, :gid, :mode, :device, :inode, :hardlink_count, :permissions, :owner, :group_name, :status, :signature, :updated_at, :last_checked, :scanner_version)
-        ON CONFLICT(path) DO UPDATE SET
-            hash = excluded.hash,
-            size = excluded.size,
-            mtime = excluded.mtime,
-            uid = excluded.uid,
-            gid = excluded.gid,
-            mode = excluded.mode,
-            device = excluded.device,
-            inode = excluded.inode,
-            hardlink_count = excluded.hardlink_count,
-            permissions = excluded.permissions,
-            owner = excluded.owner,
-            group_name = excluded.group_name,
-            status = excluded.status,
-            signature = excluded.signature,
-            updated_at = excluded.updated_at,
-            last_checked = excluded.last_checked,
-            scanner_version = excluded.scanner_version;
-    )");
-
-    const QString signature = computeSignature(record.metadata);
-
-    query.bindValue(":path", record.metadata.path);
-    query.bindValue(":hash", record.metadata.hash);
-    query.bindValue(":size", record.metadata.size);
-    query.bindValue(":mtime", record.metadata.mtimeSeconds);
-    query.bindValue(":uid", record.metadata.uid);
-    query.bindValue(":gid", record.metadata.gid);
-    query.bindValue(":mode", record.metadata.mode);
-    query.bindValue(":device", QVariant::fromValue(static_cast<qulonglong>(record.metadata.device)));
-    query.bindValue(":inode", QVariant::fromValue(static_cast<qulonglong>(record.metadata.inode)));
-    query.bindValue(":hardlink_count", QVariant::fromValue(static_cast<qulonglong>(record.metadata.hardlinkCount)));
-    query.bindValue(":permissions", QVariant::fromValue(static_cast<qulonglong>(record.metadata.permissions)));
-    query.bindValue(":owner", record.metadata.owner);
-    query.bindValue(":group_name", record.metadata.groupName);
-    query.bindValue(":status", record.status);
-    query.bindValue(":signature", signature);
-    query.bindValue(":updated_at", record.updatedAt.toString(Qt::ISODate));
-    query.bindValue(":last_checked", record.lastChecked.toString(Qt::ISODate));
-    query.bindValue(":scanner_version", record.scannerVersion);
+    QSqlQuery *query = preparedStatement(Statement::UpsertFile, fileUpsertSql(1));
+    if (!query) {
+        return false;
+    }
+    bindFileRecord(*query, record);
 
-    if (!query.exec()) {
-        const auto error = query.lastError();
-        m_lastError = error.text();
-        if (isReadonlyError(error)) {
-            m_lastError = QObject::tr(
-                "База данных доступна только для чтения. Проверьте права на файл или путь к базе.");
-        }
+    if (!query->exec()) {
+        m_lastError = writeErrorText(query->lastError());
         qWarning() << "Failed to upsert file record:" << m_lastError;
         return false;
     }
@@ -261,6 +550,52 @@ bool DatabaseManager::upsertFileRecord(const FileRecordEntry &record) {
     return true;
 }
 
+bool DatabaseManager::upsertFileRecords(const QVector<FileRecordEntry> &records) {
+    if (!ensureConnection()) {
+        return false;
+    }
+
+    // One statement cannot update a row twice, so only the last record for a
+    // path is written, which leaves the same row as writing them in order.
+    QHash<QString, int> lastIndex;
+    lastIndex.reserve(records.size());
+    for (int i = 0; i < records.size(); ++i) {
+        lastIndex.insert(records[i].metadata.path, i);
+    }
+    QVector<const FileRecordEntry *> rows;
+    rows.reserve(lastIndex.size());
+    for (int i = 0; i < records.size(); ++i) {
+        if (lastIndex.value(records[i].metadata.path) == i) {
+            rows.append(&records[i]);
+        }
+    }
+
+    int next = 0;
+    if (rows.size() >= kFileRowsPerStatement) {
+        QSqlQuery *batch = preparedStatement(Statement::UpsertFiles, fileUpsertSql(kFileRowsPerStatement));
+        if (!batch) {
+            return false;
+        }
+        for (; next + kFileRowsPerStatement <= rows.size(); next += kFileRowsPerStatement) {
+            for (int i = next; i < next + kFileRowsPerStatement; ++i) {
+                bindFileRecord(*batch, *rows[i]);
+            }
+            if (!batch->exec()) {
+                m_lastError = writeErrorText(batch->lastError());
+                qWarning() << "Failed to upsert file records:" << m_lastError;
+                return false;
+            }
+        }
+    }
+    for (; next < rows.size(); ++next) {
+        if (!upsertFileRecord(*rows[next])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 bool DatabaseManager::clearAllRecords() {
     if (!ensureConnection()) {
         return false;
@@ -279,6 +614,18 @@ bool DatabaseManager::clearAllRecords() {
         return false;
     }
 
+    if (!query.exec(QStringLiteral("DELETE FROM file_chunks;"))) {
+        m_lastError = query.lastError().text();
+        qWarning() << "Failed to clear chunk digests:" << m_lastError;
+        return false;
+    }
+
+    if (!query.exec(QStringLiteral("DELETE FROM file_midstates;"))) {
+        m_lastError = query.lastError().text();
+        qWarning() << "Failed to clear hash midstates:" << m_lastError;
+        return false;
+    }
+
     return true;
 }
 
@@ -311,6 +658,16 @@ FileRecordEntry DatabaseManager::hydrateRecord(QSqlQuery &query) const {
     record.updatedAt = QDateTime::fromString(query.value(15).toString(), Qt::ISODate);
     record.lastChecked = QDateTime::fromString(query.value(16).toString(), Qt::ISODate);
     record.scannerVersion = query.value(17).toString();
+    record.metadata.mtimeNs = query.value(18).toLongLong();
+    record.metadata.ctimeNs = query.value(19).toLongLong();
+    record.metadata.sampleHash = query.value(20).toString();
+    record.verifyTier = query.value(21).toInt() == static_cast<int>(VerifyTier::Sampled) ? VerifyTier::Sampled
+                                                                                         : VerifyTier::Full;
+    record.metadata.hashAlgorithm = query.value(22).toInt() == static_cast<int>(HashAlgorithm::Blake3)
+        ? HashAlgorithm::Blake3
+        : HashAlgorithm::Sha256;
+    record.metadata.sha512 = query.value(23).toString();
+    record.metadata.md5 = query.value(24).toString();
     record.signatureValid = verifySignature(record);
     return record;
 }
@@ -320,24 +677,28 @@ FileRecordEntry DatabaseManager::fetchRecord(const QString &path) const {
         return {};
     }
 
-    QSqlQuery query(m_database);
-    query.prepare(R"(
-        SELECT path, hash, size, mtime, uid, gid, mode, device, inode, hardlink_count, permissions, owner, group_name, status, signature, updated_at, last_checked, scanner_version
-        FROM files WHERE path = :path LIMIT 1;
-    )");
-    query.bindValue(":path", path);
+    QSqlQuery *query = preparedStatement(Statement::FetchRecord, QStringLiteral(R"(
+        SELECT path, hash, size, mtime, uid, gid, mode, device, inode, hardlink_count, permissions, owner, group_name, status, signature, updated_at, last_checked, scanner_version, mtime_ns, ctime_ns, sample_hash, verify_tier, hash_algo, sha512, md5
+        FROM files WHERE path = ? LIMIT 1;
+    )"));
+    if (!query) {
+        return {};
+    }
+    query->addBindValue(path);
 
-    if (!query.exec()) {
-        m_lastError = query.lastError().text();
+    if (!query->exec()) {
+        m_lastError = query->lastError().text();
         qWarning() << "Failed to fetch record:" << m_lastError;
         return {};
     }
 
-    if (query.next()) {
-        return hydrateRecord(query);
+    FileRecordEntry record;
+    if (query->next()) {
+        record = hydrateRecord(*query);
     }
-
-    return {};
+    // Resets the statement so it holds no read lock until its next use.
+    query->finish();
+    return record;
 }
 
 QVector<FileRecordEntry> DatabaseManager::fetchAllRecords() const {
@@ -349,7 +710,7 @@ QVector<FileRecordEntry> DatabaseManager::fetchAllRecords() const {
 
     QSqlQuery query(m_database);
     if (!query.exec(R"(
-            SELECT path, hash, size, mtime, uid, gid, mode, device, inode, hardlink_count, permissions, owner, group_name, status, signature, updated_at, last_checked, scanner_version
+            SELECT path, hash, size, mtime, uid, gid, mode, device, inode, hardlink_count, permissions, owner, group_name, status, signature, updated_at, last_checked, scanner_version, mtime_ns, ctime_ns, sample_hash, verify_tier, hash_algo, sha512, md5
             FROM files ORDER BY path ASC;
         )")) {
         m_lastError = query.lastError().text();
@@ -364,41 +725,85 @@ QVector<FileRecordEntry> DatabaseManager::fetchAllRecords() const {
     return records;
 }
 
+QVector<FileRecordEntry> DatabaseManager::fetchRecords(const QStringList &paths) const {
+    // Well below SQLITE_MAX_VARIABLE_NUMBER, which is 999 in older builds.
+    constexpr int kPathsPerQuery = 500;
+    QVector<FileRecordEntry> records;
+
+    if (!ensureConnection()) {
+        return records;
+    }
+
+    for (int first = 0; first < paths.size(); first += kPathsPerQuery) {
+        const QStringList chunk = paths.mid(first, kPathsPerQuery);
+        QStringList placeholders;
+        for (int i = 0; i < chunk.size(); ++i) {
+            placeholders << QStringLiteral("?");
+        }
+        QSqlQuery query(m_database);
+        query.prepare(QStringLiteral(R"(
+            SELECT path, hash, size, mtime, uid, gid, mode, device, inode, hardlink_count, permissions, owner, group_name, status, signature, updated_at, last_checked, scanner_version, mtime_ns, ctime_ns, sample_hash, verify_tier, hash_algo, sha512, md5
+            FROM files WHERE path IN (%1);
+        )").arg(placeholders.join(QLatin1Char(','))));
+        for (const QString &path : chunk) {
+            query.addBindValue(path);
+        }
+        if (!query.exec()) {
+            m_lastError = query.lastError().text();
+            qWarning() << "Failed to fetch records:" << m_lastError;
+            return records;
+        }
+        while (query.next()) {
+            records.append(hydrateRecord(query));
+        }
+    }
+
+    return records;
+}
+
 bool DatabaseManager::insertHistoryRecord(const QString &filePath,
                                           int oldStatus,
                                           int newStatus,
                                           const QString &oldHash,
                                           const QString &newHash,
                                           const QString &comment) {
+    HistoryRecord record;
+    record.filePath = filePath;
+    record.oldStatus = oldStatus;
+    record.newStatus = newStatus;
+    record.oldHash = oldHash;
+    record.newHash = newHash;
+    record.comment = comment;
+    return insertHistoryRecords({record});
+}
+
+bool DatabaseManager::insertHistoryRecords(const QVector<HistoryRecord> &records) {
     if (!ensureConnection()) {
         return false;
     }
 
-    QSqlQuery query(m_database);
-    query.prepare(R"(
-        INSERT INTO scan_history (scan_time, file_path, old_status, new_status, old_hash, new_hash, comment)
-        VALUES (:scan_time, :file_path, :old_status, :new_status, :old_hash, :new_hash, :comment);
-    )");
-
-    query.bindValue(":scan_time", QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
-    query.bindValue(":file_path", filePath);
-    if (oldStatus < 0) {
-        query.bindValue(":old_status", QVariant(QMetaType::fromType<int>()));
-    } else {
-        query.bindValue(":old_status", oldStatus);
-    }
-    query.bindValue(":new_status", newStatus);
-    query.bindValue(":old_hash", oldHash);
-    query.bindValue(":new_hash", newHash);
-    query.bindValue(":comment", comment);
-
-    if (!query.exec()) {
-        m_lastError = query.lastError().text();
-        qWarning() << "Failed to insert history record:" << m_lastError;
+    int next = 0;
+    auto insert = [&](Statement id, int rows) {
+        QSqlQuery *query = preparedStatement(id, historyInsertSql(rows));
+        if (!query) {
+            return false;
+        }
+        for (; next + rows <= records.size(); next += rows) {
+            for (int i = next; i < next + rows; ++i) {
+                bindHistory(*query, records[i]);
+            }
+            if (!query->exec()) {
+                m_lastError = query->lastError().text();
+                qWarning() << "Failed to insert history record:" << m_lastError;
+                return false;
+            }
+        }
+        return true;
+    };
+    if (records.size() >= kHistoryRowsPerStatement && !insert(Statement::InsertHistories, kHistoryRowsPerStatement)) {
         return false;
     }
-
-    return true;
+    return next == records.size() || insert(Statement::InsertHistory, 1);
 }
 
 QVector<HistoryRecord> DatabaseManager::fetchHistory(int limit) const {
@@ -483,7 +888,55 @@ QString DatabaseManager::computeSignature(const FileMetadata &metadata) const {
     payload += '|' + QByteArray::number(metadata.gid);
     payload += '|' + QByteArray::number(metadata.mode);
     payload += '|' + metadata.hash.toUtf8();
+    // The stat fingerprint decides whether incremental scans may reuse the
+    // stored hash, so it is signed too. Rows written before it existed carry
+    // zeros and keep their original payload.
+    if (metadata.mtimeNs != 0 || metadata.ctimeNs != 0) {
+        payload += '|' + QByteArray::number(metadata.device);
+        payload += '|' + QByteArray::number(metadata.inode);
+        payload += '|' + QByteArray::number(metadata.mtimeNs);
+        payload += '|' + QByteArray::number(metadata.ctimeNs);
+    }
+    // A matching sample lets a quick verify keep the stored hash.
+    if (!metadata.sampleHash.isEmpty()) {
+        payload += '|' + metadata.sampleHash.toUtf8();
+    }
+    // SHA-256 rows keep the payload they had before the column existed.
+    if (metadata.hashAlgorithm != HashAlgorithm::Sha256) {
+        payload += "|algo" + QByteArray::number(static_cast<int>(metadata.hashAlgorithm));
+    }
+    // The extra digests are what manifests get checked against.
+    if (!metadata.sha512.isEmpty()) {
+        payload += "|sha512:" + metadata.sha512.toUtf8();
+    }
+    if (!metadata.md5.isEmpty()) {
+        payload += "|md5:" + metadata.md5.toUtf8();
+    }
+    return hmacHex(payload);
+}
+
+QString DatabaseManager::computeMidstateSignature(const QString &path, const HashMidstate &midstate) const {
+    if (m_hmacKey.isEmpty()) {
+        return {};
+    }
 
+    QByteArray payload = "midstate|" + path.toUtf8();
+    payload += '|' + QByteArray::number(midstate.device);
+    payload += '|' + QByteArray::number(midstate.inode);
+    payload += '|' + QByteArray::number(midstate.length);
+    payload += '|' + midstate.state.toHex();
+    payload += '|' + midstate.tailDigest.toHex();
+    return hmacHex(payload);
+}
+
+QByteArray DatabaseManager::keyedDigest(const QByteArray &payload) const {
+    if (m_hmacKey.isEmpty()) {
+        return QCryptographicHash::hash(payload, QCryptographicHash::Sha256);
+    }
+    return QByteArray::fromHex(hmacHex(payload).toLatin1());
+}
+
+QString DatabaseManager::hmacHex(const QByteArray &payload) const {
     QByteArray key = m_hmacKey;
     const int blockSize = 64;
     if (key.size() > blockSize) {
@@ -515,6 +968,216 @@ bool DatabaseManager::verifySignature(const FileRecordEntry &record) const {
     return expected == record.signature;
 }
 
+bool DatabaseManager::upsertChunkDigests(const QString &path, qint64 chunkSize, const QByteArray &digests) {
+    if (!ensureConnection()) {
+        return false;
+    }
+
+    QSqlQuery query(m_database);
+    query.prepare(QStringLiteral("INSERT INTO file_chunks (path, chunk_size, digests) VALUES (:path, :chunk_size, :digests) "
+                                 "ON CONFLICT(path) DO UPDATE SET chunk_size = excluded.chunk_size, "
+                                 "digests = excluded.digests;"));
+    query.bindValue(":path", path);
+    query.bindValue(":chunk_size", chunkSize);
+    query.bindValue(":digests", digests);
+    if (!query.exec()) {
+        m_lastError = query.lastError().text();
+        qWarning() << "Failed to write chunk digests:" << m_lastError;
+        return false;
+    }
+    return true;
+}
+
+bool DatabaseManager::fetchChunkDigests(const QString &path, qint64 &chunkSize, QByteArray &digests) const {
+    if (!ensureConnection()) {
+        return false;
+    }
+
+    QSqlQuery query(m_database);
+    query.prepare(QStringLiteral("SELECT chunk_size, digests FROM file_chunks WHERE path = :path LIMIT 1;"));
+    query.bindValue(":path", path);
+    if (!query.exec()) {
+        m_lastError = query.lastError().text();
+        qWarning() << "Failed to read chunk digests:" << m_lastError;
+        return false;
+    }
+    if (!query.next()) {
+        return false;
+    }
+    chunkSize = query.value(0).toLongLong();
+    digests = query.value(1).toByteArray();
+    return true;
+}
+
+bool DatabaseManager::removeChunkDigests(const QString &path) {
+    if (!ensureConnection()) {
+        return false;
+    }
+
+    QSqlQuery query(m_database);
+    query.prepare(QStringLiteral("DELETE FROM file_chunks WHERE path = :path;"));
+    query.bindValue(":path", path);
+    if (!query.exec()) {
+        m_lastError = query.lastError().text();
+        qWarning() << "Failed to remove chunk digests:" << m_lastError;
+        return false;
+    }
+    return true;
+}
+
+bool DatabaseManager::removeFileState(const QStringList &paths) {
+    // Well below SQLITE_MAX_VARIABLE_NUMBER, as in fetchRecords().
+    constexpr int kPathsPerQuery = 500;
+    if (paths.isEmpty()) {
+        return true;
+    }
+    if (!ensureConnection()) {
+        return false;
+    }
+
+    QSqlQuery query(m_database);
+    for (int first = 0; first < paths.size(); first += kPathsPerQuery) {
+        const QStringList chunk = paths.mid(first, kPathsPerQuery);
+        QStringList placeholders;
+        for (int i = 0; i < chunk.size(); ++i) {
+            placeholders << QStringLiteral("?");
+        }
+        for (const QString &table : {QStringLiteral("file_chunks"), QStringLiteral("file_midstates")}) {
+            query.prepare(QStringLiteral("DELETE FROM %1 WHERE path IN (%2);")
+                              .arg(table, placeholders.join(QLatin1Char(','))));
+            for (const QString &path : chunk) {
+                query.addBindValue(path);
+            }
+            if (!query.exec()) {
+                m_lastError = query.lastError().text();
+                qWarning() << "Failed to remove file state:" << m_lastError;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool DatabaseManager::upsertMidstate(const QString &path, const HashMidstate &midstate) {
+    if (!ensureConnection()) {
+        return false;
+    }
+
+    QSqlQuery query(m_database);
+    query.prepare(QStringLiteral("INSERT INTO file_midstates (path, device, inode, length, state, tail_digest, signature) "
+                                 "VALUES (:path, :device, :inode, :length, :state, :tail_digest, :signature) "
+                                 "ON CONFLICT(path) DO UPDATE SET device = excluded.device, inode = excluded.inode, "
+                                 "length = excluded.length, state = excluded.state, "
+                                 "tail_digest = excluded.tail_digest, signature = excluded.signature;"));
+    query.bindValue(":path", path);
+    query.bindValue(":device", static_cast<qulonglong>(midstate.device));
+    query.bindValue(":inode", static_cast<qulonglong>(midstate.inode));
+    query.bindValue(":length", midstate.length);
+    query.bindValue(":state", midstate.state);
+    query.bindValue(":tail_digest", midstate.tailDigest);
+    query.bindValue(":signature", computeMidstateSignature(path, midstate));
+    if (!query.exec()) {
+        m_lastError = query.lastError().text();
+        qWarning() << "Failed to write hash midstate:" << m_lastError;
+        return false;
+    }
+    return true;
+}
+
+bool DatabaseManager::fetchMidstate(const QString &path, HashMidstate &midstate) const {
+    if (!ensureConnection()) {
+        return false;
+    }
+
+    QSqlQuery query(m_database);
+    query.prepare(QStringLiteral("SELECT device, inode, length, state, tail_digest, signature FROM file_midstates "
+                                 "WHERE path = :path LIMIT 1;"));
+    query.bindValue(":path", path);
+    if (!query.exec()) {
+        m_lastError = query.lastError().text();
+        qWarning() << "Failed to read hash midstate:" << m_lastError;
+        return false;
+    }
+    if (!query.next()) {
+        return false;
+    }
+    HashMidstate row;
+    row.device = query.value(0).toULongLong();
+    row.inode = query.value(1).toULongLong();
+    row.length = query.value(2).toLongLong();
+    row.state = query.value(3).toByteArray();
+    row.tailDigest = query.value(4).toByteArray();
+    if (!m_hmacKey.isEmpty() && computeMidstateSignature(path, row) != query.value(5).toString()) {
+        qWarning() << "Midstate signature mismatch for" << path;
+        return false;
+    }
+    midstate = row;
+    return true;
+}
+
+QHash<QString, HashMidstate> DatabaseManager::fetchAllMidstates() const {
+    QHash<QString, HashMidstate> midstates;
+    if (!ensureConnection()) {
+        return midstates;
+    }
+
+    QSqlQuery query(m_database);
+    if (!query.exec(QStringLiteral("SELECT path, device, inode, length, state, tail_digest, signature FROM file_midstates;"))) {
+        m_lastError = query.lastError().text();
+        qWarning() << "Failed to read hash midstates:" << m_lastError;
+        return midstates;
+    }
+    while (query.next()) {
+        const QString path = query.value(0).toString();
+        HashMidstate row;
+        row.device = query.value(1).toULongLong();
+        row.inode = query.value(2).toULongLong();
+        row.length = query.value(3).toLongLong();
+        row.state = query.value(4).toByteArray();
+        row.tailDigest = query.value(5).toByteArray();
+        if (!m_hmacKey.isEmpty() && computeMidstateSignature(path, row) != query.value(6).toString()) {
+            qWarning() << "Midstate signature mismatch for" << path;
+            continue;
+        }
+        midstates.insert(path, row);
+    }
+    return midstates;
+}
+
+QString DatabaseManager::metaValue(const QString &key) const {
+    if (!ensureConnection()) {
+        return {};
+    }
+
+    QSqlQuery query(m_database);
+    query.prepare(QStringLiteral("SELECT value FROM meta WHERE key = :key LIMIT 1;"));
+    query.bindValue(":key", key);
+    if (!query.exec()) {
+        m_lastError = query.lastError().text();
+        qWarning() << "Failed to read meta value:" << m_lastError;
+        return {};
+    }
+    return query.next() ? query.value(0).toString() : QString();
+}
+
+bool DatabaseManager::setMetaValue(const QString &key, const QString &value) {
+    if (!ensureConnection()) {
+        return false;
+    }
+
+    QSqlQuery query(m_database);
+    query.prepare(QStringLiteral("INSERT INTO meta (key, value) VALUES (:key, :value) "
+                                 "ON CONFLICT(key) DO UPDATE SET value = excluded.value;"));
+    query.bindValue(":key", key);
+    query.bindValue(":value", value);
+    if (!query.exec()) {
+        m_lastError = query.lastError().text();
+        qWarning() << "Failed to write meta value:" << m_lastError;
+        return false;
+    }
+    return true;
+}
+
 bool DatabaseManager::ensureSchemaVersion() {
     if (!ensureConnection()) {
         return false;
@@ -6,13 +6,27 @@
 #include <QString>
 #include <QDateTime>
 #include <QByteArray>
+#include <QHash>
 #include <QSqlQuery>
+#include <QStringList>
+
+#include <memory>
+#include <unordered_map>
+
+// Digest the hash column holds. Stored as an integer per row, so the values
+// must not change.
+enum class HashAlgorithm {
+    Sha256 = 0, // also Merkle roots, which are built from SHA-256
+    Blake3 = 1,
+};
 
 struct FileMetadata {
     QString path;
     QString hash;
     qint64 size = 0;
     qint64 mtimeSeconds = 0;
+    qint64 mtimeNs = 0;
+    qint64 ctimeNs = 0;
     quint32 uid = 0;
     quint32 gid = 0;
     quint32 mode = 0;
@@ -23,6 +37,26 @@ struct FileMetadata {
     QString owner;
     QString groupName;
     QString errorReason;
+    QString sampleHash; // quick-verify digest of sampled blocks, see core::sampledDigest()
+    HashAlgorithm hashAlgorithm = HashAlgorithm::Sha256;
+    QString sha512; // extra digests from the same read as hash, see ScanTuning::extraDigests
+    QString md5;
+};
+
+// How the content of a file was confirmed by the scan that wrote the row.
+enum class VerifyTier {
+    Full = 0,    // every byte hashed
+    Sampled = 1, // size and sampled blocks matched; the hash is carried over
+};
+
+// SHA-256 state after the first `length` bytes of a file, kept so that a
+// file that only grew can be hashed on from there.
+struct HashMidstate {
+    quint64 device = 0;
+    quint64 inode = 0;
+    qint64 length = 0;    // 0 = none
+    QByteArray state;      // core::Sha256::saveState()
+    QByteArray tailDigest; // SHA-256 of the bytes just before length
 };
 
 struct FileRecordEntry {
@@ -40,6 +74,11 @@ struct FileRecordEntry {
     bool ownerChanged = false;
     bool mtimeChanged = false;
     bool inodeChanged = false;
+    QByteArray chunkDigests; // Merkle leaves when metadata.hash is a Merkle root
+    qint64 chunkSize = 0;
+    HashMidstate midstate; // set when it should be stored
+    QString storedAlgorithmHash; // the file's hash in the row's old algorithm while it is migrated
+    VerifyTier verifyTier = VerifyTier::Full;
 };
 
 struct HistoryRecord {
@@ -52,36 +91,110 @@ struct HistoryRecord {
     QString comment;
 };
 
+// File rows and history rows held back so that they can be written with
+// upsertFileRecords() and insertHistoryRecords() in one go, and the paths
+// whose chunk digests and midstates go with them (removeFileState()).
+struct PendingWrites {
+    QVector<FileRecordEntry> files;
+    QVector<HistoryRecord> history;
+    QStringList removedPaths;
+
+    void clear() {
+        files.clear();
+        history.clear();
+        removedPaths.clear();
+    }
+};
+
+// SQLite settings applied to every connection a DatabaseManager opens. The
+// defaults let the GUI read while a scan worker writes, without lock waits
+// and without an fsync per transaction.
+struct StorageProfile {
+    bool walJournal = true;        // journal_mode=WAL instead of DELETE
+    bool synchronousFull = false;  // synchronous=FULL; NORMAL is used only with WAL
+    qint64 mmapBytes = 256LL * 1024 * 1024; // mmap_size, 0 = plain reads
+    qint64 cacheBytes = 64LL * 1024 * 1024; // page cache per connection
+    bool tempStoreMemory = true;   // temp_store=MEMORY
+    int busyTimeoutMs = 5000;      // wait this long for another connection's lock
+    int vacuumPagesPerRun = 1024;  // free pages runMaintenance() gives back, 0 = none
+};
+
 class DatabaseManager {
 public:
     explicit DatabaseManager(const QString &databasePath,
                              QString connectionName = QStringLiteral("integrity_connection"));
     bool initialize();
     void setHmacKey(const QByteArray &key);
+    // Applies to connections opened afterwards, so set it before initialize().
+    void setStorageProfile(const StorageProfile &profile) { m_storageProfile = profile; }
+    // Runs PRAGMA optimize and returns up to StorageProfile::vacuumPagesPerRun
+    // free pages to the file system. Cheap enough to run after every scan.
+    bool runMaintenance();
+    // Writes go through statements prepared once per connection. The batch
+    // versions also put many rows into one statement; run them inside a
+    // transaction for full speed.
     bool upsertFileRecord(const FileRecordEntry &record);
+    bool upsertFileRecords(const QVector<FileRecordEntry> &records);
     bool clearAllRecords();
     QString fetchHash(const QString &path) const;
     FileRecordEntry fetchRecord(const QString &path) const;
     QVector<FileRecordEntry> fetchAllRecords() const;
+    // The rows stored for paths, in no particular order; missing paths are
+    // skipped. Takes one query per few hundred paths.
+    QVector<FileRecordEntry> fetchRecords(const QStringList &paths) const;
     bool insertHistoryRecord(const QString &filePath,
                              int oldStatus,
                              int newStatus,
                              const QString &oldHash,
                              const QString &newHash,
                              const QString &comment);
+    // An invalid scanTime is stored as the current time.
+    bool insertHistoryRecords(const QVector<HistoryRecord> &records);
     QVector<HistoryRecord> fetchHistory(int limit = 500) const;
     bool beginTransaction();
     bool commitTransaction();
     void rollbackTransaction();
+    bool upsertChunkDigests(const QString &path, qint64 chunkSize, const QByteArray &digests);
+    bool fetchChunkDigests(const QString &path, qint64 &chunkSize, QByteArray &digests) const;
+    bool removeChunkDigests(const QString &path);
+    // Drops the chunk digests and midstates stored for paths, e.g. of files
+    // that were deleted, so a later file cannot be matched against them.
+    bool removeFileState(const QStringList &paths);
+    bool upsertMidstate(const QString &path, const HashMidstate &midstate);
+    // Only midstates whose signature verifies are returned.
+    bool fetchMidstate(const QString &path, HashMidstate &midstate) const;
+    QHash<QString, HashMidstate> fetchAllMidstates() const;
+    QString metaValue(const QString &key) const;
+    bool setMetaValue(const QString &key, const QString &value);
+    // HMAC-SHA256 under the database key, plain SHA-256 without one. Uses no
+    // connection, so scan threads may call it.
+    QByteArray keyedDigest(const QByteArray &payload) const;
     QString lastError() const { return m_lastError; }
 
 private:
+    enum class Statement {
+        UpsertFile,
+        UpsertFiles,
+        InsertHistory,
+        InsertHistories,
+        FetchRecord,
+    };
+
     bool ensureConnection() const;
+    void applyStorageProfile() const;
+    // The statement for id, prepared from sql on first use; null if that
+    // fails. Valid until the connection is reopened.
+    QSqlQuery *preparedStatement(Statement id, const QString &sql) const;
+    void bindFileRecord(QSqlQuery &query, const FileRecordEntry &record) const;
     bool createTables() const;
     bool createHistoryTable() const;
+    bool createChunkTable() const;
+    bool createMidstateTable() const;
     bool ensureSchemaVersion();
     bool setSchemaVersion(int version) const;
     QString computeSignature(const FileMetadata &metadata) const;
+    QString computeMidstateSignature(const QString &path, const HashMidstate &midstate) const;
+    QString hmacHex(const QByteArray &payload) const;
     FileRecordEntry hydrateRecord(QSqlQuery &query) const;
     bool verifySignature(const FileRecordEntry &record) const;
 
@@ -89,7 +202,9 @@ private:
     QString m_connectionName;
     mutable QSqlDatabase m_database;
     QByteArray m_hmacKey;
+    StorageProfile m_storageProfile;
     mutable QString m_lastError;
+    mutable std::unordered_map<int, std::unique_ptr<QSqlQuery>> m_statements;
 };
 
 #endif // DATABASEMANAGER_H
@@ -47,10 +47,20 @@ std::vector<core::FileMetadata> QtStorageAdapter::loadCurrentState() {
         meta.hash = rec.metadata.hash.toStdString();
         meta.size = static_cast<std::uint64_t>(rec.metadata.size);
         meta.permissions = rec.metadata.permissions;
+        meta.uid = rec.metadata.uid;
+        meta.gid = rec.metadata.gid;
         meta.owner = rec.metadata.owner.toStdString();
         meta.group = rec.metadata.groupName.toStdString();
         meta.inode = rec.metadata.inode;
-        meta.mtime = std::chrono::system_clock::from_time_t(rec.metadata.mtimeSeconds);
+        meta.device = rec.metadata.device;
+        meta.mtimeNs = rec.metadata.mtimeNs;
+        meta.ctimeNs = rec.metadata.ctimeNs;
+        // Rows written with nanosecond times restore the exact mtime, so the
+        // comparison against a fresh scan does not flag sub-second drift.
+        meta.mtime = rec.metadata.mtimeNs != 0
+            ? std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                  std::chrono::nanoseconds(rec.metadata.mtimeNs)))
+            : std::chrono::system_clock::from_time_t(rec.metadata.mtimeSeconds);
         meta.status = fromString(rec.status);
         result.push_back(std::move(meta));
     }
@@ -59,22 +69,30 @@ std::vector<core::FileMetadata> QtStorageAdapter::loadCurrentState() {
 
 void QtStorageAdapter::saveCurrentState(const std::vector<core::FileMetadata> &files) {
     m_db->clearAllRecords();
+    QVector<FileRecordEntry> records;
+    records.reserve(static_cast<int>(files.size()));
     for (const auto &meta : files) {
         FileRecordEntry rec;
         rec.metadata.path = QString::fromStdString(meta.path);
         rec.metadata.hash = QString::fromStdString(meta.hash);
         rec.metadata.size = static_cast<qint64>(meta.size);
         rec.metadata.permissions = meta.permissions;
+        rec.metadata.uid = meta.uid;
+        rec.metadata.gid = meta.gid;
         rec.metadata.owner = QString::fromStdString(meta.owner);
         rec.metadata.groupName = QString::fromStdString(meta.group);
         rec.metadata.inode = meta.inode;
+        rec.metadata.device = meta.device;
+        rec.metadata.mtimeNs = meta.mtimeNs;
+        rec.metadata.ctimeNs = meta.ctimeNs;
         rec.metadata.mtimeSeconds = std::chrono::system_clock::to_time_t(meta.mtime);
         rec.status = toString(meta.status);
         rec.updatedAt = QDateTime::currentDateTimeUtc();
         rec.lastChecked = rec.updatedAt;
         rec.signatureValid = true;
-        m_db->upsertFileRecord(rec);
+        records.append(rec);
     }
+    m_db->upsertFileRecords(records);
 }
 
 void QtStorageAdapter::appendHistoryRecord(const core::HistoryEvent &rec) {
@@ -104,3 +122,10 @@ std::vector<core::HistoryEvent> QtStorageAdapter::loadHistory(int limit) {
     }
     return result;
 }
+
+std::uint64_t QtStorageAdapter::nextScanCycle() {
+    const QString key = QStringLiteral("core_scan_cycle");
+    const qulonglong cycle = m_db->metaValue(key).toULongLong();
+    m_db->setMetaValue(key, QString::number(cycle + 1));
+    return cycle;
+}
@@ -17,6 +17,7 @@ public:
     void saveCurrentState(const std::vector<core::FileMetadata> &files) override;
     void appendHistoryRecord(const core::HistoryEvent &rec) override;
     std::vector<core::HistoryEvent> loadHistory(int limit = 500) override;
+    std::uint64_t nextScanCycle() override;
 
 private:
     std::shared_ptr<DatabaseManager> m_db;